@@ -0,0 +1,148 @@
+#ifndef DISPATCH_TABLE_HPP_
+#define DISPATCH_TABLE_HPP_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// the targets of one key, contiguous in the table
+template <typename T>
+struct DispatchSpan {
+  T* const* first;
+  T* const* last;
+
+  T* const* begin() const {
+    return first;
+  }
+
+  T* const* end() const {
+    return last;
+  }
+
+  bool empty() const {
+    return first == last;
+  }
+
+  size_t size() const {
+    return last - first;
+  }
+};
+
+// key -> targets routing frozen once the strategies are built: keys get ids 0..n-1
+// in sorted order and every key's targets sit in one span of a single array
+// a lookup is a first byte bitmap test, which drops most unknown tickers at once,
+// then an fnv hash into an open addressing table and one compare; no lookup
+// allocates, copies a vector or inserts
+template <typename T>
+class DispatchTable {
+ public:
+  DispatchTable() {
+    Build(std::unordered_map<std::string, std::vector<T*> >());
+  }
+
+  explicit DispatchTable(const std::unordered_map<std::string, std::vector<T*> > & m) {
+    Build(m);
+  }
+
+  ~DispatchTable() {
+  }
+
+  void Build(const std::unordered_map<std::string, std::vector<T*> > & m) {
+    keys.clear();
+    offsets.clear();
+    targets.clear();
+    for (int i = 0; i < 4; i++) {
+      first_bytes[i] = 0;
+    }
+    for (auto & it : m) {
+      if (!it.second.empty()) {
+        keys.push_back(it.first);
+      }
+    }
+    std::sort(keys.begin(), keys.end());
+    for (auto & k : keys) {
+      offsets.push_back(targets.size());
+      const std::vector<T*> & v = m.find(k)->second;
+      targets.insert(targets.end(), v.begin(), v.end());
+      unsigned char c = k.empty() ? 0 : k[0];
+      first_bytes[c >> 6] |= 1ULL << (c & 63);
+    }
+    offsets.push_back(targets.size());
+    size_t n = 8;
+    while (n < keys.size() * 2) {
+      n <<= 1;
+    }
+    mask = n - 1;
+    slots.assign(n, -1);
+    for (size_t i = 0; i < keys.size(); i++) {
+      size_t h = Hash(keys[i].c_str(), keys[i].size()) & mask;
+      while (slots[h] >= 0) {
+        h = (h + 1) & mask;
+      }
+      slots[h] = i;
+    }
+  }
+
+  // id of the key, -1 if unknown; key need not be terminated within len
+  int Id(const char* key, size_t len) const {
+    unsigned char c = len > 0 ? key[0] : 0;
+    if (!(first_bytes[c >> 6] & (1ULL << (c & 63)))) {
+      return -1;
+    }
+    for (size_t h = Hash(key, len) & mask; slots[h] >= 0; h = (h + 1) & mask) {
+      const std::string & k = keys[slots[h]];
+      if (k.size() == len && memcmp(k.data(), key, len) == 0) {
+        return slots[h];
+      }
+    }
+    return -1;
+  }
+
+  DispatchSpan<T> Of(int id) const {
+    if (id < 0) {
+      return DispatchSpan<T>{nullptr, nullptr};
+    }
+    return DispatchSpan<T>{targets.data() + offsets[id], targets.data() + offsets[id + 1]};
+  }
+
+  DispatchSpan<T> Find(const char* key, size_t len) const {
+    return Of(Id(key, len));
+  }
+
+  // a fixed size ticker field, which may fill the whole array without a terminator
+  template <size_t N>
+  DispatchSpan<T> Find(const char (&key)[N]) const {
+    return Of(Id(key, strnlen(key, N)));
+  }
+
+  const std::string & Key(int id) const {
+    return keys[id];
+  }
+
+  int Size() const {
+    return keys.size();
+  }
+
+ private:
+  static size_t Hash(const char* key, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+      h ^= static_cast<unsigned char>(key[i]);
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+  std::vector<std::string> keys;
+  std::vector<size_t> offsets;  // key i owns targets [offsets[i], offsets[i + 1])
+  std::vector<T*> targets;
+  std::vector<int> slots;
+  size_t mask;
+  uint64_t first_bytes[4];
+};
+
+#endif  // DISPATCH_TABLE_HPP_
@@ -0,0 +1,67 @@
+#ifndef INSTRUMENT_SLOTS_HPP_
+#define INSTRUMENT_SLOTS_HPP_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "struct/market_snapshot.h"
+
+// what a strategy reads of one of its instruments on every tick, resolved once
+// shot and next_shot point at the BaseStrategy map entries of the ticker: those
+// entries are only ever assigned, never erased, and nodes of an unordered_map stay
+// put, so the pointers see every update without a string hash
+// avgcost_map and position_map are cleared (ClearPositionRecord, RequestQryPos), so
+// avg costs and positions stay on the maps
+struct InstrumentSlot {
+  std::string ticker;
+  const MarketSnapshot* shot;
+  const MarketSnapshot* next_shot;
+  double mid;  // newest mid, aligned or not
+};
+
+// the instruments of one strategy in registration order, slot i is ticker i
+class InstrumentSlots {
+ public:
+  InstrumentSlots() {
+  }
+
+  ~InstrumentSlots() {
+  }
+
+  // call once all tickers are known, pointers to slots stay valid until the next Add
+  int Add(const std::string & ticker,
+          std::unordered_map<std::string, MarketSnapshot> * shot_map,
+          std::unordered_map<std::string, MarketSnapshot> * next_shot_map) {
+    InstrumentSlot s;
+    s.ticker = ticker;
+    s.shot = &(*shot_map)[ticker];
+    s.next_shot = &(*next_shot_map)[ticker];
+    s.mid = 0.0;
+    slots.push_back(s);
+    return slots.size() - 1;
+  }
+
+  InstrumentSlot* Get(int i) {
+    return &slots[i];
+  }
+
+  // a strategy has two or three instruments, comparing beats hashing
+  InstrumentSlot* Find(const std::string & ticker) {
+    for (auto & s : slots) {
+      if (s.ticker == ticker) {
+        return &s;
+      }
+    }
+    return nullptr;
+  }
+
+  size_t Size() const {
+    return slots.size();
+  }
+
+ private:
+  std::vector<InstrumentSlot> slots;
+};
+
+#endif  // INSTRUMENT_SLOTS_HPP_
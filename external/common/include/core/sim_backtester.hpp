@@ -0,0 +1,82 @@
+#ifndef SIM_BACKTESTER_HPP_
+#define SIM_BACKTESTER_HPP_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/base_strategy.h"
+#include "core/timer_wheel.hpp"
+#include "util/data_handler.hpp"
+#include "util/profiler.hpp"
+#include "util/sim_exchange.hpp"
+
+// Backtester with simulated exchanges: every shot first moves the books of the
+// exchanges and hands their infos to the strategies that own them, then the strategies
+// see the shot, so acks and fills of an order arrive from the next shot on
+// an exchange only talks to its own strategies (one per sweep variant keeps the
+// variants from trading against each other's queue)
+// the timers of TimerOwner strategies run on the shot clock: every shot first brings
+// them all up to its time, so a deadline fires even when its own tickers are quiet
+// without exchanges it is a Backtester whose callbacks show up in the Profiler
+class SimBacktester : public DataHandler<MarketSnapshot> {
+ public:
+  explicit SimBacktester(const std::unordered_map<std::string, std::vector<BaseStrategy*> > & m)
+    : tsm(m),
+      timers(DriveTimers(m)),
+      update_data("UpdateData"),
+      update_exchange_info("UpdateExchangeInfo") {
+  }
+
+  ~SimBacktester() {
+  }
+
+  // owners: ticker -> strategies, as filled by the strategy constructors
+  void AddExchange(SimExchange* exchange, const std::unordered_map<std::string, std::vector<BaseStrategy*> >* owners) {
+    routes.push_back(Route{exchange, owners});
+  }
+
+  void HandleShot(MarketSnapshot* this_shot, MarketSnapshot* next_shot) override {
+    if (!this_shot->IsGood()) {
+      return;
+    }
+    AdvanceTimers(timers, TimerNs(this_shot->time));
+    bool profile = Profiler::On();
+    for (auto & r : routes) {
+      r.exchange->OnShot(*this_shot);
+      const std::unordered_map<std::string, std::vector<BaseStrategy*> >* owners = r.owners;
+      r.exchange->Deliver([this, owners, profile](const ExchangeInfo & info) {
+        auto it = owners->find(info.ticker);
+        if (it == owners->end()) {
+          return;
+        }
+        for (auto s : it->second) {
+          ScopedProfile prof(profile ? update_exchange_info.Of(s) : nullptr);
+          s->UpdateExchangeInfo(info);
+        }
+      });
+    }
+    auto it = tsm.find(this_shot->ticker);
+    if (it == tsm.end()) {
+      return;
+    }
+    for (auto s : it->second) {
+      ScopedProfile prof(profile ? update_data.Of(s) : nullptr);
+      s->UpdateData(*this_shot, *next_shot);
+    }
+  }
+
+ private:
+  struct Route {
+    SimExchange* exchange;
+    const std::unordered_map<std::string, std::vector<BaseStrategy*> >* owners;
+  };
+
+  const std::unordered_map<std::string, std::vector<BaseStrategy*> > & tsm;
+  std::vector<Route> routes;
+  std::vector<TimerWheel*> timers;
+  CallbackProfile update_data;
+  CallbackProfile update_exchange_info;
+};
+
+#endif  // SIM_BACKTESTER_HPP_
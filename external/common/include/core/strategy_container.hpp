@@ -1,85 +1,408 @@
 #ifndef STRATEGY_CONTAINER_HPP_
 #define STRATEGY_CONTAINER_HPP_
 
+#include <string.h>
+
+#include <algorithm>
 #include <thread>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <iostream>
+#include <memory>
 #include <string>
 
 #include "core/base_strategy.h"
+#include "core/dispatch_table.hpp"
+#include "core/timer_wheel.hpp"
+#include "util/profiler.hpp"
+#include "util/spsc_queue.hpp"
+#include "util/async_log.hpp"
+#include "util/thread_config.hpp"
 #include "util/zmq_recver.hpp"
 #include "util/shm_recver.hpp"
 
 using namespace std;
 
+#define SHARD_DATA_QUEUE 16384
+#define SHARD_INFO_QUEUE 4096
+#define SHARD_COMMAND_QUEUE 256
+// a conflating shard logs its dropped snapshots once every this many
+#define SHARD_DROP_LOG 10000
+
 // template<template<typename> typename T>
 // template<template<class K> T>
+// shards > 0 runs the strategies on that many worker threads, each strategy on one of
+// them, pinned to cpus[i % cpus.size()] when cpus are given; the listener threads then
+// only route into an spsc queue per worker and stream, so a slow strategy holds up
+// its own shard alone and every strategy still sees its events in arrival order;
+// a shard whose snapshot queue is full skips to the latest snapshot of each ticker
+// shards = 0 calls the strategies from the listener threads
+// the ticker routing is frozen into dispatch tables when the container is built, so
+// strategies must all be constructed before; a ticker nobody trades is dropped
+// the timers of TimerOwner strategies run on the wall clock, on their shard, or
+// without shards on the market data listener before each snapshot, so they fire on
+// the thread that calls UpdateData
 template<template<typename> class T>
 class StrategyContainer {
  public:
-  StrategyContainer(unordered_map<string, vector<BaseStrategy*> > &m)
+  StrategyContainer(unordered_map<string, vector<BaseStrategy*> > &m, int shards = 0, const vector<int> & cpus = vector<int>())
     : m(m),
+      cpus(cpus),
       marketdata_recver(new T<MarketSnapshot>("data_recver")),
       exchangeinfo_recver(new T<ExchangeInfo>("exchange_info")),
       command_recver(new ZmqRecver<Command>("*:33334", "tcp", "bind")) {
-
+    if (shards > 0) {
+      MakeShards(shards);
+    } else {
+      strategies.Build(m);
+      timers = DriveTimers(m);
+    }
 }
   // explicit StrategyContainer(const StrategyContainer& sc) {}  // unable copy constructor
   // explicit StrategyContainer(StrategyContainer && sc) {}  // unable move constructor
   virtual ~StrategyContainer() {
   }
   void Start() {
-    thread command_thread(RunCommandListener, std::ref(m), command_recver.get());
-    thread exchangeinfo_thread(RunExchangeListener, std::ref(m), exchangeinfo_recver.get());
-    thread marketdata_thread(RunMarketDataListener, std::ref(m), marketdata_recver.get());
+    if (!shards.empty()) {
+      StartShards();
+      return;
+    }
+    thread command_thread(RunCommandListener, std::cref(strategies), command_recver.get());
+    thread exchangeinfo_thread(RunExchangeListener, std::cref(strategies), exchangeinfo_recver.get());
+    thread marketdata_thread(RunMarketDataListener, std::cref(strategies), std::cref(timers), marketdata_recver.get());
     command_thread.join();
     exchangeinfo_thread.join();
     marketdata_thread.join();
   }
  private:
-  static void RunCommandListener(unordered_map<string, vector<BaseStrategy*> > &m, ZmqRecver<Command>* command_recver) {
+  typedef DispatchTable<BaseStrategy> Strategies;
+
+  // a command goes to the strategy named before the first '|' of its ticker
+  static size_t CommandKey(const Command & c) {
+    size_t n = strnlen(c.ticker, sizeof(c.ticker));
+    const char* bar = static_cast<const char*>(memchr(c.ticker, '|', n));
+    return bar ? bar - c.ticker : n;
+  }
+
+  static bool IsKey(const Command & c, size_t len, const char* key) {
+    return len == strlen(key) && memcmp(c.ticker, key, len) == 0;
+  }
+
+  // the commands the container answers itself, true when c was one
+  static bool HandleOwnCommand(const Command & c, size_t len) {
+    if (IsKey(c, len, "load_history")) {
+      // Load_history("mid.dat");
+      return true;
+    }
+    // callback timings so far, the same table a backtest writes to profile.txt
+    if (IsKey(c, len, "profile")) {
+      Profiler::Instance().Print(stdout);
+      return true;
+    }
+    if (IsKey(c, len, "profile_reset")) {
+      Profiler::Instance().Reset();
+      return true;
+    }
+    return false;
+  }
+
+  static void RunCommandListener(const Strategies & strategies, ZmqRecver<Command>* command_recver) {
+    ThreadConfig::Instance().Apply("command_listener");
     while (true) {
       Command shot;
       command_recver->Recv(shot);
-      printf("command recved!\n");
-      shot.Show(stdout);
-      string ticker = Split(shot.ticker, "|").front();
-      if (ticker == "load_history") {
-        // Load_history("mid.dat");
+      LOG_INFO("command recved!\n");
+      LOG_SHOW(LOG_INFO_LEVEL, shot);
+      size_t len = CommandKey(shot);
+      if (HandleOwnCommand(shot, len)) {
         continue;
       }
-      vector<BaseStrategy*> sv = m[ticker];
-      for (auto v : sv) {
+      for (auto v : strategies.Find(shot.ticker, len)) {
         v->HandleCommand(shot);
       }
     }
   }
 
-  static void RunExchangeListener(unordered_map<string, vector<BaseStrategy*> > &m, T<ExchangeInfo>* exchangeinfo_recver) {
+  static void RunExchangeListener(const Strategies & strategies, T<ExchangeInfo>* exchangeinfo_recver) {
+    ThreadConfig::Instance().Apply("exchange_listener");
+    CallbackProfile update_exchange_info("UpdateExchangeInfo");
     while (true) {
       ExchangeInfo info;
       exchangeinfo_recver->Recv(info);
-      info.Show(stdout);
-      std::vector<BaseStrategy*> sv = m[info.ticker];
-      for (auto v : sv) {
+      LOG_SHOW(LOG_INFO_LEVEL, info);
+      bool profile = Profiler::On();
+      for (auto v : strategies.Find(info.ticker)) {
+        ScopedProfile prof(profile ? update_exchange_info.Of(v) : nullptr);
         v->UpdateExchangeInfo(info);
       }
     }
   }
 
-  static void RunMarketDataListener(unordered_map<string, vector<BaseStrategy*> > &m, T<MarketSnapshot> * marketdata_recver) {
+  static void RunMarketDataListener(const Strategies & strategies, const vector<TimerWheel*> & timers, T<MarketSnapshot> * marketdata_recver) {
+    ThreadConfig::Instance().Apply("md_listener");
+    CallbackProfile update_data("UpdateData");
     while (true) {
       MarketSnapshot shot;
       marketdata_recver->Recv(shot);
-      auto sv = m[shot.ticker];
-      for (auto s : sv) {
+      if (!timers.empty()) {
+        AdvanceTimers(timers, WallNs());
+      }
+      bool profile = Profiler::On();
+      for (auto s : strategies.Find(shot.ticker)) {
+        ScopedProfile prof(profile ? update_data.Of(s) : nullptr);
         s->UpdateData(shot);
       }
     }
   }
 
+  struct Shard {
+    int id;
+    int cpu;
+    Strategies strategies;  // this shard's part of m
+    SpscQueue<MarketSnapshot> data;
+    SpscQueue<ExchangeInfo> info;
+    SpscQueue<Command> command;
+    vector<TimerWheel*> timers;
+    // router side: while data is full the newest snapshot per ticker waits here, in
+    // arrival order; a newer one drops the older of its ticker and goes to the back
+    vector<MarketSnapshot> backlog;
+    unordered_map<string, size_t> backlog_index;
+    long long dropped;
+
+    Shard(int id, int cpu)
+      : id(id),
+        cpu(cpu),
+        data(SHARD_DATA_QUEUE),
+        info(SHARD_INFO_QUEUE),
+        command(SHARD_COMMAND_QUEUE),
+        dropped(0) {
+    }
+  };
+  typedef DispatchTable<Shard> Routes;
+
+  // strategies are dealt round robin in ticker order, so a restart shards the same way
+  void MakeShards(int n) {
+    vector<string> tickers;
+    for (auto & it : m) {
+      tickers.push_back(it.first);
+    }
+    sort(tickers.begin(), tickers.end());
+    unordered_map<BaseStrategy*, int> owner;
+    for (auto & ticker : tickers) {
+      for (auto s : m[ticker]) {
+        if (owner.find(s) == owner.end()) {
+          int id = owner.size();
+          owner[s] = id;
+        }
+      }
+    }
+    n = std::max(1, std::min(n, static_cast<int>(owner.size())));
+    for (int i = 0; i < n; i++) {
+      shards.emplace_back(new Shard(i, cpus.empty() ? -1 : cpus[i % cpus.size()]));
+    }
+    vector<unordered_map<string, vector<BaseStrategy*> > > shard_m(n);
+    unordered_map<string, vector<Shard*> > route_m;
+    for (auto & ticker : tickers) {
+      unordered_set<Shard*> seen;
+      for (auto s : m[ticker]) {
+        int i = owner[s] % n;
+        shard_m[i][ticker].push_back(s);
+        if (seen.insert(shards[i].get()).second) {
+          route_m[ticker].push_back(shards[i].get());
+        }
+      }
+    }
+    for (int i = 0; i < n; i++) {
+      shards[i]->strategies.Build(shard_m[i]);
+      shards[i]->timers = DriveTimers(shard_m[i]);
+    }
+    routes.Build(route_m);
+    printf("%zu strategies on %d shards\n", owner.size(), n);
+  }
+
+  void StartShards() {
+    vector<thread> workers;
+    for (auto & s : shards) {
+      workers.emplace_back(RunShard, s.get());
+    }
+    thread command_thread(RouteCommands, std::cref(routes), command_recver.get());
+    thread exchangeinfo_thread(RouteExchangeInfo, std::cref(routes), exchangeinfo_recver.get());
+    thread marketdata_thread(RouteMarketData, std::cref(routes), marketdata_recver.get());
+    command_thread.join();
+    exchangeinfo_thread.join();
+    marketdata_thread.join();
+    for (auto & w : workers) {
+      w.join();
+    }
+  }
+
+  static void RouteCommands(const Routes & routes, ZmqRecver<Command>* command_recver) {
+    ThreadConfig::Instance().Apply("command_listener");
+    while (true) {
+      Command shot;
+      command_recver->Recv(shot);
+      LOG_INFO("command recved!\n");
+      LOG_SHOW(LOG_INFO_LEVEL, shot);
+      size_t len = CommandKey(shot);
+      if (HandleOwnCommand(shot, len)) {
+        continue;
+      }
+      for (auto s : routes.Find(shot.ticker, len)) {
+        s->command.Push(shot);
+      }
+    }
+  }
+
+  static void RouteExchangeInfo(const Routes & routes, T<ExchangeInfo>* exchangeinfo_recver) {
+    ThreadConfig::Instance().Apply("exchange_listener");
+    while (true) {
+      ExchangeInfo info;
+      exchangeinfo_recver->Recv(info);
+      LOG_SHOW(LOG_INFO_LEVEL, info);
+      for (auto s : routes.Find(info.ticker)) {
+        s->info.Push(info);
+      }
+    }
+  }
+
+  // fills and commands wait for room, they are few and none may be lost; snapshots
+  // never block the router, a shard that falls behind gets the latest one per ticker
+  // while a shard has a backlog the router polls, and drains it between snapshots
+  static void RouteMarketData(const Routes & routes, T<MarketSnapshot> * marketdata_recver) {
+    ThreadConfig::Instance().Apply("md_listener");
+    vector<Shard*> behind;
+    int idle = 0;
+    while (true) {
+      MarketSnapshot shot;
+      if (behind.empty()) {
+        marketdata_recver->Recv(shot);
+      } else if (!marketdata_recver->TryRecv(shot)) {
+        FlushBacklogs(&behind);
+        if (++idle < SPSC_SPIN) {
+          CpuRelax();
+        } else {
+          std::this_thread::yield();
+        }
+        continue;
+      }
+      idle = 0;
+      for (auto s : routes.Find(shot.ticker)) {
+        RouteShot(s, shot);
+        if (!s->backlog.empty() && std::find(behind.begin(), behind.end(), s) == behind.end()) {
+          behind.push_back(s);
+        }
+      }
+    }
+  }
+
+  // the backlog goes first, so snapshots stay in arrival order
+  static void RouteShot(Shard* s, const MarketSnapshot & shot) {
+    if (!s->backlog.empty()) {
+      FlushBacklog(s);
+    }
+    if (s->backlog.empty() && s->data.TryPush(shot)) {
+      return;
+    }
+    auto it = s->backlog_index.find(shot.ticker);
+    if (it != s->backlog_index.end()) {
+      // the older snapshot of the ticker is dropped, the newer one queues at the back
+      size_t i = it->second;
+      s->backlog.erase(s->backlog.begin() + i);
+      IndexBacklog(s, i);
+      if (s->dropped++ % SHARD_DROP_LOG == 0) {
+        LOG_ERROR("shard%d falls behind, %lld snapshots dropped, %zu tickers waiting\n", s->id, s->dropped, s->backlog.size() + 1);
+      }
+    }
+    s->backlog_index[shot.ticker] = s->backlog.size();
+    s->backlog.push_back(shot);
+  }
+
+  static void FlushBacklog(Shard* s) {
+    size_t n = 0;
+    while (n < s->backlog.size() && s->data.TryPush(s->backlog[n])) {
+      n++;
+    }
+    if (n == 0) {
+      return;
+    }
+    for (size_t i = 0; i < n; i++) {
+      s->backlog_index.erase(s->backlog[i].ticker);
+    }
+    s->backlog.erase(s->backlog.begin(), s->backlog.begin() + n);
+    IndexBacklog(s, 0);
+  }
+
+  // the positions from i on
+  static void IndexBacklog(Shard* s, size_t i) {
+    for (; i < s->backlog.size(); i++) {
+      s->backlog_index[s->backlog[i].ticker] = i;
+    }
+  }
+
+  static void FlushBacklogs(vector<Shard*>* behind) {
+    for (size_t i = behind->size(); i-- > 0;) {
+      FlushBacklog((*behind)[i]);
+      if ((*behind)[i]->backlog.empty()) {
+        behind->erase(behind->begin() + i);
+      }
+    }
+  }
+
+  // fills and commands go before the next snapshot, the worker spins while idle
+  // and yields after SPSC_SPIN empty rounds; due timers run first in every round
+  static void RunShard(Shard* s) {
+    // a shard<i> entry in the threads config wins over the shards cpus
+    ThreadConfig::Instance().Apply("shard" + std::to_string(s->id), s->cpu);
+    CallbackProfile update_data("UpdateData");
+    CallbackProfile update_exchange_info("UpdateExchangeInfo");
+    Command command;
+    ExchangeInfo info;
+    MarketSnapshot shot;
+    int idle = 0;
+    while (true) {
+      if (!s->timers.empty()) {
+        AdvanceTimers(s->timers, WallNs());
+      }
+      bool busy = false;
+      while (s->command.TryPop(&command)) {
+        busy = true;
+        for (auto v : s->strategies.Find(command.ticker, CommandKey(command))) {
+          v->HandleCommand(command);
+        }
+      }
+      while (s->info.TryPop(&info)) {
+        busy = true;
+        bool profile = Profiler::On();
+        for (auto v : s->strategies.Find(info.ticker)) {
+          ScopedProfile prof(profile ? update_exchange_info.Of(v) : nullptr);
+          v->UpdateExchangeInfo(info);
+        }
+      }
+      if (s->data.TryPop(&shot)) {
+        busy = true;
+        bool profile = Profiler::On();
+        for (auto v : s->strategies.Find(shot.ticker)) {
+          ScopedProfile prof(profile ? update_data.Of(v) : nullptr);
+          v->UpdateData(shot);
+        }
+      }
+      if (busy) {
+        idle = 0;
+      } else if (++idle < SPSC_SPIN) {
+        CpuRelax();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
   unordered_map<string, vector<BaseStrategy*> > &m;
+  vector<int> cpus;
+  Strategies strategies;
+  vector<TimerWheel*> timers;  // without shards
+  vector<unique_ptr<Shard> > shards;
+  Routes routes;
   unique_ptr<T<MarketSnapshot> > marketdata_recver;
   unique_ptr<T<ExchangeInfo> > exchangeinfo_recver;
   unique_ptr<ZmqRecver<Command> > command_recver;
@@ -0,0 +1,399 @@
+#ifndef TIMER_WHEEL_HPP_
+#define TIMER_WHEEL_HPP_
+
+#include <stdint.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 11  // 11 * 6 bits cover every tick an int64 holds
+#define TIMER_WHEEL_TICK_NS 1000000
+
+// 0 is no timer
+typedef uint64_t TimerId;
+
+inline int64_t TimerNs(const timeval & t) {
+  return static_cast<int64_t>(t.tv_sec) * 1000000000LL + static_cast<int64_t>(t.tv_usec) * 1000LL;
+}
+
+inline int64_t WallNs() {
+  timespec t;
+  clock_gettime(CLOCK_REALTIME, &t);
+  return static_cast<int64_t>(t.tv_sec) * 1000000000LL + t.tv_nsec;
+}
+
+// callbacks at a time of the clock that drives the wheel: wall time live, shot time
+// in a backtest; a timer never fires before its time and at most a tick after the
+// Advance that passes it
+// levels of 64 slots, a timer sits on the level of the highest tick digit where it
+// differs from now, and moves down a level when now reaches its slot; schedule,
+// cancel and firing are O(1), an Advance over a quiet gap jumps straight to the next
+// occupied slot, found from the per level bitmaps
+// not thread safe: schedule, cancel and advance on the thread that runs the owner
+class TimerWheel {
+ public:
+  explicit TimerWheel(int64_t tick_ns = TIMER_WHEEL_TICK_NS)
+    : tick_ns(std::max<int64_t>(tick_ns, 1)),
+      now_ns(0),
+      now_tick(0),
+      next_tick(INT64_MAX),
+      free_head(-1),
+      pending(0) {
+    heads.assign(TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS + 1, -1);
+    for (int i = 0; i < TIMER_WHEEL_LEVELS; i++) {
+      bitmap[i] = 0;
+    }
+  }
+
+  ~TimerWheel() {
+  }
+
+  // fn runs once, on the first Advance to at_ns or later
+  TimerId At(int64_t at_ns, const std::function<void()> & fn) {
+    return Add(Tick(at_ns), 0, fn);
+  }
+
+  // in and every count from Now(), the time of the last Advance; before the clock
+  // has started use At
+  TimerId In(int64_t delay_ns, const std::function<void()> & fn) {
+    return Add(Tick(now_ns + delay_ns), 0, fn);
+  }
+
+  // fn runs every period_ns; an Advance late by several periods runs it once
+  TimerId Every(int64_t period_ns, const std::function<void()> & fn) {
+    int64_t period = std::max<int64_t>(Tick(period_ns), 1);
+    return Add(now_tick + period, period, fn);
+  }
+
+  // false when id already fired or was cancelled; a periodic timer may cancel
+  // itself from its callback
+  bool Cancel(TimerId id) {
+    int i = Index(id);
+    if (i < 0) {
+      return false;
+    }
+    if (nodes[i].list >= 0) {
+      Unlink(i);
+    }
+    Free(i);
+    return true;
+  }
+
+  bool Pending(TimerId id) const {
+    return Index(id) >= 0;
+  }
+
+  // runs the timers due by t in time order and returns how many ran; a clock that
+  // goes back moves nothing
+  int Advance(int64_t t) {
+    int64_t target = now_tick;
+    if (t > now_ns) {
+      target = t / tick_ns;
+    }
+    int fired = 0;
+    while (true) {
+      fired += RunDue();
+      if (next_tick > target) {
+        break;
+      }
+      now_tick = next_tick;
+      now_ns = std::max(now_ns, now_tick * tick_ns);
+      Cascade();
+      next_tick = NextTick();
+    }
+    now_tick = target;
+    now_ns = std::max(now_ns, t);
+    return fired;
+  }
+
+  int64_t Now() const {
+    return now_ns;
+  }
+
+  // no timer is due before this, INT64_MAX with none pending
+  int64_t NextDue() const {
+    if (next_tick == INT64_MAX) {
+      return INT64_MAX;
+    }
+    return std::max(now_ns, next_tick * tick_ns);
+  }
+
+  int Size() const {
+    return pending;
+  }
+
+ private:
+  enum {
+    kFree = -1,
+    kFiring = -2,
+    kDue = TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS
+  };
+
+  struct Node {
+    int64_t tick;
+    int64_t period;  // in ticks, 0 for once
+    uint32_t gen;
+    int list;  // level * TIMER_WHEEL_SLOTS + slot, kDue, kFiring or kFree
+    int prev;
+    int next;
+    std::function<void()> fn;
+  };
+
+  // the first tick at or after ns, so a timer is never early
+  int64_t Tick(int64_t ns) const {
+    return ns <= 0 ? 0 : (ns + tick_ns - 1) / tick_ns;
+  }
+
+  static int Digit(int64_t tick, int level) {
+    return (tick >> (level * TIMER_WHEEL_BITS)) & (TIMER_WHEEL_SLOTS - 1);
+  }
+
+  // tick with the digits from level down cleared
+  static int64_t Base(int64_t tick, int level) {
+    int shift = (level + 1) * TIMER_WHEEL_BITS;
+    return shift >= 63 ? 0 : (tick >> shift) << shift;
+  }
+
+  int Index(TimerId id) const {
+    int64_t i = static_cast<int64_t>(id & 0xffffffffULL) - 1;
+    if (i < 0 || i >= static_cast<int64_t>(nodes.size())) {
+      return -1;
+    }
+    const Node & n = nodes[i];
+    return n.list != kFree && n.gen == (id >> 32) ? i : -1;
+  }
+
+  TimerId Add(int64_t tick, int64_t period, const std::function<void()> & fn) {
+    int i = free_head;
+    if (i >= 0) {
+      free_head = nodes[i].next;
+    } else {
+      i = nodes.size();
+      nodes.push_back(Node());
+      nodes[i].gen = 1;
+    }
+    Node & n = nodes[i];
+    n.tick = tick;
+    n.period = period;
+    n.fn = fn;
+    pending++;
+    Place(i);
+    return (static_cast<TimerId>(n.gen) << 32) | static_cast<TimerId>(i + 1);
+  }
+
+  void Place(int i) {
+    int64_t tick = nodes[i].tick;
+    if (tick <= now_tick) {
+      Link(i, kDue);
+      next_tick = std::min(next_tick, now_tick);
+      return;
+    }
+    int level = (63 - __builtin_clzll(static_cast<uint64_t>(tick ^ now_tick))) / TIMER_WHEEL_BITS;
+    int slot = Digit(tick, level);
+    Link(i, level * TIMER_WHEEL_SLOTS + slot);
+    next_tick = std::min(next_tick, Base(now_tick, level) | (static_cast<int64_t>(slot) << (level * TIMER_WHEEL_BITS)));
+  }
+
+  void Link(int i, int list) {
+    Node & n = nodes[i];
+    n.list = list;
+    n.prev = -1;
+    n.next = heads[list];
+    if (n.next >= 0) {
+      nodes[n.next].prev = i;
+    }
+    heads[list] = i;
+    if (list < kDue) {
+      bitmap[list / TIMER_WHEEL_SLOTS] |= 1ULL << (list % TIMER_WHEEL_SLOTS);
+    }
+  }
+
+  void Unlink(int i) {
+    Node & n = nodes[i];
+    if (n.prev >= 0) {
+      nodes[n.prev].next = n.next;
+    } else {
+      heads[n.list] = n.next;
+    }
+    if (n.next >= 0) {
+      nodes[n.next].prev = n.prev;
+    }
+    if (heads[n.list] < 0 && n.list < kDue) {
+      bitmap[n.list / TIMER_WHEEL_SLOTS] &= ~(1ULL << (n.list % TIMER_WHEEL_SLOTS));
+    }
+    n.list = kFiring;
+  }
+
+  void Free(int i) {
+    Node & n = nodes[i];
+    n.fn = nullptr;
+    n.gen++;
+    n.list = kFree;
+    n.next = free_head;
+    free_head = i;
+    pending--;
+  }
+
+  // the slots now has just reached: their timers go a level down, or to due
+  void Cascade() {
+    for (int level = TIMER_WHEEL_LEVELS - 1; level >= 0; level--) {
+      if (level > 0 && (now_tick & ((1LL << (level * TIMER_WHEEL_BITS)) - 1)) != 0) {
+        continue;
+      }
+      int list = level * TIMER_WHEEL_SLOTS + Digit(now_tick, level);
+      while (heads[list] >= 0) {
+        int i = heads[list];
+        Unlink(i);
+        Place(i);
+      }
+    }
+  }
+
+  // every slot in use lies after now's digit on its level, and a lower level's next
+  // slot comes before any higher level's
+  int64_t NextTick() const {
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+      int d = Digit(now_tick, level);
+      uint64_t later = d == TIMER_WHEEL_SLOTS - 1 ? 0 : bitmap[level] & (~0ULL << (d + 1));
+      if (later) {
+        return Base(now_tick, level) | (static_cast<int64_t>(__builtin_ctzll(later)) << (level * TIMER_WHEEL_BITS));
+      }
+    }
+    return INT64_MAX;
+  }
+
+  // the callbacks may schedule and cancel, nodes can move, so nothing is held across one
+  int RunDue() {
+    int fired = 0;
+    while (heads[kDue] >= 0) {
+      int i = heads[kDue];
+      Unlink(i);
+      fired++;
+      std::function<void()> fn;
+      fn.swap(nodes[i].fn);
+      if (nodes[i].period == 0) {
+        Free(i);
+        fn();
+        continue;
+      }
+      uint32_t gen = nodes[i].gen;
+      fn();
+      if (nodes[i].list != kFiring || nodes[i].gen != gen) {
+        continue;  // cancelled by its callback
+      }
+      Node & n = nodes[i];
+      n.fn.swap(fn);
+      n.tick += ((now_tick - n.tick) / n.period + 1) * n.period;
+      Place(i);
+    }
+    return fired;
+  }
+
+  int64_t tick_ns;
+  int64_t now_ns;
+  int64_t now_tick;
+  int64_t next_tick;  // no slot is due before it, it may be early after a cancel
+  std::vector<Node> nodes;
+  std::vector<int> heads;  // per level and slot, then the due list
+  uint64_t bitmap[TIMER_WHEEL_LEVELS];  // slots in use per level
+  int free_head;
+  int pending;
+};
+
+// a strategy with timers; the loop that calls the strategy advances them, so the
+// callbacks run on the strategy's own thread, between its other callbacks
+// a loop that does not advance them (libnick's Backtester) leaves TimersDriven()
+// false; a strategy whose trading depends on a timer says so with UsesTimers(), so
+// the backtest picks a loop that drives it whatever else is switched on
+class TimerOwner {
+ public:
+  TimerOwner()
+    : timers_driven(false) {
+  }
+
+  virtual ~TimerOwner() {
+  }
+
+  TimerWheel & Timers() {
+    return timers;
+  }
+
+  virtual bool UsesTimers() const {
+    return false;
+  }
+
+  bool TimersDriven() const {
+    return timers_driven;
+  }
+
+  void SetTimersDriven() {
+    timers_driven = true;
+  }
+
+ protected:
+  TimerWheel timers;
+
+ private:
+  bool timers_driven;
+};
+
+// the strategies in m that own timers, each once, in ticker order
+template <typename S>
+std::vector<TimerOwner*> TimerOwnersOf(const std::unordered_map<std::string, std::vector<S*> > & m) {
+  std::vector<std::string> tickers;
+  for (auto & it : m) {
+    tickers.push_back(it.first);
+  }
+  std::sort(tickers.begin(), tickers.end());
+  std::vector<TimerOwner*> owners;
+  std::unordered_set<TimerOwner*> seen;
+  for (auto & ticker : tickers) {
+    for (auto s : m.find(ticker)->second) {
+      TimerOwner* owner = dynamic_cast<TimerOwner*>(s);
+      if (owner && seen.insert(owner).second) {
+        owners.push_back(owner);
+      }
+    }
+  }
+  return owners;
+}
+
+// true when a strategy in m needs its timers driven
+template <typename S>
+bool TimersUsed(const std::unordered_map<std::string, std::vector<S*> > & m) {
+  for (auto owner : TimerOwnersOf(m)) {
+    if (owner->UsesTimers() || owner->Timers().Size() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// for the loop that advances them: marks the strategies in m as driven and returns
+// their wheels
+template <typename S>
+std::vector<TimerWheel*> DriveTimers(const std::unordered_map<std::string, std::vector<S*> > & m) {
+  std::vector<TimerWheel*> wheels;
+  for (auto owner : TimerOwnersOf(m)) {
+    owner->SetTimersDriven();
+    wheels.push_back(&owner->Timers());
+  }
+  return wheels;
+}
+
+// every wheel moves, due or not, so In and Every count from the loop's time
+inline void AdvanceTimers(const std::vector<TimerWheel*> & wheels, int64_t now) {
+  for (auto w : wheels) {
+    w->Advance(now);
+  }
+}
+
+#endif  // TIMER_WHEEL_HPP_
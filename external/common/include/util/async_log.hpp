@@ -0,0 +1,705 @@
+#ifndef ASYNC_LOG_HPP_
+#define ASYNC_LOG_HPP_
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <libconfig.h++>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "struct/command.h"
+#include "struct/exchange_info.h"
+#include "struct/market_snapshot.h"
+#include "struct/order.h"
+
+#define LOG_DEBUG_LEVEL 0
+#define LOG_INFO_LEVEL 1
+#define LOG_WARN_LEVEL 2
+#define LOG_ERROR_LEVEL 3
+
+// calls below this level are compiled out, -DLOG_MIN_LEVEL=1 drops LOG_DEBUG
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_DEBUG_LEVEL
+#endif
+
+#define LOG_RING_BYTES (1 << 20)
+#define LOG_MAX_RECORD 65536
+#define LOG_IDLE_US 200
+#define LOG_MAGIC "HFTLOG1\n"
+
+// a printf style call site, registered once: the format, where it is and the type
+// codes of its arguments ('i' signed, 'u' unsigned, 'd' double, 'c' char, 's' string,
+// 'p' pointer); an object site logs a struct and formats it with its Show
+struct LogSite {
+  int id;
+  int level;
+  std::string file;
+  int line;
+  std::string fmt;
+  std::string types;
+  std::string object;
+};
+
+// the structs an object site can carry, by name, so the decoder can show them too
+template <typename T>
+struct LogObject;
+
+#define LOG_OBJECT(T) \
+  template <> \
+  struct LogObject<T> { \
+    static const char* Name() { \
+      return #T; \
+    } \
+  };
+LOG_OBJECT(Order)
+LOG_OBJECT(ExchangeInfo)
+LOG_OBJECT(MarketSnapshot)
+LOG_OBJECT(Command)
+#undef LOG_OBJECT
+
+// shows a logged struct, false for a name this build does not know
+inline bool ShowLogObject(const std::string & name, const char* data, size_t size, FILE* f) {
+#define LOG_SHOW_AS(T) \
+  if (name == #T && size == sizeof(T)) { \
+    T obj; \
+    memcpy(&obj, data, sizeof(T)); \
+    obj.Show(f); \
+    return true; \
+  }
+  LOG_SHOW_AS(Order)
+  LOG_SHOW_AS(ExchangeInfo)
+  LOG_SHOW_AS(MarketSnapshot)
+  LOG_SHOW_AS(Command)
+#undef LOG_SHOW_AS
+  return false;
+}
+
+// type codes and encoding of one argument
+inline char LogTypeOf(const char*) {
+  return 's';
+}
+
+inline char LogTypeOf(char*) {
+  return 's';
+}
+
+inline char LogTypeOf(const std::string &) {
+  return 's';
+}
+
+template <typename T>
+inline char LogTypeOf(const T &) {
+  return std::is_same<T, char>::value ? 'c' :
+         std::is_floating_point<T>::value ? 'd' :
+         std::is_pointer<T>::value ? 'p' :
+         std::is_unsigned<T>::value ? 'u' : 'i';
+}
+
+inline size_t LogSizeOf(const char* s) {
+  return sizeof(uint32_t) + (s ? strlen(s) : 0);
+}
+
+inline size_t LogSizeOf(char* s) {
+  return LogSizeOf(static_cast<const char*>(s));
+}
+
+inline size_t LogSizeOf(const std::string & s) {
+  return sizeof(uint32_t) + s.size();
+}
+
+template <typename T>
+inline size_t LogSizeOf(const T &) {
+  return sizeof(int64_t);
+}
+
+inline char* LogPut(char* p, const char* s) {
+  uint32_t n = s ? strlen(s) : 0;
+  memcpy(p, &n, sizeof(n));
+  memcpy(p + sizeof(n), s, n);
+  return p + sizeof(n) + n;
+}
+
+inline char* LogPut(char* p, char* s) {
+  return LogPut(p, static_cast<const char*>(s));
+}
+
+inline char* LogPut(char* p, const std::string & s) {
+  uint32_t n = s.size();
+  memcpy(p, &n, sizeof(n));
+  memcpy(p + sizeof(n), s.data(), n);
+  return p + sizeof(n) + n;
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value, char*>::type LogPut(char* p, const T & v) {
+  double d = v;
+  memcpy(p, &d, sizeof(d));
+  return p + sizeof(d);
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_pointer<T>::value, char*>::type LogPut(char* p, const T & v) {
+  int64_t i = reinterpret_cast<intptr_t>(v);
+  memcpy(p, &i, sizeof(i));
+  return p + sizeof(i);
+}
+
+template <typename T>
+inline typename std::enable_if<!std::is_floating_point<T>::value && !std::is_pointer<T>::value, char*>::type LogPut(char* p, const T & v) {
+  int64_t i = static_cast<int64_t>(v);
+  memcpy(p, &i, sizeof(i));
+  return p + sizeof(i);
+}
+
+inline void LogTypes(std::string*) {
+}
+
+template <typename A, typename... Args>
+inline void LogTypes(std::string* types, const A & a, const Args &... args) {
+  types->push_back(LogTypeOf(a));
+  LogTypes(types, args...);
+}
+
+inline size_t LogSize() {
+  return 0;
+}
+
+template <typename A, typename... Args>
+inline size_t LogSize(const A & a, const Args &... args) {
+  return LogSizeOf(a) + LogSize(args...);
+}
+
+inline char* LogPutAll(char* p) {
+  return p;
+}
+
+template <typename A, typename... Args>
+inline char* LogPutAll(char* p, const A & a, const Args &... args) {
+  return LogPutAll(LogPut(p, a), args...);
+}
+
+// printf of an encoded argument list by the site's format; the conversions are
+// rebuilt for the stored types, so "%d" of a long or "%lf" of a float print right
+inline void LogFormat(const LogSite & site, const char* args, size_t len, std::string* out) {
+  const char* f = site.fmt.c_str();
+  const char* end = args + len;
+  size_t arg = 0;
+  char buf[512];
+  char spec[64];
+  while (*f) {
+    if (*f != '%') {
+      const char* next = strchr(f, '%');
+      size_t n = next ? static_cast<size_t>(next - f) : strlen(f);
+      out->append(f, n);
+      f += n;
+      continue;
+    }
+    if (f[1] == '%') {
+      out->push_back('%');
+      f += 2;
+      continue;
+    }
+    // %[flags][width][.precision][length]conversion, the length is replaced
+    const char* start = f++;
+    while (*f && strchr("-+ #0", *f)) {
+      f++;
+    }
+    while (*f && (isdigit(*f) || *f == '.')) {
+      f++;
+    }
+    size_t head = f - start;
+    while (*f && strchr("hlLqjzt", *f)) {
+      f++;
+    }
+    char conv = *f ? *f++ : 's';
+    if (head > sizeof(spec) - 4 || arg >= site.types.size()) {
+      out->append(start, f - start);
+      continue;
+    }
+    char type = site.types[arg++];
+    memcpy(spec, start, head);
+    if (type == 's') {
+      uint32_t n = 0;
+      if (args + sizeof(n) <= end) {
+        memcpy(&n, args, sizeof(n));
+        args += sizeof(n);
+      }
+      n = std::min<size_t>(n, end - args);
+      std::string s(args, n);
+      args += n;
+      if (conv == 's' && head == 1) {
+        out->append(s);
+      } else if (conv == 's') {
+        snprintf(spec + head, sizeof(spec) - head, "s");
+        snprintf(buf, sizeof(buf), spec, s.c_str());
+        out->append(buf);
+      } else {
+        out->append(s);
+      }
+      continue;
+    }
+    int64_t i = 0;
+    double d = 0.0;
+    if (args + sizeof(i) <= end) {
+      if (type == 'd') {
+        memcpy(&d, args, sizeof(d));
+        i = static_cast<int64_t>(d);
+      } else {
+        memcpy(&i, args, sizeof(i));
+        d = type == 'u' ? static_cast<double>(static_cast<uint64_t>(i)) : static_cast<double>(i);
+      }
+      args += sizeof(i);
+    }
+    if (strchr("diouxXc", conv)) {
+      if (conv == 'c') {
+        snprintf(spec + head, sizeof(spec) - head, "c");
+        snprintf(buf, sizeof(buf), spec, static_cast<int>(i));
+      } else {
+        snprintf(spec + head, sizeof(spec) - head, "ll%c", conv);
+        snprintf(buf, sizeof(buf), spec, static_cast<long long>(i));
+      }
+    } else if (strchr("fFeEgGaA", conv)) {
+      snprintf(spec + head, sizeof(spec) - head, "%c", conv);
+      snprintf(buf, sizeof(buf), spec, d);
+    } else if (conv == 's') {
+      snprintf(spec + head, sizeof(spec) - head, type == 'd' ? "g" : "lld");
+      if (type == 'd') {
+        snprintf(buf, sizeof(buf), spec, d);
+      } else {
+        snprintf(buf, sizeof(buf), spec, static_cast<long long>(i));
+      }
+    } else if (conv == 'p') {
+      snprintf(spec + head, sizeof(spec) - head, "p");
+      snprintf(buf, sizeof(buf), spec, reinterpret_cast<void*>(static_cast<intptr_t>(i)));
+    } else {
+      snprintf(buf, sizeof(buf), "%%%c", conv);
+    }
+    out->append(buf);
+  }
+}
+
+// single producer single consumer byte ring of length prefixed records
+class LogRing {
+ public:
+  struct Header {
+    uint32_t size;  // with the header, 8 aligned
+    uint32_t id;
+    int64_t ns;
+  };
+
+  LogRing()
+    : data(new char[LOG_RING_BYTES]),
+      head(0),
+      tail(0),
+      dropped(0) {
+  }
+
+  ~LogRing() {
+  }
+
+  // producer: room for a record of n payload bytes, nullptr when full
+  char* Reserve(uint32_t id, int64_t ns, size_t n) {
+    size_t size = (sizeof(Header) + n + 7) & ~static_cast<size_t>(7);
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t h = head.load(std::memory_order_acquire);
+    size_t off = t & (LOG_RING_BYTES - 1);
+    // a record never wraps, the rest of the ring is skipped with a pad record
+    size_t pad = off + size > LOG_RING_BYTES ? LOG_RING_BYTES - off : 0;
+    if (t + pad + size - h > LOG_RING_BYTES) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    if (pad > 0) {
+      Header* p = reinterpret_cast<Header*>(data.get() + off);
+      p->size = pad;
+      p->id = UINT32_MAX;
+      t += pad;
+      off = 0;
+    }
+    Header* r = reinterpret_cast<Header*>(data.get() + off);
+    r->size = size;
+    r->id = id;
+    r->ns = ns;
+    pending = t + size;
+    return data.get() + off + sizeof(Header);
+  }
+
+  char* Drop() {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  void Commit() {
+    tail.store(pending, std::memory_order_release);
+  }
+
+  // consumer: the oldest record, nullptr when empty
+  const Header* Peek() {
+    while (true) {
+      size_t h = head.load(std::memory_order_relaxed);
+      if (h == tail.load(std::memory_order_acquire)) {
+        return nullptr;
+      }
+      const Header* r = reinterpret_cast<const Header*>(data.get() + (h & (LOG_RING_BYTES - 1)));
+      if (r->id != UINT32_MAX) {
+        return r;
+      }
+      head.store(h + r->size, std::memory_order_release);
+    }
+  }
+
+  void Pop() {
+    size_t h = head.load(std::memory_order_relaxed);
+    const Header* r = reinterpret_cast<const Header*>(data.get() + (h & (LOG_RING_BYTES - 1)));
+    head.store(h + r->size, std::memory_order_release);
+  }
+
+  long long TakeDropped() {
+    return dropped.exchange(0, std::memory_order_relaxed);
+  }
+
+ private:
+  std::unique_ptr<char[]> data;
+  char pad0[64];
+  std::atomic<size_t> head;
+  char pad1[64];
+  std::atomic<size_t> tail;
+  size_t pending;
+  std::atomic<long long> dropped;
+};
+
+// printf replacement for the hot paths: a call copies its raw arguments into a ring
+// of the calling thread and returns, a background thread formats and writes them
+// in time order; modes:
+//   sync    (until Start) formats in the caller, as printf did
+//   text    formatted by the background thread into a file or stdout
+//   binary  the records as they are, plus the sites, for log_decoder
+// a full ring drops the record and the writer reports how many went missing
+class AsyncLog {
+ public:
+  static AsyncLog & Instance() {
+    static AsyncLog l;
+    return l;
+  }
+
+  // the log group of a config, a file without one keeps the sync default:
+  //   log = { mode = "binary"; file = "trade.log"; level = 1; };
+  bool Load(const std::string & path) {
+    libconfig::Config cfg;
+    try {
+      cfg.readFile(path.c_str());
+    } catch (const libconfig::FileIOException & e) {
+      printf("log config: can't read %s, log in sync mode\n", path.c_str());
+      return false;
+    } catch (const libconfig::ParseException & e) {
+      printf("log config: %s:%d %s\n", e.getFile(), e.getLine(), e.getError());
+      return false;
+    }
+    return !cfg.exists("log") || Load(cfg.lookup("log"));
+  }
+
+  bool Load(const libconfig::Setting & log) {
+    if (log.exists("level")) {
+      SetLevel(static_cast<int>(log["level"]));
+    }
+    std::string mode = log.exists("mode") ? log["mode"].c_str() : "sync";
+    std::string path = log.exists("file") ? log["file"].c_str() : "";
+    return Start(mode, path);
+  }
+
+  // path "" is stdout
+  bool Start(const std::string & mode, const std::string & path = "") {
+    if (running) {
+      return true;
+    }
+    binary = mode == "binary";
+    if (mode == "sync") {
+      return true;
+    }
+    if (mode != "text" && !binary) {
+      printf("bad log mode %s, use sync, text or binary\n", mode.c_str());
+      return false;
+    }
+    if (!path.empty()) {
+      out = fopen(path.c_str(), binary ? "wb" : "w");
+      if (!out) {
+        printf("open %s failed!\n", path.c_str());
+        out = stdout;
+        binary = false;
+        return false;
+      }
+    } else if (binary) {
+      printf("binary log needs a file\n");
+      binary = false;
+      return false;
+    }
+    if (binary) {
+      fwrite(LOG_MAGIC, 1, strlen(LOG_MAGIC), out);
+    }
+    fflush(stdout);
+    running = true;
+    writer = std::thread(&AsyncLog::Run, this);
+    atexit([]() {
+      AsyncLog::Instance().Stop();
+    });
+    return true;
+  }
+
+  // drains everything logged so far and stops the writer
+  void Stop() {
+    if (!running) {
+      return;
+    }
+    running = false;
+    writer.join();
+    if (out != stdout) {
+      fclose(out);
+      out = stdout;
+    }
+  }
+
+  void SetLevel(int level) {
+    min_level = level;
+  }
+
+  int Level() const {
+    return min_level;
+  }
+
+  template <typename... Args>
+  int Site(int level, const char* file, int line, const char* fmt, const Args &... args) {
+    std::string types;
+    LogTypes(&types, args...);
+    return AddSite(level, file, line, fmt, types, "");
+  }
+
+  template <typename T>
+  int ObjectSite(int level, const char* file, int line) {
+    return AddSite(level, file, line, "", "", LogObject<T>::Name());
+  }
+
+  template <typename... Args>
+  void Write(int id, int level, const Args &... args) {
+    if (level < min_level) {
+      return;
+    }
+    size_t n = LogSize(args...);
+    if (!running) {
+      std::string buf(n, 0);
+      LogPutAll(&buf[0], args...);
+      WriteSync(id, buf.data(), n);
+      return;
+    }
+    LogRing* r = Ring();
+    char* p = n <= LOG_MAX_RECORD ? r->Reserve(id, Now(), n) : r->Drop();
+    if (!p) {
+      return;
+    }
+    LogPutAll(p, args...);
+    r->Commit();
+  }
+
+  template <typename T>
+  void WriteObject(int id, int level, const T & obj) {
+    if (level < min_level) {
+      return;
+    }
+    if (!running) {
+      obj.Show(out);
+      return;
+    }
+    static_assert(sizeof(T) <= LOG_MAX_RECORD, "object too large for the log");
+    LogRing* r = Ring();
+    char* p = r->Reserve(id, Now(), sizeof(T));
+    if (!p) {
+      return;
+    }
+    memcpy(p, &obj, sizeof(T));
+    r->Commit();
+  }
+
+  static int64_t Now() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+  }
+
+ private:
+  AsyncLog()
+    : out(stdout),
+      binary(false),
+      running(false),
+      min_level(LOG_MIN_LEVEL),
+      sites_written(0) {
+  }
+
+  int AddSite(int level, const char* file, int line, const std::string & fmt, const std::string & types, const std::string & object) {
+    std::lock_guard<std::mutex> lck(mtx);
+    LogSite s{static_cast<int>(sites.size()), level, file, line, fmt, types, object};
+    sites.emplace_back(new LogSite(s));
+    return s.id;
+  }
+
+  const LogSite & SiteOf(int id) {
+    std::lock_guard<std::mutex> lck(mtx);
+    return *sites[id];
+  }
+
+  LogRing* Ring() {
+    thread_local LogRing* ring = nullptr;
+    if (!ring) {
+      ring = new LogRing;
+      std::lock_guard<std::mutex> lck(mtx);
+      rings.emplace_back(ring);
+    }
+    return ring;
+  }
+
+  void WriteSync(int id, const char* args, size_t len) {
+    std::string s;
+    LogFormat(SiteOf(id), args, len, &s);
+    fputs(s.c_str(), out);
+  }
+
+  void Run() {
+    std::vector<LogRing*> local;
+    while (true) {
+      bool stopping = !running;
+      {
+        std::lock_guard<std::mutex> lck(mtx);
+        for (size_t i = local.size(); i < rings.size(); i++) {
+          local.push_back(rings[i].get());
+        }
+      }
+      size_t n = 0;
+      // oldest first over all threads
+      while (true) {
+        LogRing* oldest = nullptr;
+        const LogRing::Header* first = nullptr;
+        for (auto r : local) {
+          const LogRing::Header* h = r->Peek();
+          if (h && (!first || h->ns < first->ns)) {
+            first = h;
+            oldest = r;
+          }
+        }
+        if (!first) {
+          break;
+        }
+        Emit(first);
+        oldest->Pop();
+        n++;
+      }
+      long long dropped = 0;
+      for (auto r : local) {
+        dropped += r->TakeDropped();
+      }
+      if (dropped > 0 && !binary) {
+        fprintf(out, "log: %lld records dropped, ring full\n", dropped);
+      }
+      if (n > 0 || dropped > 0) {
+        fflush(out);
+      }
+      if (stopping) {
+        fflush(out);
+        return;
+      }
+      if (n == 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(LOG_IDLE_US));
+      }
+    }
+  }
+
+  void Emit(const LogRing::Header* h) {
+    const char* payload = reinterpret_cast<const char*>(h + 1);
+    size_t len = h->size - sizeof(*h);
+    if (binary) {
+      WriteSites(h->id);
+      uint32_t n = len;
+      fputc('R', out);
+      fwrite(&h->id, sizeof(h->id), 1, out);
+      fwrite(&h->ns, sizeof(h->ns), 1, out);
+      fwrite(&n, sizeof(n), 1, out);
+      fwrite(payload, 1, len, out);
+      return;
+    }
+    const LogSite & s = SiteOf(h->id);
+    if (!s.object.empty()) {
+      ShowLogObject(s.object, payload, len, out);
+      return;
+    }
+    std::string text;
+    LogFormat(s, payload, len, &text);
+    fputs(text.c_str(), out);
+  }
+
+  // every site up to id, each once, before the first record that needs it
+  void WriteSites(uint32_t id) {
+    while (sites_written <= id) {
+      const LogSite & s = SiteOf(sites_written++);
+      fputc('D', out);
+      int32_t v[3] = {s.id, s.level, s.line};
+      fwrite(v, sizeof(v), 1, out);
+      for (const std::string* str : {&s.file, &s.fmt, &s.types, &s.object}) {
+        uint32_t n = str->size();
+        fwrite(&n, sizeof(n), 1, out);
+        fwrite(str->data(), 1, n, out);
+      }
+    }
+  }
+
+  FILE* out;
+  bool binary;
+  std::atomic<bool> running;
+  int min_level;
+  uint32_t sites_written;
+  std::mutex mtx;
+  std::vector<std::unique_ptr<LogSite> > sites;
+  std::vector<std::unique_ptr<LogRing> > rings;
+  std::thread writer;
+};
+
+// never called, it has the compiler check the format against the arguments
+inline void LogCheckFormat(const char*, ...) __attribute__((format(printf, 1, 2)));
+inline void LogCheckFormat(const char*, ...) {
+}
+
+#define LOG_AT(level, fmt, ...) \
+  do { \
+    if (level >= LOG_MIN_LEVEL) { \
+      if (false) { \
+        LogCheckFormat(fmt, ##__VA_ARGS__); \
+      } \
+      static const int log_site_ = AsyncLog::Instance().Site(level, __FILE__, __LINE__, fmt, ##__VA_ARGS__); \
+      AsyncLog::Instance().Write(log_site_, level, ##__VA_ARGS__); \
+    } \
+  } while (0)
+
+// obj.Show(stdout), with the copy and the formatting off the calling thread
+#define LOG_SHOW(level, obj) \
+  do { \
+    if (level >= LOG_MIN_LEVEL) { \
+      typedef typename std::decay<decltype(obj)>::type LogObjectType; \
+      static const int log_site_ = AsyncLog::Instance().ObjectSite<LogObjectType>(level, __FILE__, __LINE__); \
+      AsyncLog::Instance().WriteObject(log_site_, level, obj); \
+    } \
+  } while (0)
+
+#define LOG_DEBUG(fmt, ...) LOG_AT(LOG_DEBUG_LEVEL, fmt, ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...) LOG_AT(LOG_INFO_LEVEL, fmt, ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...) LOG_AT(LOG_WARN_LEVEL, fmt, ##__VA_ARGS__)
+#define LOG_ERROR(fmt, ...) LOG_AT(LOG_ERROR_LEVEL, fmt, ##__VA_ARGS__)
+
+#endif  // ASYNC_LOG_HPP_
@@ -0,0 +1,310 @@
+#ifndef BACKTEST_RESULT_HPP_
+#define BACKTEST_RESULT_HPP_
+
+#include <stdio.h>
+#include <time.h>
+#include <math.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define RESULT_HOURS 24
+
+// what one strategy made on one run (a day, or a merged period), filled in memory
+// while the run goes, so totals no longer have to be scraped from stdout or rebuilt
+// from the order files
+struct BacktestResult {
+  std::string date;
+  std::string strategy;
+  std::string params;  // sweep label, empty for a plain run
+  double pnl;  // net of fees
+  double fee;
+  int rounds;
+  int wins;
+  int position;  // left open at the end
+  // equity is pnl after each round, relative to the start of the run
+  double peak;
+  double low;
+  double max_drawdown;
+  int slip_count;
+  double slip_sum;
+  double slip_square_sum;
+  double worst_slip;
+  double hour_pnl[RESULT_HOURS];
+  int hour_rounds[RESULT_HOURS];
+
+  BacktestResult()
+    : pnl(0.0),
+      fee(0.0),
+      rounds(0),
+      wins(0),
+      position(0),
+      peak(0.0),
+      low(0.0),
+      max_drawdown(0.0),
+      slip_count(0),
+      slip_sum(0.0),
+      slip_square_sum(0.0),
+      worst_slip(0.0) {
+    for (int i = 0; i < RESULT_HOURS; i++) {
+      hour_pnl[i] = 0.0;
+      hour_rounds[i] = 0;
+    }
+  }
+
+  // one closed round, close_sec is the exchange time of the close
+  void AddRound(double round_pnl, double round_fee, time_t close_sec) {
+    pnl += round_pnl;
+    fee += round_fee;
+    rounds++;
+    if (round_pnl > 0) {
+      wins++;
+    }
+    peak = std::max(peak, pnl);
+    low = std::min(low, pnl);
+    max_drawdown = std::max(max_drawdown, peak - pnl);
+    struct tm t;
+    localtime_r(&close_sec, &t);
+    hour_pnl[t.tm_hour] += round_pnl;
+    hour_rounds[t.tm_hour]++;
+  }
+
+  // slip in price, positive is a gain against the quoted price
+  void AddSlip(double slip) {
+    slip_count++;
+    slip_sum += slip;
+    slip_square_sum += slip * slip;
+    worst_slip = std::min(worst_slip, slip);
+  }
+
+  // appends r as if it ran right after this one, so merge in date order
+  void Merge(const BacktestResult & r) {
+    max_drawdown = std::max(max_drawdown, std::max(r.max_drawdown, peak - (pnl + r.low)));
+    peak = std::max(peak, pnl + r.peak);
+    low = std::min(low, pnl + r.low);
+    pnl += r.pnl;
+    fee += r.fee;
+    rounds += r.rounds;
+    wins += r.wins;
+    position = r.position;
+    slip_count += r.slip_count;
+    slip_sum += r.slip_sum;
+    slip_square_sum += r.slip_square_sum;
+    worst_slip = std::min(worst_slip, r.worst_slip);
+    for (int i = 0; i < RESULT_HOURS; i++) {
+      hour_pnl[i] += r.hour_pnl[i];
+      hour_rounds[i] += r.hour_rounds[i];
+    }
+  }
+
+  double WinRate() const {
+    return rounds > 0 ? static_cast<double>(wins) / rounds : 0.0;
+  }
+
+  double SlipMean() const {
+    return slip_count > 0 ? slip_sum / slip_count : 0.0;
+  }
+
+  double SlipStd() const {
+    if (slip_count == 0) {
+      return 0.0;
+    }
+    double mean = SlipMean();
+    return sqrt(std::max(0.0, slip_square_sum / slip_count - mean * mean));
+  }
+
+  std::string Key() const {
+    return params.empty() ? strategy : strategy + " " + params;
+  }
+
+  // text form for result files: the names tab separated on the first line, numbers on the second
+  std::string Serialize() const {
+    std::ostringstream out;
+    out.precision(17);
+    out << date << '\t' << strategy << '\t' << params << '\n';
+    out << pnl << ' ' << fee << ' ' << rounds << ' ' << wins << ' ' << position << ' ' << peak << ' ' << low << ' ' << max_drawdown << ' ';
+    out << slip_count << ' ' << slip_sum << ' ' << slip_square_sum << ' ' << worst_slip;
+    for (int i = 0; i < RESULT_HOURS; i++) {
+      out << ' ' << hour_pnl[i] << ' ' << hour_rounds[i];
+    }
+    out << '\n';
+    return out.str();
+  }
+
+  bool Deserialize(const std::string & text) {
+    std::istringstream in(text);
+    std::string names;
+    if (!getline(in, names)) {
+      return false;
+    }
+    size_t a = names.find('\t');
+    size_t b = a == std::string::npos ? a : names.find('\t', a + 1);
+    if (b == std::string::npos) {
+      return false;
+    }
+    date = names.substr(0, a);
+    strategy = names.substr(a + 1, b - a - 1);
+    params = names.substr(b + 1);
+    in >> pnl >> fee >> rounds >> wins >> position >> peak >> low >> max_drawdown;
+    in >> slip_count >> slip_sum >> slip_square_sum >> worst_slip;
+    for (int i = 0; i < RESULT_HOURS; i++) {
+      in >> hour_pnl[i] >> hour_rounds[i];
+    }
+    return !in.fail();
+  }
+};
+
+// thread safe sink for the results of parallel runs, merges them per strategy and
+// parameter set over all days and writes the tables once everything is done
+class ResultCollector {
+ public:
+  ResultCollector() {
+  }
+
+  ~ResultCollector() {
+  }
+
+  void Add(const BacktestResult & r) {
+    std::lock_guard<std::mutex> lck(mtx);
+    results.push_back(r);
+  }
+
+  // hands the results over and forgets them, a worker process sends them on this way
+  std::vector<BacktestResult> Take() {
+    std::lock_guard<std::mutex> lck(mtx);
+    std::vector<BacktestResult> v;
+    v.swap(results);
+    return v;
+  }
+
+  // every run in (date, strategy, params) order
+  std::vector<BacktestResult> Results() const {
+    std::lock_guard<std::mutex> lck(mtx);
+    std::vector<BacktestResult> v = results;
+    std::stable_sort(v.begin(), v.end(), [](const BacktestResult & a, const BacktestResult & b) {
+      if (a.date != b.date) {
+        return a.date < b.date;
+      }
+      if (a.strategy != b.strategy) {
+        return a.strategy < b.strategy;
+      }
+      return a.params < b.params;
+    });
+    return v;
+  }
+
+  // one merged result per strategy and parameter set, best pnl first
+  std::vector<BacktestResult> Totals() const {
+    std::map<std::string, BacktestResult> m;
+    std::map<std::string, std::string> first_date;
+    for (auto & r : Results()) {
+      auto it = m.find(r.Key());
+      if (it == m.end()) {
+        m[r.Key()] = r;
+        first_date[r.Key()] = r.date;
+      } else {
+        it->second.Merge(r);
+      }
+    }
+    std::vector<BacktestResult> v;
+    for (auto & i : m) {
+      v.push_back(i.second);
+      v.back().date = first_date[i.first];
+    }
+    std::stable_sort(v.begin(), v.end(), [](const BacktestResult & a, const BacktestResult & b) {
+      return a.pnl > b.pnl;
+    });
+    return v;
+  }
+
+  bool WriteCsv(const std::string & path) const {
+    return WriteTable(path, Results());
+  }
+
+  bool WriteSummaryCsv(const std::string & path) const {
+    return WriteTable(path, Totals());
+  }
+
+  // {"runs": [...], "totals": [...]}, with the hourly breakdown
+  bool WriteJson(const std::string & path) const {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+      printf("open %s failed!\n", path.c_str());
+      return false;
+    }
+    fprintf(f, "{\n  \"runs\": [");
+    WriteJsonList(f, Results());
+    fprintf(f, "],\n  \"totals\": [");
+    WriteJsonList(f, Totals());
+    fprintf(f, "]\n}\n");
+    fclose(f);
+    return true;
+  }
+
+  void Print(FILE* f = stdout) const {
+    fprintf(f, "%-60s %14s %8s %8s %12s %6s\n", "strategy", "pnl", "rounds", "winrate", "drawdown", "days");
+    std::map<std::string, int> days;
+    for (auto & r : Results()) {
+      days[r.Key()]++;
+    }
+    for (auto & r : Totals()) {
+      fprintf(f, "%-60s %14.2lf %8d %8.3lf %12.2lf %6d\n", r.Key().c_str(), r.pnl, r.rounds, r.WinRate(), r.max_drawdown, days[r.Key()]);
+    }
+  }
+
+ private:
+  static bool WriteTable(const std::string & path, const std::vector<BacktestResult> & v) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+      printf("open %s failed!\n", path.c_str());
+      return false;
+    }
+    fprintf(f, "date,strategy,params,pnl,fee,rounds,wins,position,max_drawdown,slip_count,slip_mean,slip_std,worst_slip\n");
+    for (auto & r : v) {
+      fprintf(f, "%s,%s,%s,%lf,%lf,%d,%d,%d,%lf,%d,%lf,%lf,%lf\n", r.date.c_str(), r.strategy.c_str(), r.params.c_str(), r.pnl, r.fee, r.rounds, r.wins, r.position, r.max_drawdown, r.slip_count, r.SlipMean(), r.SlipStd(), r.worst_slip);
+    }
+    fclose(f);
+    return true;
+  }
+
+  static std::string JsonString(const std::string & s) {
+    std::string r = "\"";
+    for (char c : s) {
+      if (c == '"' || c == '\\') {
+        r += '\\';
+      }
+      r += c;
+    }
+    return r + "\"";
+  }
+
+  static void WriteJsonList(FILE* f, const std::vector<BacktestResult> & v) {
+    for (size_t i = 0; i < v.size(); i++) {
+      const BacktestResult & r = v[i];
+      fprintf(f, "%s\n    {\"date\": %s, \"strategy\": %s, \"params\": %s, ", i == 0 ? "" : ",", JsonString(r.date).c_str(), JsonString(r.strategy).c_str(), JsonString(r.params).c_str());
+      fprintf(f, "\"pnl\": %.6lf, \"fee\": %.6lf, \"rounds\": %d, \"wins\": %d, \"position\": %d, \"max_drawdown\": %.6lf, ", r.pnl, r.fee, r.rounds, r.wins, r.position, r.max_drawdown);
+      fprintf(f, "\"slip_count\": %d, \"slip_mean\": %.6lf, \"slip_std\": %.6lf, \"worst_slip\": %.6lf, ", r.slip_count, r.SlipMean(), r.SlipStd(), r.worst_slip);
+      fprintf(f, "\"hour_pnl\": [");
+      for (int h = 0; h < RESULT_HOURS; h++) {
+        fprintf(f, "%s%.6lf", h == 0 ? "" : ", ", r.hour_pnl[h]);
+      }
+      fprintf(f, "], \"hour_rounds\": [");
+      for (int h = 0; h < RESULT_HOURS; h++) {
+        fprintf(f, "%s%d", h == 0 ? "" : ", ", r.hour_rounds[h]);
+      }
+      fprintf(f, "]}");
+    }
+    if (!v.empty()) {
+      fprintf(f, "\n  ");
+    }
+  }
+
+  mutable std::mutex mtx;
+  std::vector<BacktestResult> results;
+};
+
+#endif  // BACKTEST_RESULT_HPP_
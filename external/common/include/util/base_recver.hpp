@@ -11,6 +11,13 @@ class BaseRecver {
   }
 
   virtual void Recv(T& t) = 0;
+
+  // false at once when nothing is waiting; a recver without a non blocking read
+  // waits like Recv
+  virtual bool TryRecv(T& t) {
+    Recv(t);
+    return true;
+  }
 };
 
 #endif  //  BASE_RECVER_HPP_
@@ -12,4 +12,12 @@ class BaseSender {
 
 };
 
+// swallows everything, for strategy instances nobody listens to (parameter sweeps)
+template <typename T>
+class NullSender : public BaseSender <T> {
+ public:
+  inline void Send(const T &) override {
+  }
+};
+
 #endif // BASE_SENDER_HPP_
@@ -0,0 +1,191 @@
+#ifndef CHECKPOINT_HPP_
+#define CHECKPOINT_HPP_
+
+#include <link.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <libconfig.h++>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "util/backtest_result.hpp"
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+#define CHECKPOINT_SAMPLE_BYTES (1 << 20)
+
+inline unsigned long long Fnv1a(const void* data, size_t size, unsigned long long h = FNV_OFFSET) {
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; i++) {
+    h ^= p[i];
+    h *= FNV_PRIME;
+  }
+  return h;
+}
+
+inline unsigned long long Fnv1a(const std::string & s, unsigned long long h = FNV_OFFSET) {
+  // the terminating 0 keeps "ab"+"c" apart from "a"+"bc"
+  return Fnv1a(s.c_str(), s.size() + 1, h);
+}
+
+// finished backtest tasks keyed by what went into them, one small result file per
+// task: a rerun loads what is there and only runs the rest, and runs with an unchanged
+// config, contract and time files, data, binary and libnick reuse each other's results
+class Checkpoint {
+ public:
+  explicit Checkpoint(const std::string & dir)
+    : dir(dir) {
+    mkdir(dir.c_str(), 0755);
+  }
+
+  ~Checkpoint() {
+  }
+
+  static unsigned long long HashFile(const std::string & path, unsigned long long h = FNV_OFFSET) {
+    std::ifstream f(path.c_str(), std::ios::in | std::ios::binary);
+    std::vector<char> buf(CHECKPOINT_SAMPLE_BYTES);
+    while (f.read(buf.data(), buf.size()) || f.gcount() > 0) {
+      h = Fnv1a(buf.data(), f.gcount(), h);
+    }
+    return h;
+  }
+
+  // the shared libraries loaded as lib<name>.so*, e.g. nick, which holds the
+  // Backtester and BaseStrategy
+  static unsigned long long HashLibrary(const std::string & name, unsigned long long h = FNV_OFFSET) {
+    LibrarySearch search;
+    search.prefix = "lib" + name + ".so";
+    dl_iterate_phdr(FindLibrary, &search);
+    if (search.paths.empty()) {
+      printf("lib%s is not loaded, checkpoints do not follow its changes\n", name.c_str());
+    }
+    for (auto & p : search.paths) {
+      h = HashFile(p, h);
+    }
+    return h;
+  }
+
+  // day files run to gigabytes: the size, the mtime and the first and the last
+  // megabyte, so records added, cut or rewritten by a conversion all change it
+  static unsigned long long HashDataFile(const std::string & path, unsigned long long h = FNV_OFFSET) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+      return Fnv1a(path, h);
+    }
+    long long size = st.st_size;
+    long long mtime = st.st_mtime;
+    h = Fnv1a(&size, sizeof(size), h);
+    h = Fnv1a(&mtime, sizeof(mtime), h);
+    std::ifstream f(path.c_str(), std::ios::in | std::ios::binary);
+    std::vector<char> buf(CHECKPOINT_SAMPLE_BYTES);
+    f.read(buf.data(), buf.size());
+    h = Fnv1a(buf.data(), f.gcount(), h);
+    if (size > 2 * CHECKPOINT_SAMPLE_BYTES) {
+      f.clear();
+      f.seekg(size - CHECKPOINT_SAMPLE_BYTES);
+      f.read(buf.data(), buf.size());
+      h = Fnv1a(buf.data(), f.gcount(), h);
+    }
+    return h;
+  }
+
+  // the setting as text, names and values in config order
+  static std::string SettingText(const libconfig::Setting & s) {
+    std::ostringstream out;
+    out.precision(17);
+    if (s.getName()) {
+      out << s.getName() << '=';
+    }
+    switch (s.getType()) {
+     case libconfig::Setting::TypeInt:
+      out << static_cast<int>(s);
+      break;
+     case libconfig::Setting::TypeInt64:
+      out << static_cast<long long>(s);
+      break;
+     case libconfig::Setting::TypeFloat:
+      out << static_cast<double>(s);
+      break;
+     case libconfig::Setting::TypeBoolean:
+      out << (static_cast<bool>(s) ? "true" : "false");
+      break;
+     case libconfig::Setting::TypeString:
+      out << '"' << s.c_str() << '"';
+      break;
+     default:
+      out << '{';
+      for (int i = 0; i < s.getLength(); i++) {
+        out << SettingText(s[i]) << ';';
+      }
+      out << '}';
+    }
+    return out.str();
+  }
+
+  static std::string KeyString(unsigned long long h) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%016llx", h);
+    return buffer;
+  }
+
+  bool Load(const std::string & key, BacktestResult* r) const {
+    std::ifstream f(Path(key).c_str());
+    if (!f) {
+      return false;
+    }
+    std::stringstream text;
+    text << f.rdbuf();
+    if (!r->Deserialize(text.str())) {
+      printf("broken checkpoint %s, will rerun\n", Path(key).c_str());
+      return false;
+    }
+    return true;
+  }
+
+  // written aside and renamed, a crash never leaves half a result behind
+  bool Save(const std::string & key, const BacktestResult & r) const {
+    std::string path = Path(key);
+    std::string tmp = path + ".tmp";
+    {
+      std::ofstream f(tmp.c_str());
+      f << r.Serialize();
+      if (!f.good()) {
+        printf("write %s failed!\n", tmp.c_str());
+        return false;
+      }
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+      printf("rename %s failed!\n", tmp.c_str());
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  struct LibrarySearch {
+    std::string prefix;
+    std::vector<std::string> paths;
+  };
+
+  static int FindLibrary(dl_phdr_info* info, size_t /*size*/, void* data) {
+    LibrarySearch* search = static_cast<LibrarySearch*>(data);
+    const char* base = strrchr(info->dlpi_name, '/');
+    if (base && strncmp(base + 1, search->prefix.c_str(), search->prefix.size()) == 0) {
+      search->paths.push_back(info->dlpi_name);
+    }
+    return 0;
+  }
+
+  std::string Path(const std::string & key) const {
+    return dir + "/" + key + ".result";
+  }
+
+  std::string dir;
+};
+
+#endif  // CHECKPOINT_HPP_
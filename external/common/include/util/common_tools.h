@@ -169,15 +169,15 @@ void busy_sleep(std::chrono::nanoseconds t);
 
 template <typename T>
 std::tuple<double, double> CalMeanStd(const T & v, int head, int num) {
-  T cal_v(v.begin() + head, v.begin() + head + num);
+  // a rolling window should use RollingStats, this scans the range in place
   double mean = 0.0;
   double std = 0.0;
-  for (auto i : cal_v) {
-    mean += i;
+  for (int i = head; i < head + num; i++) {
+    mean += v[i];
   }
   mean /= num;
-  for (auto i : cal_v) {
-    std += (i-mean) * (i-mean);
+  for (int i = head; i < head + num; i++) {
+    std += (v[i]-mean) * (v[i]-mean);
   }
   std /= num;
   std = sqrt(std);
@@ -3,10 +3,17 @@
 #include <iostream>
 #include <unordered_map>
 #include <string>
+#include <type_traits>
+#include <vector>
 #include <zlib.h>
+#include <sys/stat.h>
 #include "struct/market_snapshot.h"
 #include "util/common_tools.h"
 #include "util/time_controller.h"
+#include "util/shot_filter.hpp"
+#include "util/day_index.hpp"
+#include "util/merged_source.hpp"
+#include "util/replay_cache.hpp"
 #include "define.h"
 
 template <typename T>
@@ -18,8 +25,42 @@ class DataHandler {
   ~DataHandler() {
 
   }
+
+  // records rejected here never reach HandleShot nor the GetNext lookahead
+  template <typename V>
+  void FilterTickers(const std::unordered_map<std::string, V> & m) {
+    m_filter.AddTickers(m);
+  }
+
+  void FilterTicker(const std::string & ticker) {
+    m_filter.AddTicker(ticker);
+  }
+
+  bool FilterTimeWindow(const std::string & window) {
+    return m_filter.AddTimeWindow(window);
+  }
+
   void LoadData(const std::string& file_path) {
     std::string file_mode = Split(file_path, ".").back();
+    // a fresh index bounds the read to complete records and to the blocks the filter can pass
+    std::vector<RecordRange> ranges;
+    if (std::is_same<T, MarketSnapshot>::value) {
+      DayIndex index(file_path);
+      if (index.LoadIfFresh()) {
+        if (!index.Usable()) {
+          printf("skip %s: %s\n", file_path.c_str(), index.Problem().c_str());
+          return;
+        }
+        if (!index.Clean()) {
+          printf("warning %s: %s\n", file_path.c_str(), index.Problem().c_str());
+        }
+        ranges = index.Ranges(m_filter);
+        if (ranges.empty()) {
+          printf("nothing to replay in %s\n", file_path.c_str());
+          return;
+        }
+      }
+    }
     if (file_mode == "gz") {
       gzFile gzfp = gzopen(file_path.c_str(), "rb");
       if (!gzfp) {
@@ -27,15 +68,16 @@ class DataHandler {
         return;
       }
       printf("handling %s\n", file_path.c_str());
+      // inflating can't seek, but nothing after the last range is needed
+      long long stop = ranges.empty() ? -1 : ranges.back().second;
       unsigned char buf[SIZE_OF_SNAPSHOT];
       T* shot;
       if (m_getnext) {
         tc.StartTimer();
-        while (gzread(gzfp, buf, sizeof(*shot)) > 0) {
+        for (long long i = 0; i != stop && gzread(gzfp, buf, sizeof(*shot)) == static_cast<int>(sizeof(*shot)); i++) {
           shot = reinterpret_cast<T*>(buf);
-          if (all.find(shot->ticker) == all.end()) {
-            std::vector<T> temp_v;
-            all[shot->ticker] = temp_v;
+          if (!m_filter.Pass(*shot)) {
+            continue;
           }
           all[shot->ticker].push_back(*shot);
         }
@@ -46,8 +88,11 @@ class DataHandler {
         gzclose(gzfp);
       }
       gzfp = gzopen(file_path.c_str(), "rb");
-      while (gzread(gzfp, buf, sizeof(*shot)) > 0) {
+      for (long long i = 0; i != stop && gzread(gzfp, buf, sizeof(*shot)) == static_cast<int>(sizeof(*shot)); i++) {
         shot = reinterpret_cast<T*>(buf);
+        if (!m_filter.Pass(*shot)) {
+          continue;
+        }
         T* next_shot = GetNext(shot);
         HandleShot(shot, next_shot);
       }
@@ -60,16 +105,17 @@ class DataHandler {
         return;
       }
       printf("handling %s\n", file_path.c_str());
-      T shot;
+      if (ranges.empty()) {
+        // no index, still stop at the records complete right now, the file may be growing
+        struct stat st;
+        stat(file_path.c_str(), &st);
+        ranges.push_back(RecordRange(0, st.st_size / sizeof(T)));
+      }
       if (m_getnext) {
         tc.StartTimer();
-        while (raw_file.read(reinterpret_cast<char *>(&shot), sizeof(shot))) {
-          if (all.find(shot.ticker) == all.end()) {
-            std::vector<T> temp_v;
-            all[shot.ticker] = temp_v;
-          }
-          all[shot.ticker].push_back(shot);
-        }
+        ReadRanges(&raw_file, ranges, [this](T* shot) {
+          all[shot->ticker].push_back(*shot);
+        });
         tc.EndTimer("LoadAllShot");
         for (auto i : all) {
           index_count[i.first] = 0;
@@ -77,20 +123,69 @@ class DataHandler {
         raw_file.close();
       }
       raw_file.open(file_path.c_str(), ios::in|ios::binary);
-      while (raw_file.read(reinterpret_cast<char *>(&shot), sizeof(shot))) {
-        if (shot.time.tv_usec != all[shot.ticker][index_count[shot.ticker]].time.tv_usec) {
+      ReadRanges(&raw_file, ranges, [this](T* shot) {
+        if (m_getnext && shot->time.tv_usec != all[shot->ticker][index_count[shot->ticker]].time.tv_usec) {
           printf("not correct!\n");
           exit(1);
         }
-        T* next_shot = GetNext(&shot);
-        HandleShot(&shot, next_shot);
-      }
+        T* next_shot = GetNext(shot);
+        HandleShot(shot, next_shot);
+      });
       raw_file.close();
     } else {
       printf("unknown mode %s\n", file_path.c_str());
     }
   }
 
+  // several day files replayed as one stream in global time order, GetNext looks
+  // ahead across file boundaries since both passes see the same merged sequence
+  void LoadData(const std::vector<std::string> & files) {
+    if (files.size() == 1) {
+      LoadData(files.front());
+      return;
+    }
+    printf("handling %zu files merged\n", files.size());
+    T shot;
+    if (m_getnext) {
+      tc.StartTimer();
+      MergedSource<T> source(files, &m_filter);
+      while (source.Next(&shot)) {
+        all[shot.ticker].push_back(shot);
+      }
+      tc.EndTimer("LoadAllShot");
+      for (auto i : all) {
+        index_count[i.first] = 0;
+      }
+    }
+    MergedSource<T> source(files, &m_filter);
+    while (source.Next(&shot)) {
+      if (m_getnext && shot.time.tv_usec != all[shot.ticker][index_count[shot.ticker]].time.tv_usec) {
+        printf("not correct!\n");
+        exit(1);
+      }
+      T* next_shot = GetNext(&shot);
+      HandleShot(&shot, next_shot);
+    }
+  }
+
+  // replays a day decoded once elsewhere, the cache is shared read only between handlers
+  void Replay(const ReplayCache<T> & cache) {
+    T shot;
+    T next;
+    for (size_t i = 0; i < cache.Size(); i++) {
+      if (!m_filter.Pass(cache.Shot(i))) {
+        continue;
+      }
+      shot = cache.Shot(i);
+      T* next_shot = &temp_shot;
+      if (m_getnext) {
+        next = cache.Shot(cache.Next(i));
+        next_shot = &next;
+      }
+      HandleShot(&shot, next_shot);
+    }
+  }
+
   inline T* GetNext(T* shot) {
     T* next_shot = nullptr;
     if (m_getnext) {
@@ -107,12 +202,27 @@ class DataHandler {
 
   virtual void HandleShot(T* this_shot, T* next_shot) = 0;
  private:
+  template <typename F>
+  void ReadRanges(std::ifstream* raw_file, const std::vector<RecordRange> & ranges, F f) {
+    T shot;
+    for (auto & r : ranges) {
+      raw_file->clear();
+      raw_file->seekg(r.first * sizeof(T));
+      for (long long i = r.first; i < r.second && raw_file->read(reinterpret_cast<char *>(&shot), sizeof(shot)); i++) {
+        if (m_filter.Pass(shot)) {
+          f(&shot);
+        }
+      }
+    }
+  }
+
   bool m_getnext;
   T temp_shot;
   std::unordered_map<std::string, T> last_map;
   std::unordered_map<std::string, std::vector<T> > all;
   std::unordered_map<std::string, int> index_count;
   TimeController tc;
+  ShotFilter<T> m_filter;
 };
 
 #endif // DATA_HANDLER_HPP_
@@ -0,0 +1,456 @@
+#ifndef DAY_INDEX_HPP_
+#define DAY_INDEX_HPP_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "struct/market_snapshot.h"
+#include "util/common_tools.h"
+#include "util/shot_filter.hpp"
+
+#define INDEX_BLOCK_RECORDS 65536
+
+struct TickerIndex {
+  long long count;
+  timeval first_time;
+  timeval last_time;
+  long long first_record;
+  long long last_record;
+  long long disorder;  // records older than the previous record of the same ticker
+
+  TickerIndex()
+    : count(0),
+      first_time(),
+      last_time(),
+      first_record(0),
+      last_record(0),
+      disorder(0) {
+  }
+};
+
+struct BlockIndex {
+  long long first_record;
+  long long count;
+  timeval min_time;
+  timeval max_time;
+
+  BlockIndex()
+    : first_record(0),
+      count(0),
+      min_time(),
+      max_time() {
+  }
+};
+
+typedef std::pair<long long, long long> RecordRange;
+
+// integrity and layout of one day file, kept in a small text file next to it:
+// per ticker count and first/last time, time order violations, where the complete
+// records end, and the time span of every block of INDEX_BLOCK_RECORDS records
+class DayIndex {
+ public:
+  explicit DayIndex(const std::string & data_file)
+    : data_file(data_file),
+      index_file(IndexPath(data_file)),
+      is_gz(Split(data_file, ".").back() == "gz"),
+      records(0),
+      tail_bytes(0),
+      broken(false),
+      disorder(0),
+      is_loaded(false) {
+  }
+
+  ~DayIndex() {
+  }
+
+  static std::string IndexPath(const std::string & data_file) {
+    return data_file + ".idx";
+  }
+
+  // load the sidecar, rebuild it from the day file when missing or older than the data
+  bool Ensure(int thread_num = 0) {
+    if (is_loaded) {
+      return true;
+    }
+    if (IsFresh() && Load()) {
+      return true;
+    }
+    return Build(thread_num) && Save();
+  }
+
+  // only a sidecar written after the last change of the day file is trusted
+  bool LoadIfFresh() {
+    return is_loaded || (IsFresh() && Load());
+  }
+
+  bool Load() {
+    std::ifstream f(index_file.c_str());
+    if (!f) {
+      return false;
+    }
+    Clear();
+    std::string line;
+    int record_size = 0;
+    int is_broken = 0;
+    bool ok = true;
+    while (ok && getline(f, line)) {
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      char ticker[MAX_TICKER_LENGTH];
+      TickerIndex t;
+      BlockIndex b;
+      if (line[0] == 'F') {
+        ok = sscanf(line.c_str(), "F %d %lld %lld %d %lld", &record_size, &records, &tail_bytes, &is_broken, &disorder) == 5;
+      } else if (line[0] == 'T') {
+        ok = sscanf(line.c_str(), "T %31s %lld %ld %ld %ld %ld %lld %lld %lld", ticker, &t.count,
+                    &t.first_time.tv_sec, &t.first_time.tv_usec, &t.last_time.tv_sec, &t.last_time.tv_usec,
+                    &t.first_record, &t.last_record, &t.disorder) == 9;
+        ticker_map[ticker] = t;
+      } else if (line[0] == 'B') {
+        ok = sscanf(line.c_str(), "B %lld %lld %ld %ld %ld %ld", &b.first_record, &b.count,
+                    &b.min_time.tv_sec, &b.min_time.tv_usec, &b.max_time.tv_sec, &b.max_time.tv_usec) == 6;
+        blocks.push_back(b);
+      } else {
+        ok = false;
+      }
+    }
+    if (!ok || record_size != static_cast<int>(sizeof(MarketSnapshot))) {
+      printf("broken or outdated index %s\n", index_file.c_str());
+      Clear();
+      return false;
+    }
+    broken = is_broken != 0;
+    is_loaded = true;
+    return true;
+  }
+
+  // .dat blocks are scanned in parallel with pread, .gz has to be inflated in order
+  bool Build(int thread_num = 0) {
+    Clear();
+    std::vector<Scan> scans;
+    if (is_gz) {
+      if (!ScanGz(&scans)) {
+        return false;
+      }
+    } else if (!ScanDat(&scans, thread_num)) {
+      return false;
+    }
+    for (auto & s : scans) {
+      Merge(s);
+    }
+    for (auto & i : ticker_map) {
+      disorder += i.second.disorder;
+    }
+    is_loaded = true;
+    return true;
+  }
+
+  // written to a temp file first, so a concurrent reader never sees half an index
+  bool Save() const {
+    // a unique name per call, threads and processes saving the same day never share one
+    std::string temp_file = index_file + ".tmpXXXXXX";
+    int fd = mkstemp(&temp_file[0]);
+    FILE* f = fd < 0 ? nullptr : fdopen(fd, "w");
+    if (!f) {
+      printf("can't write index %s\n", temp_file.c_str());
+      if (fd >= 0) {
+        close(fd);
+        remove(temp_file.c_str());
+      }
+      return false;
+    }
+    fchmod(fd, 0644);
+    fprintf(f, "# F record_size records tail_bytes broken disorder\n");
+    fprintf(f, "# T ticker count first_sec first_usec last_sec last_usec first_record last_record disorder\n");
+    fprintf(f, "# B first_record count min_sec min_usec max_sec max_usec\n");
+    fprintf(f, "F %d %lld %lld %d %lld\n", static_cast<int>(sizeof(MarketSnapshot)), records, tail_bytes, broken ? 1 : 0, disorder);
+    for (auto & i : ticker_map) {
+      const TickerIndex & t = i.second;
+      fprintf(f, "T %s %lld %ld %ld %ld %ld %lld %lld %lld\n", i.first.c_str(), t.count,
+              t.first_time.tv_sec, t.first_time.tv_usec, t.last_time.tv_sec, t.last_time.tv_usec,
+              t.first_record, t.last_record, t.disorder);
+    }
+    for (auto & b : blocks) {
+      fprintf(f, "B %lld %lld %ld %ld %ld %ld\n", b.first_record, b.count,
+              b.min_time.tv_sec, b.min_time.tv_usec, b.max_time.tv_sec, b.max_time.tv_usec);
+    }
+    fclose(f);
+    if (rename(temp_file.c_str(), index_file.c_str()) != 0) {
+      printf("rename %s failed\n", temp_file.c_str());
+      remove(temp_file.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  // something worth replaying is there
+  bool Usable() const {
+    return is_loaded && records > 0;
+  }
+
+  // nothing cut off, nothing out of order
+  bool Clean() const {
+    return Usable() && tail_bytes == 0 && !broken && disorder == 0;
+  }
+
+  std::string Problem() const {
+    if (!is_loaded) {
+      return "no index";
+    }
+    std::string s;
+    if (records == 0) {
+      s += " no complete record;";
+    }
+    if (tail_bytes > 0) {
+      s += " " + std::to_string(tail_bytes) + " bytes of half record at " + std::to_string(TailOffset()) + ";";
+    }
+    if (broken) {
+      s += " stream broken after record " + std::to_string(records) + ";";
+    }
+    if (disorder > 0) {
+      s += " " + std::to_string(disorder) + " records out of time order;";
+    }
+    return s.empty() ? "clean" : s.substr(1);
+  }
+
+  // [begin, end) record ranges that may hold a record passing the filter, blocks
+  // outside the filter's tickers or time windows are left out
+  template <typename T>
+  std::vector<RecordRange> Ranges(const ShotFilter<T> & filter) const {
+    std::vector<RecordRange> ranges;
+    long long begin = 0;
+    long long end = records;
+    if (filter.HasTickers()) {
+      begin = records;
+      end = 0;
+      for (auto & ticker : filter.GetTickers()) {
+        auto it = ticker_map.find(ticker);
+        if (it != ticker_map.end()) {
+          begin = std::min(begin, it->second.first_record);
+          end = std::max(end, it->second.last_record + 1);
+        }
+      }
+    }
+    for (auto & b : blocks) {
+      long long rb = std::max(b.first_record, begin);
+      long long re = std::min(b.first_record + b.count, end);
+      if (rb >= re || !filter.PassTimeRange(b.min_time, b.max_time)) {
+        continue;
+      }
+      if (!ranges.empty() && ranges.back().second == rb) {
+        ranges.back().second = re;
+      } else {
+        ranges.push_back(RecordRange(rb, re));
+      }
+    }
+    return ranges;
+  }
+
+  long long Records() const {
+    return records;
+  }
+
+  // byte offset in the (inflated) stream where the complete records end
+  long long TailOffset() const {
+    return records * static_cast<long long>(sizeof(MarketSnapshot));
+  }
+
+  long long TailBytes() const {
+    return tail_bytes;
+  }
+
+  long long Disorder() const {
+    return disorder;
+  }
+
+  const std::map<std::string, TickerIndex> & Get() const {
+    return ticker_map;
+  }
+
+  const std::vector<BlockIndex> & Blocks() const {
+    return blocks;
+  }
+
+ private:
+  struct Scan {
+    BlockIndex block;
+    std::map<std::string, TickerIndex> ticker_map;
+  };
+
+  static bool Less(const timeval & a, const timeval & b) {
+    return a.tv_sec < b.tv_sec || (a.tv_sec == b.tv_sec && a.tv_usec < b.tv_usec);
+  }
+
+  static void ScanBlock(const MarketSnapshot* shots, long long n, long long first_record, Scan* s) {
+    s->block.first_record = first_record;
+    s->block.count = n;
+    for (long long i = 0; i < n; i++) {
+      const MarketSnapshot & shot = shots[i];
+      if (i == 0 || Less(shot.time, s->block.min_time)) {
+        s->block.min_time = shot.time;
+      }
+      if (i == 0 || Less(s->block.max_time, shot.time)) {
+        s->block.max_time = shot.time;
+      }
+      std::string ticker(shot.ticker, strnlen(shot.ticker, MAX_TICKER_LENGTH));
+      TickerIndex & t = s->ticker_map[ticker];
+      if (t.count == 0) {
+        t.first_time = shot.time;
+        t.first_record = first_record + i;
+      } else if (Less(shot.time, t.last_time)) {
+        t.disorder++;
+      }
+      t.count++;
+      t.last_time = shot.time;
+      t.last_record = first_record + i;
+    }
+  }
+
+  bool ScanDat(std::vector<Scan>* scans, int thread_num) {
+    int fd = open(data_file.c_str(), O_RDONLY);
+    if (fd < 0) {
+      printf("%s is not existed!\n", data_file.c_str());
+      return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    long long total = st.st_size / static_cast<long long>(sizeof(MarketSnapshot));
+    tail_bytes = st.st_size % static_cast<long long>(sizeof(MarketSnapshot));
+    size_t block_num = static_cast<size_t>((total + INDEX_BLOCK_RECORDS - 1) / INDEX_BLOCK_RECORDS);
+    scans->resize(block_num);
+    int worker_num = thread_num > 0 ? thread_num : std::max(1u, std::thread::hardware_concurrency());
+    worker_num = std::max(1, std::min(worker_num, static_cast<int>(block_num)));
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::vector<std::thread> workers;
+    for (int w = 0; w < worker_num; w++) {
+      workers.emplace_back([&]() {
+        std::vector<MarketSnapshot> buf(INDEX_BLOCK_RECORDS);
+        for (size_t b = next++; b < block_num; b = next++) {
+          long long first = static_cast<long long>(b) * INDEX_BLOCK_RECORDS;
+          long long n = std::min(static_cast<long long>(INDEX_BLOCK_RECORDS), total - first);
+          size_t bytes = n * sizeof(MarketSnapshot);
+          if (pread(fd, buf.data(), bytes, first * sizeof(MarketSnapshot)) != static_cast<ssize_t>(bytes)) {
+            failed = true;
+            return;
+          }
+          ScanBlock(buf.data(), n, first, &(*scans)[b]);
+        }
+      });
+    }
+    for (auto & t : workers) {
+      t.join();
+    }
+    close(fd);
+    if (failed) {
+      printf("read %s failed\n", data_file.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  bool ScanGz(std::vector<Scan>* scans) {
+    gzFile gzfp = gzopen(data_file.c_str(), "rb");
+    if (!gzfp) {
+      printf("gzfile open failed!%s\n", data_file.c_str());
+      return false;
+    }
+    gzbuffer(gzfp, 1 << 20);
+    std::vector<MarketSnapshot> buf(INDEX_BLOCK_RECORDS);
+    const unsigned want = INDEX_BLOCK_RECORDS * sizeof(MarketSnapshot);
+    long long first = 0;
+    while (true) {
+      int bytes = gzread(gzfp, buf.data(), want);
+      if (bytes < 0) {
+        // a truncated or corrupt .gz keeps what was inflated before the error
+        broken = true;
+        break;
+      }
+      long long n = bytes / static_cast<long long>(sizeof(MarketSnapshot));
+      if (n > 0) {
+        scans->push_back(Scan());
+        ScanBlock(buf.data(), n, first, &scans->back());
+        first += n;
+      }
+      if (static_cast<unsigned>(bytes) < want) {
+        tail_bytes = bytes % static_cast<long long>(sizeof(MarketSnapshot));
+        int err;
+        gzerror(gzfp, &err);
+        broken = (err != Z_OK && err != Z_STREAM_END);
+        break;
+      }
+    }
+    gzclose(gzfp);
+    return true;
+  }
+
+  void Merge(const Scan & s) {
+    blocks.push_back(s.block);
+    records += s.block.count;
+    for (auto & i : s.ticker_map) {
+      TickerIndex & t = ticker_map[i.first];
+      const TickerIndex & p = i.second;
+      if (t.count == 0) {
+        t = p;
+      } else {
+        if (Less(p.first_time, t.last_time)) {
+          t.disorder++;
+        }
+        t.count += p.count;
+        t.disorder += p.disorder;
+        t.last_time = p.last_time;
+        t.last_record = p.last_record;
+      }
+    }
+  }
+
+  bool IsFresh() const {
+    struct stat data_stat, index_stat;
+    if (stat(index_file.c_str(), &index_stat) != 0) {
+      return false;
+    }
+    if (stat(data_file.c_str(), &data_stat) != 0) {
+      return true;
+    }
+    return index_stat.st_mtime >= data_stat.st_mtime;
+  }
+
+  void Clear() {
+    ticker_map.clear();
+    blocks.clear();
+    records = 0;
+    tail_bytes = 0;
+    broken = false;
+    disorder = 0;
+    is_loaded = false;
+  }
+
+  std::string data_file;
+  std::string index_file;
+  bool is_gz;
+  long long records;
+  long long tail_bytes;
+  bool broken;
+  long long disorder;
+  std::map<std::string, TickerIndex> ticker_map;
+  std::vector<BlockIndex> blocks;
+  bool is_loaded;
+};
+
+#endif  // DAY_INDEX_HPP_
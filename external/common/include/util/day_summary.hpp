@@ -0,0 +1,218 @@
+#ifndef DAY_SUMMARY_HPP_
+#define DAY_SUMMARY_HPP_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "struct/market_snapshot.h"
+#include "util/common_tools.h"
+#include "util/history_worker.h"
+
+struct TickerSummary {
+  int volume;
+  double open_interest;
+  int count;
+  MarketSnapshot last_shot;
+
+  TickerSummary()
+    : volume(0),
+      open_interest(0.0),
+      count(0) {
+  }
+};
+
+// per-ticker end of day figures kept in a small text file next to the day data,
+// so main contract selection no longer has to decode a whole day of ticks
+class DaySummary {
+ public:
+  explicit DaySummary(const std::string & data_file)
+    : data_file(data_file),
+      summary_file(SummaryPath(data_file)),
+      is_loaded(false) {
+  }
+
+  ~DaySummary() {
+  }
+
+  static std::string SummaryPath(const std::string & data_file) {
+    return data_file + ".summary";
+  }
+
+  // load the sidecar, rebuild it from the day file when missing or older than the data
+  bool Ensure() {
+    if (is_loaded) {
+      return true;
+    }
+    if (IsFresh() && Load()) {
+      return true;
+    }
+    return Build() && Save();
+  }
+
+  bool Load() {
+    std::ifstream f(summary_file.c_str());
+    if (!f) {
+      return false;
+    }
+    summary_map.clear();
+    std::string line;
+    while (getline(f, line)) {
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      char ticker[MAX_TICKER_LENGTH];
+      TickerSummary ts;
+      if (sscanf(line.c_str(), "%31[^,],%d,%lf,%d", ticker, &ts.volume, &ts.open_interest, &ts.count) != 4) {
+        printf("broken summary line in %s: %s\n", summary_file.c_str(), line.c_str());
+        summary_map.clear();
+        return false;
+      }
+      snprintf(ts.last_shot.ticker, sizeof(ts.last_shot.ticker), "%s", ticker);
+      ts.last_shot.volume = ts.volume;
+      ts.last_shot.open_interest = ts.open_interest;
+      summary_map[ticker] = ts;
+    }
+    is_loaded = true;
+    return true;
+  }
+
+  bool Build() {
+    summary_map.clear();
+    MarketSnapshot shot;
+    std::string file_mode = Split(data_file, ".").back();
+    if (file_mode == "gz") {
+      gzFile gzfp = gzopen(data_file.c_str(), "rb");
+      if (!gzfp) {
+        printf("gzfile open failed!%s\n", data_file.c_str());
+        return false;
+      }
+      while (gzread(gzfp, &shot, sizeof(shot)) == sizeof(shot)) {
+        Add(shot);
+      }
+      gzclose(gzfp);
+    } else if (file_mode == "dat") {
+      std::ifstream raw_file(data_file.c_str(), ios::in|ios::binary);
+      if (!raw_file) {
+        printf("%s is not existed!\n", data_file.c_str());
+        return false;
+      }
+      while (raw_file.read(reinterpret_cast<char *>(&shot), sizeof(shot))) {
+        Add(shot);
+      }
+    } else {
+      printf("unknown mode %s\n", data_file.c_str());
+      return false;
+    }
+    is_loaded = true;
+    return true;
+  }
+
+  // written to a temp file first, so a concurrent reader never sees half a summary
+  bool Save() const {
+    // a unique name per call, threads and processes saving the same day never share one
+    std::string temp_file = summary_file + ".tmpXXXXXX";
+    int fd = mkstemp(&temp_file[0]);
+    FILE* f = fd < 0 ? nullptr : fdopen(fd, "w");
+    if (!f) {
+      printf("can't write summary %s\n", temp_file.c_str());
+      if (fd >= 0) {
+        close(fd);
+        remove(temp_file.c_str());
+      }
+      return false;
+    }
+    fchmod(fd, 0644);
+    fprintf(f, "# ticker,volume,open_interest,count\n");
+    for (auto & i : summary_map) {
+      fprintf(f, "%s,%d,%lf,%d\n", i.first.c_str(), i.second.volume, i.second.open_interest, i.second.count);
+    }
+    fclose(f);
+    if (rename(temp_file.c_str(), summary_file.c_str()) != 0) {
+      printf("rename %s failed\n", temp_file.c_str());
+      remove(temp_file.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  // replays the last known state of every ticker, same final volume_map/tick_map as LoadFile
+  void Feed(HistoryWorker* hw) const {
+    for (auto & i : summary_map) {
+      hw->UpdateByShot(i.second.last_shot);
+    }
+    hw->EnReady();
+  }
+
+  // contracts of one product ordered by final volume, most active first
+  std::vector<std::string> GetActiveContracts(const std::string & pro, int num = -1) const {
+    std::vector<std::pair<int, std::string> > v;
+    for (auto & i : summary_map) {
+      if (GetCon(i.first) == pro) {
+        v.push_back(std::make_pair(i.second.volume, i.first));
+      }
+    }
+    std::sort(v.begin(), v.end(), [](const std::pair<int, std::string> & a, const std::pair<int, std::string> & b) {
+      return a.first > b.first;
+    });
+    std::vector<std::string> r;
+    for (auto & i : v) {
+      if (num >= 0 && static_cast<int>(r.size()) >= num) {
+        break;
+      }
+      r.push_back(i.second);
+    }
+    return r;
+  }
+
+  const std::map<std::string, TickerSummary> & Get() const {
+    return summary_map;
+  }
+
+ private:
+  bool IsFresh() const {
+    struct stat data_stat, summary_stat;
+    if (stat(summary_file.c_str(), &summary_stat) != 0) {
+      return false;
+    }
+    if (stat(data_file.c_str(), &data_stat) != 0) {
+      return true;
+    }
+    return summary_stat.st_mtime >= data_stat.st_mtime;
+  }
+
+  inline void Add(const MarketSnapshot & shot) {
+    TickerSummary & ts = summary_map[shot.ticker];
+    ts.volume = shot.volume;
+    ts.open_interest = shot.open_interest;
+    ts.count++;
+    ts.last_shot = shot;
+  }
+
+  std::string data_file;
+  std::string summary_file;
+  std::map<std::string, TickerSummary> summary_map;
+  bool is_loaded;
+};
+
+// drop-in for HistoryWorker(file): goes through the sidecar instead of a full day scan
+inline void LoadHistory(HistoryWorker* hw, const std::string & data_file) {
+  DaySummary ds(data_file);
+  if (!ds.Ensure()) {
+    printf("no summary for %s, history is empty\n", data_file.c_str());
+    return;
+  }
+  ds.Feed(hw);
+}
+
+#endif  // DAY_SUMMARY_HPP_
@@ -0,0 +1,152 @@
+#ifndef FAST_NUMBER_HPP_
+#define FAST_NUMBER_HPP_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <algorithm>
+
+// %f of DBL_MAX is 309 integer digits
+#define MAX_FIXED_LENGTH 330
+
+// locale free number <-> text for bulk data conversion, replaces snprintf/atof per field
+namespace fast_number {
+
+static const double kPow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+  1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// writes v at p, returns the end, no terminating zero
+inline char* FormatUint(char* p, unsigned long long v) {
+  char temp[24];
+  int n = 0;
+  do {
+    temp[n++] = static_cast<char>('0' + v % 10);
+    v /= 10;
+  } while (v != 0);
+  while (n > 0) {
+    *p++ = temp[--n];
+  }
+  return p;
+}
+
+inline char* FormatInt(char* p, long long v) {
+  if (v < 0) {
+    *p++ = '-';
+    return FormatUint(p, 0ULL - static_cast<unsigned long long>(v));
+  }
+  return FormatUint(p, static_cast<unsigned long long>(v));
+}
+
+// same text as printf("%.*f"); the scaled value below 2^46 is off by less than 1/128,
+// so it rounds as printf does unless it is near a tie, which goes to snprintf as do
+// larger values
+inline char* FormatFixed(char* p, double v, int decimals = 6) {
+  double x = decimals < 0 || decimals > 9 ? 0.0 : fabs(v) * kPow10[decimals];
+  if (decimals < 0 || decimals > 9 || !(x < 7.0e13) || fabs(x - floor(x) - 0.5) < 1.0 / 64) {
+    char temp[MAX_FIXED_LENGTH];
+    int n = snprintf(temp, sizeof(temp), "%.*f", decimals, v);
+    n = std::min(n, static_cast<int>(sizeof(temp)) - 1);
+    memcpy(p, temp, n);
+    return p + n;
+  }
+  unsigned long long scaled = static_cast<unsigned long long>(llround(x));
+  unsigned long long unit = static_cast<unsigned long long>(kPow10[decimals]);
+  // printf keeps the sign of -0.0 and of negatives that round to zero
+  if (signbit(v)) {
+    *p++ = '-';
+  }
+  p = FormatUint(p, scaled / unit);
+  if (decimals > 0) {
+    *p++ = '.';
+    unsigned long long frac = scaled % unit;
+    for (int i = decimals - 1; i >= 0; i--) {
+      p[i] = static_cast<char>('0' + frac % 10);
+      frac /= 10;
+    }
+    p += decimals;
+  }
+  return p;
+}
+
+// parse [b, e), returns where it stopped, nullptr when no digit was consumed
+inline const char* ParseInt(const char* b, const char* e, long long* v) {
+  bool neg = false;
+  if (b < e && (*b == '-' || *b == '+')) {
+    neg = (*b == '-');
+    b++;
+  }
+  const char* start = b;
+  unsigned long long r = 0;
+  while (b < e && static_cast<unsigned>(*b - '0') < 10) {
+    r = r * 10 + static_cast<unsigned>(*b - '0');
+    b++;
+  }
+  if (b == start) {
+    return nullptr;
+  }
+  *v = neg ? -static_cast<long long>(r) : static_cast<long long>(r);
+  return b;
+}
+
+inline const char* ParseInt(const char* b, const char* e, int* v) {
+  long long r;
+  const char* p = ParseInt(b, e, &r);
+  if (p) {
+    *v = static_cast<int>(r);
+  }
+  return p;
+}
+
+// short decimals are exact like strtod (mantissa < 2^53 over an exact power of ten), the rest goes to strtod
+inline const char* ParseDouble(const char* b, const char* e, double* v) {
+  const char* begin = b;
+  bool neg = false;
+  if (b < e && (*b == '-' || *b == '+')) {
+    neg = (*b == '-');
+    b++;
+  }
+  unsigned long long mantissa = 0;
+  int digits = 0;
+  int frac_digits = 0;
+  const char* start = b;
+  while (b < e && static_cast<unsigned>(*b - '0') < 10) {
+    mantissa = mantissa * 10 + static_cast<unsigned>(*b - '0');
+    digits++;
+    b++;
+  }
+  if (b < e && *b == '.') {
+    b++;
+    while (b < e && static_cast<unsigned>(*b - '0') < 10) {
+      mantissa = mantissa * 10 + static_cast<unsigned>(*b - '0');
+      digits++;
+      frac_digits++;
+      b++;
+    }
+  }
+  if (b == start || (b == start + 1 && *start == '.')) {
+    return nullptr;
+  }
+  if (digits > 15 || frac_digits > 22 || (b < e && (*b == 'e' || *b == 'E' || *b == 'n' || *b == 'i'))) {
+    char temp[64];
+    size_t len = static_cast<size_t>(e - begin) < sizeof(temp) - 1 ? e - begin : sizeof(temp) - 1;
+    memcpy(temp, begin, len);
+    temp[len] = 0;
+    char* end;
+    *v = strtod(temp, &end);
+    return end == temp ? nullptr : begin + (end - temp);
+  }
+  double r = static_cast<double>(mantissa);
+  if (frac_digits > 0) {
+    r /= kPow10[frac_digits];
+  }
+  *v = neg ? -r : r;
+  return b;
+}
+
+}  // namespace fast_number
+
+#endif  // FAST_NUMBER_HPP_
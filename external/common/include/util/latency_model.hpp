@@ -0,0 +1,197 @@
+#ifndef LATENCY_MODEL_HPP_
+#define LATENCY_MODEL_HPP_
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "struct/exchange_info.h"
+#include "struct/order.h"
+
+#define LATENCY_SEED 20190101ULL
+
+inline long long TimevalUs(const timeval & t) {
+  return static_cast<long long>(t.tv_sec) * 1000000LL + t.tv_usec;
+}
+
+inline timeval UsTimeval(long long us) {
+  timeval t;
+  t.tv_sec = us / 1000000LL;
+  t.tv_usec = us % 1000000LL;
+  return t;
+}
+
+// one leg of delay in microseconds, sampled per message, parsed from a short spec:
+//   "fixed 200"                      always 200
+//   "uniform 100 400"                flat between the two
+//   "normal 250 60"                  mean and std, cut at 0
+//   "empirical lat.txt"              drawn from the numbers in the file, one per line
+//   "records order.dat exchange.dat" drawn from recorded round trips: send_time of each
+//                                    order to the show_time of its first exchange info
+// the offset is added to every sample, latency sweeps move it
+class LatencyModel {
+ public:
+  LatencyModel()
+    : kind(Fixed),
+      a(0.0),
+      b(0.0),
+      offset(0),
+      rng(LATENCY_SEED) {
+  }
+
+  bool Parse(const std::string & spec) {
+    std::istringstream in(spec);
+    std::string name;
+    in >> name;
+    if (name == "fixed" && in >> a) {
+      kind = Fixed;
+    } else if (name == "uniform" && in >> a >> b && b >= a) {
+      kind = Uniform;
+    } else if (name == "normal" && in >> a >> b && b >= 0) {
+      kind = Normal;
+    } else if (name == "empirical") {
+      std::string path;
+      in >> path;
+      kind = Empirical;
+      if (!LoadSamples(path)) {
+        return false;
+      }
+    } else if (name == "records") {
+      std::string order_file, exchange_file;
+      in >> order_file >> exchange_file;
+      kind = Empirical;
+      if (!LoadRecords(order_file, exchange_file)) {
+        return false;
+      }
+    } else {
+      printf("bad latency spec '%s'\n", spec.c_str());
+      return false;
+    }
+    this->spec = spec;
+    return true;
+  }
+
+  void Seed(unsigned long long seed) {
+    rng.seed(seed);
+  }
+
+  void SetOffset(long long us) {
+    offset = us;
+  }
+
+  long long Offset() const {
+    return offset;
+  }
+
+  long long Sample() {
+    double v = 0.0;
+    switch (kind) {
+     case Fixed:
+      v = a;
+      break;
+     case Uniform:
+      v = std::uniform_real_distribution<double>(a, b)(rng);
+      break;
+     case Normal:
+      v = std::normal_distribution<double>(a, b)(rng);
+      break;
+     case Empirical:
+      v = static_cast<double>((*samples)[std::uniform_int_distribution<size_t>(0, samples->size() - 1)(rng)]);
+      break;
+    }
+    return std::max(0LL, static_cast<long long>(v) + offset);
+  }
+
+  const std::string & Spec() const {
+    return spec;
+  }
+
+ private:
+  enum Kind {
+    Fixed,
+    Uniform,
+    Normal,
+    Empirical
+  };
+
+  bool LoadSamples(const std::string & path) {
+    std::ifstream f(path.c_str());
+    if (!f) {
+      printf("open %s failed!\n", path.c_str());
+      return false;
+    }
+    std::shared_ptr<std::vector<long long> > v(new std::vector<long long>);
+    double x;
+    while (f >> x) {
+      v->push_back(static_cast<long long>(x));
+    }
+    return SetSamples(v, path);
+  }
+
+  bool LoadRecords(const std::string & order_file, const std::string & exchange_file) {
+    std::ifstream of(order_file.c_str(), std::ios::in | std::ios::binary);
+    std::ifstream ef(exchange_file.c_str(), std::ios::in | std::ios::binary);
+    if (!of || !ef) {
+      printf("open %s or %s failed!\n", order_file.c_str(), exchange_file.c_str());
+      return false;
+    }
+    std::unordered_map<std::string, long long> sent;
+    Order o;
+    while (of.read(reinterpret_cast<char*>(&o), sizeof(o))) {
+      if (o.action == OrderAction::NewOrder) {
+        sent[o.order_ref] = TimevalUs(o.send_time);
+      }
+    }
+    std::shared_ptr<std::vector<long long> > v(new std::vector<long long>);
+    ExchangeInfo info;
+    while (ef.read(reinterpret_cast<char*>(&info), sizeof(info))) {
+      auto it = sent.find(info.order_ref);
+      if (it == sent.end()) {
+        continue;
+      }
+      long long d = TimevalUs(info.show_time) - it->second;
+      // clocks of two processes, drop what can't be a round trip
+      if (d >= 0 && d < 10000000LL) {
+        v->push_back(d);
+      }
+      sent.erase(it);
+    }
+    return SetSamples(v, exchange_file);
+  }
+
+  bool SetSamples(std::shared_ptr<std::vector<long long> > v, const std::string & from) {
+    if (v->empty()) {
+      printf("no latency samples in %s\n", from.c_str());
+      return false;
+    }
+    std::sort(v->begin(), v->end());
+    samples = v;
+    return true;
+  }
+
+  Kind kind;
+  double a;
+  double b;
+  long long offset;
+  std::string spec;
+  std::shared_ptr<const std::vector<long long> > samples;  // shared by the copies of a sweep
+  std::mt19937_64 rng;
+};
+
+// the three legs of a simulated round trip
+struct SimLatency {
+  LatencyModel market_data;  // recorded shot time to the strategy seeing it
+  LatencyModel submit;  // strategy to exchange
+  LatencyModel ack;  // exchange to strategy
+};
+
+#endif  // LATENCY_MODEL_HPP_
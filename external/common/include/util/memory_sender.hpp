@@ -0,0 +1,81 @@
+#ifndef MEMORY_SENDER_HPP_
+#define MEMORY_SENDER_HPP_
+
+#include <stdio.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "util/base_sender.hpp"
+
+#define MEMORY_SENDER_RESERVE 65536
+
+// keeps every sent record in a preallocated vector, for backtests: no socket, no
+// syscall per message, the records can be read back or dumped once the run is over
+// single writer, like a strategy's own senders; share one between threads and it breaks
+template <typename T>
+class MemorySender : public BaseSender <T> {
+ public:
+  explicit MemorySender(size_t reserve = MEMORY_SENDER_RESERVE) {
+    records.reserve(reserve);
+  }
+
+  ~MemorySender() {
+  }
+
+  inline void Send(const T & t) override {
+    records.push_back(t);
+  }
+
+  const std::vector<T> & Records() const {
+    return records;
+  }
+
+  size_t Size() const {
+    return records.size();
+  }
+
+  void Clear() {
+    records.clear();
+  }
+
+  // raw records back to back, the layout ZmqSender writes to its file, gzip when the
+  // path ends with .gz so the readers of day files take it as well
+  bool Dump(const std::string & path) const {
+    const char* data = reinterpret_cast<const char*>(records.data());
+    size_t bytes = records.size() * sizeof(T);
+    if (path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0) {
+      gzFile f = gzopen(path.c_str(), "wb1");
+      if (!f) {
+        printf("open %s failed!\n", path.c_str());
+        return false;
+      }
+      // gzwrite takes an unsigned length, feed it in slices
+      for (size_t done = 0; done < bytes;) {
+        unsigned int n = static_cast<unsigned int>(std::min<size_t>(bytes - done, 1 << 30));
+        if (gzwrite(f, data + done, n) != static_cast<int>(n)) {
+          printf("write %s failed!\n", path.c_str());
+          gzclose(f);
+          return false;
+        }
+        done += n;
+      }
+      return gzclose(f) == Z_OK;
+    }
+    std::ofstream f(path.c_str(), std::ios::out | std::ios::binary);
+    if (!f) {
+      printf("open %s failed!\n", path.c_str());
+      return false;
+    }
+    f.write(data, bytes);
+    return f.good();
+  }
+
+ private:
+  std::vector<T> records;
+};
+
+#endif  // MEMORY_SENDER_HPP_
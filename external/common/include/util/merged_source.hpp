@@ -0,0 +1,137 @@
+#ifndef MERGED_SOURCE_HPP_
+#define MERGED_SOURCE_HPP_
+
+#include <stdio.h>
+#include <sys/time.h>
+
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <queue>
+
+#include "struct/market_snapshot.h"
+#include "util/shot_filter.hpp"
+#include "util/shot_reader.hpp"
+#include "util/day_index.hpp"
+
+#define CURSOR_BUFFER_RECORDS 4096
+
+// forward only cursor over one day file, records not passing the filter are never surfaced
+template <typename T>
+class FileCursor {
+ public:
+  FileCursor(const std::string & file_path, const ShotFilter<T>* filter)
+    : reader(file_path),
+      filter(filter),
+      buf(CURSOR_BUFFER_RECORDS),
+      pos(0),
+      size(0) {
+  }
+
+  bool Good() const {
+    return reader.Good();
+  }
+
+  // moves to the next passing record, false at the end of the file
+  bool Next() {
+    while (true) {
+      if (++pos >= size) {
+        size = reader.Read(buf.data(), buf.size());
+        pos = 0;
+        if (size == 0) {
+          return false;
+        }
+      }
+      if (!filter || filter->Pass(buf[pos])) {
+        return true;
+      }
+    }
+  }
+
+  const T & Current() const {
+    return buf[pos];
+  }
+
+  const std::string & Path() const {
+    return reader.Path();
+  }
+
+ private:
+  ShotReader<T> reader;
+  const ShotFilter<T>* filter;
+  std::vector<T> buf;
+  size_t pos;
+  size_t size;
+};
+
+// k-way merge of several day files (day and night sessions, consecutive dates) into one
+// stream in global time order, a heap keeps the cursor holding the oldest record on top
+// equal times come out in file order, and every file keeps its own record order
+template <typename T>
+class MergedSource {
+ public:
+  explicit MergedSource(const std::vector<std::string> & files, const ShotFilter<T>* filter = nullptr) {
+    for (auto & f : files) {
+      DayIndex index(f);
+      if (std::is_same<T, MarketSnapshot>::value && index.LoadIfFresh() && !index.Usable()) {
+        printf("skip %s: %s\n", f.c_str(), index.Problem().c_str());
+        continue;
+      }
+      std::unique_ptr<FileCursor<T> > c(new FileCursor<T>(f, filter));
+      if (!c->Good()) {
+        printf("open %s failed!\n", f.c_str());
+        continue;
+      }
+      cursors.push_back(std::move(c));
+    }
+    for (size_t i = 0; i < cursors.size(); i++) {
+      // the first Next fills the buffer
+      if (cursors[i]->Next()) {
+        heap.push(i);
+      }
+    }
+  }
+
+  // copies the oldest record of all files into shot, false when every file is done
+  bool Next(T* shot) {
+    if (heap.empty()) {
+      return false;
+    }
+    size_t i = heap.top();
+    heap.pop();
+    *shot = cursors[i]->Current();
+    if (cursors[i]->Next()) {
+      heap.push(i);
+    }
+    return true;
+  }
+
+  size_t Files() const {
+    return cursors.size();
+  }
+
+ private:
+  struct Later {
+    explicit Later(const std::vector<std::unique_ptr<FileCursor<T> > >* c)
+      : cursors(c) {
+    }
+    bool operator()(size_t a, size_t b) const {
+      const timeval & ta = (*cursors)[a]->Current().time;
+      const timeval & tb = (*cursors)[b]->Current().time;
+      if (ta.tv_sec != tb.tv_sec) {
+        return ta.tv_sec > tb.tv_sec;
+      }
+      if (ta.tv_usec != tb.tv_usec) {
+        return ta.tv_usec > tb.tv_usec;
+      }
+      return a > b;
+    }
+    const std::vector<std::unique_ptr<FileCursor<T> > >* cursors;
+  };
+
+  std::vector<std::unique_ptr<FileCursor<T> > > cursors;
+  std::priority_queue<size_t, std::vector<size_t>, Later> heap{Later(&cursors)};
+};
+
+#endif  // MERGED_SOURCE_HPP_
@@ -0,0 +1,148 @@
+#ifndef ORDER_POOL_HPP_
+#define ORDER_POOL_HPP_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <vector>
+
+#define ORDER_REF_MAX_STRATEGIES 256
+#define ORDER_REF_NAME_SIZE 32
+
+// fixed capacity slab of T handed out by integer handles, all memory is taken up front
+// so Alloc and Free never touch the heap; a pool that is never freed from hands out
+// 0, 1, 2 ... in order
+template <typename T>
+class OrderPool {
+ public:
+  explicit OrderPool(int capacity)
+    : slots(capacity),
+      used(capacity, false) {
+    Clear();
+  }
+
+  ~OrderPool() {
+  }
+
+  // -1 when full
+  int Alloc() {
+    if (free_list.empty()) {
+      return -1;
+    }
+    int h = free_list.back();
+    free_list.pop_back();
+    used[h] = true;
+    slots[h] = T();
+    return h;
+  }
+
+  void Free(int h) {
+    if (Valid(h)) {
+      used[h] = false;
+      free_list.push_back(h);
+    }
+  }
+
+  // nullptr for a handle that is out of range or not allocated
+  T* Get(int h) {
+    return Valid(h) ? &slots[h] : nullptr;
+  }
+
+  const T* Get(int h) const {
+    return Valid(h) ? &slots[h] : nullptr;
+  }
+
+  bool Valid(int h) const {
+    return h >= 0 && h < static_cast<int>(slots.size()) && used[h];
+  }
+
+  int Capacity() const {
+    return slots.size();
+  }
+
+  int Size() const {
+    return slots.size() - free_list.size();
+  }
+
+  void Clear() {
+    free_list.clear();
+    free_list.reserve(slots.size());
+    for (int i = static_cast<int>(slots.size()) - 1; i >= 0; i--) {
+      used[i] = false;
+      free_list.push_back(i);
+    }
+  }
+
+ private:
+  std::vector<T> slots;
+  std::vector<bool> used;
+  std::vector<int> free_list;
+};
+
+// an order ref as integers: the strategy that sent it and its sequence number there
+struct OrderRef {
+  int strategy;
+  long long seq;
+};
+
+// BaseStrategy writes refs as "<strategy name><seq>"; the gateway turns them into
+// OrderRef once when an order comes in, and back into text only where it talks text
+// strategy ids are given out in order of first sight, no allocation after that
+class OrderRefCodec {
+ public:
+  OrderRefCodec()
+    : count(0) {
+  }
+
+  ~OrderRefCodec() {
+  }
+
+  bool Parse(const char* text, OrderRef* r) {
+    size_t n = 0;
+    while (text[n] && !isdigit(text[n])) {
+      n++;
+    }
+    if (text[n] == 0 || n >= ORDER_REF_NAME_SIZE) {
+      return false;
+    }
+    r->strategy = Strategy(text, n);
+    r->seq = atoll(text + n);
+    return r->strategy >= 0;
+  }
+
+  void Format(const OrderRef & r, char* buf, size_t size) const {
+    snprintf(buf, size, "%s%lld", Name(r.strategy), r.seq);
+  }
+
+  const char* Name(int strategy) const {
+    return strategy >= 0 && strategy < count ? names[strategy] : "";
+  }
+
+  int Strategies() const {
+    return count;
+  }
+
+ private:
+  // a handful of strategies per gateway, a scan beats hashing here
+  int Strategy(const char* name, size_t n) {
+    for (int i = 0; i < count; i++) {
+      if (strncmp(names[i], name, n) == 0 && names[i][n] == 0) {
+        return i;
+      }
+    }
+    if (count >= ORDER_REF_MAX_STRATEGIES) {
+      printf("more than %d strategies in order refs\n", ORDER_REF_MAX_STRATEGIES);
+      return -1;
+    }
+    memcpy(names[count], name, n);
+    names[count][n] = 0;
+    return count++;
+  }
+
+  char names[ORDER_REF_MAX_STRATEGIES][ORDER_REF_NAME_SIZE];
+  int count;
+};
+
+#endif  // ORDER_POOL_HPP_
@@ -0,0 +1,252 @@
+#ifndef PROCESS_POOL_HPP_
+#define PROCESS_POOL_HPP_
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+#define PROCESS_READ_BYTES 65536
+
+// runs tasks 0..n-1 in forked worker processes, so an exit(1) or a crash in one task
+// only costs that task and every worker starts from a clean heap
+// the only shared memory is the task cursor, workers claim the next task with one
+// fetch_add and stream "S i" when they start it and "R i len" + payload when done
+// over their own pipe; a worker that dies mid task is replaced and the task retried
+// in a fresh process up to retries times, then reported failed
+// fork before any thread is started: the children get the parent's state as is,
+// read only data loaded before Run is shared copy on write
+class ProcessPool {
+ public:
+  // max_tasks > 0 recycles a worker after that many tasks
+  ProcessPool(int processes, int retries = 1, int max_tasks = 0, const std::vector<int> & cpus = std::vector<int>())
+    : processes(std::max(1, processes)),
+      retries(std::max(0, retries)),
+      max_tasks(max_tasks),
+      cpus(cpus),
+      spawned(0) {
+  }
+
+  ~ProcessPool() {
+  }
+
+  // task(i) runs in a worker and returns the payload handed to done(i, payload) in
+  // the parent, failed(i) is called for the tasks that never finished
+  void Run(size_t n,
+           std::function<std::string(size_t)> task,
+           std::function<void(size_t, const std::string &)> done,
+           std::function<void(size_t)> failed) {
+    cursor = static_cast<std::atomic<size_t>*>(mmap(nullptr, sizeof(std::atomic<size_t>), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    if (cursor == MAP_FAILED) {
+      perror("mmap task cursor");
+      exit(1);
+    }
+    new (cursor) std::atomic<size_t>(0);
+    std::vector<int> attempts(n, 0);
+    std::vector<bool> finished(n, false);
+    std::deque<size_t> retry;
+    std::vector<Worker> workers;
+    size_t left = n;
+    while (left > 0) {
+      while (static_cast<int>(workers.size()) < processes && (!retry.empty() || cursor->load() < n)) {
+        long long first = -1;
+        if (!retry.empty()) {
+          first = retry.front();
+          retry.pop_front();
+        }
+        workers.push_back(Spawn(n, first, task));
+      }
+      if (workers.empty()) {
+        // claimed by a worker killed before it could say so
+        for (size_t i = 0; i < n; i++) {
+          if (!finished[i]) {
+            Lost(i, &attempts, &retry, &finished, &left, failed);
+          }
+        }
+        continue;
+      }
+      std::vector<pollfd> fds(workers.size());
+      for (size_t i = 0; i < workers.size(); i++) {
+        fds[i].fd = workers[i].fd;
+        fds[i].events = POLLIN;
+        fds[i].revents = 0;
+      }
+      if (poll(fds.data(), fds.size(), -1) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        perror("poll");
+        exit(1);
+      }
+      for (size_t i = workers.size(); i-- > 0;) {
+        if (fds[i].revents == 0) {
+          continue;
+        }
+        Worker & w = workers[i];
+        char buf[PROCESS_READ_BYTES];
+        ssize_t r = read(w.fd, buf, sizeof(buf));
+        if (r > 0) {
+          w.buffer.append(buf, r);
+          Parse(&w, &finished, &left, done);
+          continue;
+        }
+        if (r < 0 && errno == EINTR) {
+          continue;
+        }
+        // pipe closed, the worker is gone
+        close(w.fd);
+        int status = 0;
+        waitpid(w.pid, &status, 0);
+        if (w.current >= 0 && !finished[w.current]) {
+          if (WIFSIGNALED(status)) {
+            printf("worker %d killed by signal %d in task %lld\n", w.pid, WTERMSIG(status), w.current);
+          } else {
+            printf("worker %d exited with %d in task %lld\n", w.pid, WEXITSTATUS(status), w.current);
+          }
+          Lost(w.current, &attempts, &retry, &finished, &left, failed);
+        }
+        workers.erase(workers.begin() + i);
+      }
+    }
+    munmap(cursor, sizeof(std::atomic<size_t>));
+  }
+
+ private:
+  struct Worker {
+    pid_t pid;
+    int fd;
+    long long current;  // started and not reported yet, -1 when idle
+    std::string buffer;
+  };
+
+  Worker Spawn(size_t n, long long first, const std::function<std::string(size_t)> & task) {
+    int p[2];
+    if (pipe(p) != 0) {
+      perror("pipe");
+      exit(1);
+    }
+    int slot = spawned++;
+    // buffered output would be printed once by each child
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      exit(1);
+    }
+    if (pid == 0) {
+      close(p[0]);
+      if (!cpus.empty()) {
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        CPU_SET(cpus[slot % cpus.size()], &mask);
+        sched_setaffinity(0, sizeof(mask), &mask);
+      }
+      int count = 0;
+      while (max_tasks <= 0 || count < max_tasks) {
+        size_t i;
+        if (first >= 0) {
+          i = first;
+          first = -1;
+        } else {
+          i = cursor->fetch_add(1);
+          if (i >= n) {
+            break;
+          }
+        }
+        WriteAll(p[1], "S " + std::to_string(i) + "\n");
+        std::string payload = task(i);
+        WriteAll(p[1], "R " + std::to_string(i) + " " + std::to_string(payload.size()) + "\n" + payload);
+        count++;
+      }
+      fflush(stdout);
+      fflush(stderr);
+      _exit(0);
+    }
+    close(p[1]);
+    return Worker{pid, p[0], -1, std::string()};
+  }
+
+  // messages are read at an offset and the buffer is cut once, so a long payload
+  // arriving in many reads costs linear time
+  void Parse(Worker* w, std::vector<bool>* finished, size_t* left, const std::function<void(size_t, const std::string &)> & done) {
+    size_t pos = 0;
+    while (true) {
+      size_t eol = w->buffer.find('\n', pos);
+      if (eol == std::string::npos) {
+        break;
+      }
+      char type = 0;
+      unsigned long long i = 0, len = 0;
+      int fields = sscanf(w->buffer.substr(pos, eol - pos).c_str(), "%c %llu %llu", &type, &i, &len);
+      if (type == 'S' && fields >= 2) {
+        w->current = i;
+        pos = eol + 1;
+        continue;
+      }
+      if (type != 'R' || fields != 3) {
+        printf("bad message from worker %d\n", w->pid);
+        w->buffer.clear();
+        return;
+      }
+      if (w->buffer.size() < eol + 1 + len) {
+        break;
+      }
+      if (!(*finished)[i]) {
+        (*finished)[i] = true;
+        (*left)--;
+        done(i, w->buffer.substr(eol + 1, len));
+      }
+      w->current = -1;
+      pos = eol + 1 + len;
+    }
+    w->buffer.erase(0, pos);
+  }
+
+  void Lost(size_t i, std::vector<int>* attempts, std::deque<size_t>* retry, std::vector<bool>* finished, size_t* left, const std::function<void(size_t)> & failed) {
+    if (++(*attempts)[i] <= retries) {
+      retry->push_back(i);
+      return;
+    }
+    (*finished)[i] = true;
+    (*left)--;
+    failed(i);
+  }
+
+  static void WriteAll(int fd, const std::string & s) {
+    size_t off = 0;
+    while (off < s.size()) {
+      ssize_t w = write(fd, s.data() + off, s.size() - off);
+      if (w < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        // the parent is gone, nobody wants the rest
+        _exit(1);
+      }
+      off += w;
+    }
+  }
+
+  int processes;
+  int retries;
+  int max_tasks;
+  std::vector<int> cpus;
+  int spawned;
+  std::atomic<size_t>* cursor;
+};
+
+#endif  // PROCESS_POOL_HPP_
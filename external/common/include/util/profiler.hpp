@@ -0,0 +1,335 @@
+#ifndef PROFILER_HPP_
+#define PROFILER_HPP_
+
+#include <stdio.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// 16 linear buckets per power of two, values within 1/16 of their bucket, up to 2^48 ticks
+#define HIST_SUB_BITS 4
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_MAX_BITS 48
+#define HIST_BUCKETS ((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB)
+
+inline unsigned long long Tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// log linear histogram of tick counts, written by one thread and read by any
+class TickHistogram {
+ public:
+  TickHistogram()
+    : total(0),
+      max_ticks(0) {
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+      counts[i] = 0;
+    }
+  }
+
+  // the owner is the only writer, relaxed load + store are plain moves
+  void Record(unsigned long long ticks) {
+    std::atomic<unsigned long long> & c = counts[Bucket(ticks)];
+    c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    total.store(total.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+    if (ticks > max_ticks.load(std::memory_order_relaxed)) {
+      max_ticks.store(ticks, std::memory_order_relaxed);
+    }
+  }
+
+  static int Bucket(unsigned long long v) {
+    if (v < HIST_SUB) {
+      return static_cast<int>(v);
+    }
+    int e = 63 - __builtin_clzll(v);
+    if (e >= HIST_MAX_BITS) {
+      return HIST_BUCKETS - 1;
+    }
+    return (e - HIST_SUB_BITS + 1) * HIST_SUB + static_cast<int>((v >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1));
+  }
+
+  // the middle of the bucket
+  static double Value(int b) {
+    if (b < HIST_SUB) {
+      return b;
+    }
+    int e = b / HIST_SUB + HIST_SUB_BITS - 1;
+    double low = static_cast<double>(static_cast<unsigned long long>(HIST_SUB + b % HIST_SUB) << (e - HIST_SUB_BITS));
+    return low + static_cast<double>(1ULL << (e - HIST_SUB_BITS)) / 2;
+  }
+
+  struct Snapshot {
+    std::vector<unsigned long long> counts;
+    unsigned long long n;
+    unsigned long long total;
+    unsigned long long max_ticks;
+
+    Snapshot()
+      : counts(HIST_BUCKETS, 0),
+        n(0),
+        total(0),
+        max_ticks(0) {
+    }
+
+    // q in [0, 1], in ticks
+    double Percentile(double q) const {
+      if (n == 0) {
+        return 0.0;
+      }
+      unsigned long long rank = static_cast<unsigned long long>(q * (n - 1)) + 1;
+      unsigned long long seen = 0;
+      for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += counts[b];
+        if (seen >= rank) {
+          return std::min(Value(b), static_cast<double>(max_ticks));
+        }
+      }
+      return static_cast<double>(max_ticks);
+    }
+  };
+
+  void AddTo(Snapshot* s) const {
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+      unsigned long long c = counts[b].load(std::memory_order_relaxed);
+      s->counts[b] += c;
+      s->n += c;
+    }
+    s->total += total.load(std::memory_order_relaxed);
+    s->max_ticks = std::max(s->max_ticks, max_ticks.load(std::memory_order_relaxed));
+  }
+
+  void Reset() {
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+      counts[b].store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+    max_ticks.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<unsigned long long> counts[HIST_BUCKETS];
+  std::atomic<unsigned long long> total;
+  std::atomic<unsigned long long> max_ticks;
+};
+
+class Profiler;
+
+// a timed section of one owner (a strategy), with a histogram per thread that runs it
+class ProfilePoint {
+ public:
+  ProfilePoint(int id, const std::string & owner, const std::string & name)
+    : id(id),
+      owner(owner),
+      name(name) {
+  }
+
+  inline void Record(unsigned long long ticks);
+
+  const int id;
+  const std::string owner;
+  const std::string name;
+};
+
+// process wide registry of the points and of the per thread histograms, off until
+// Enable, then every ScopedProfile costs two rdtsc and a few stores
+class Profiler {
+ public:
+  static Profiler & Instance() {
+    static Profiler p;
+    return p;
+  }
+
+  static bool On() {
+    return Instance().enabled.load(std::memory_order_relaxed);
+  }
+
+  void Enable(bool on) {
+    enabled = on;
+  }
+
+  // the same owner and name give the same point
+  ProfilePoint* Point(const std::string & owner, const std::string & name) {
+    std::lock_guard<std::mutex> lck(mtx);
+    auto key = std::make_pair(owner, name);
+    auto it = index.find(key);
+    if (it != index.end()) {
+      return points[it->second].get();
+    }
+    index[key] = points.size();
+    points.emplace_back(new ProfilePoint(points.size(), owner, name));
+    return points.back().get();
+  }
+
+  // dispatchers only know the object, strategies name themselves here
+  void SetOwner(const void* p, const std::string & owner) {
+    std::lock_guard<std::mutex> lck(mtx);
+    owners[p] = owner;
+  }
+
+  ProfilePoint* PointOf(const void* p, const std::string & name) {
+    std::string owner;
+    {
+      std::lock_guard<std::mutex> lck(mtx);
+      auto it = owners.find(p);
+      if (it != owners.end()) {
+        owner = it->second;
+      } else {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%p", p);
+        owner = buffer;
+      }
+    }
+    return Point(owner, name);
+  }
+
+  TickHistogram* Local(int id) {
+    thread_local std::vector<TickHistogram*> local;
+    if (id >= static_cast<int>(local.size())) {
+      local.resize(id + 1, nullptr);
+    }
+    if (!local[id]) {
+      std::lock_guard<std::mutex> lck(mtx);
+      histograms.emplace_back(id, std::unique_ptr<TickHistogram>(new TickHistogram));
+      local[id] = histograms.back().second.get();
+    }
+    return local[id];
+  }
+
+  // percentiles in us per owner and section, merged over threads
+  void Print(FILE* f = stdout) {
+    double us_per_tick = UsPerTick();
+    std::vector<TickHistogram::Snapshot> snaps;
+    std::vector<ProfilePoint*> sorted;
+    {
+      std::lock_guard<std::mutex> lck(mtx);
+      snaps.resize(points.size());
+      for (auto & h : histograms) {
+        h.second->AddTo(&snaps[h.first]);
+      }
+      for (auto & p : points) {
+        sorted.push_back(p.get());
+      }
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const ProfilePoint* a, const ProfilePoint* b) {
+      return a->owner != b->owner ? a->owner < b->owner : a->name < b->name;
+    });
+    fprintf(f, "%-24s %-28s %12s %10s %10s %10s %10s %10s %12s %12s\n", "owner", "section", "count", "mean_us", "p50_us", "p90_us", "p99_us", "p999_us", "max_us", "total_ms");
+    for (auto p : sorted) {
+      const TickHistogram::Snapshot & s = snaps[p->id];
+      if (s.n == 0) {
+        continue;
+      }
+      fprintf(f, "%-24s %-28s %12llu %10.2lf %10.2lf %10.2lf %10.2lf %10.2lf %12.2lf %12.2lf\n", p->owner.c_str(), p->name.c_str(), s.n,
+              s.total * us_per_tick / s.n, s.Percentile(0.5) * us_per_tick, s.Percentile(0.9) * us_per_tick,
+              s.Percentile(0.99) * us_per_tick, s.Percentile(0.999) * us_per_tick, s.max_ticks * us_per_tick, s.total * us_per_tick / 1000);
+    }
+    fflush(f);
+  }
+
+  bool Write(const std::string & path) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+      printf("open %s failed!\n", path.c_str());
+      return false;
+    }
+    Print(f);
+    fclose(f);
+    return true;
+  }
+
+  void Reset() {
+    std::lock_guard<std::mutex> lck(mtx);
+    for (auto & h : histograms) {
+      h.second->Reset();
+    }
+  }
+
+ private:
+  Profiler()
+    : enabled(false),
+      us_per_tick(0.0) {
+  }
+
+  // tsc rate against the steady clock, measured once
+  double UsPerTick() {
+    if (us_per_tick <= 0.0) {
+      auto t0 = std::chrono::steady_clock::now();
+      unsigned long long c0 = Tsc();
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      unsigned long long c1 = Tsc();
+      double us = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count() / 1000.0;
+      us_per_tick = c1 > c0 ? us / (c1 - c0) : 1.0;
+    }
+    return us_per_tick;
+  }
+
+  std::atomic<bool> enabled;
+  double us_per_tick;
+  std::mutex mtx;
+  std::vector<std::unique_ptr<ProfilePoint> > points;
+  std::map<std::pair<std::string, std::string>, size_t> index;
+  std::map<const void*, std::string> owners;
+  std::vector<std::pair<int, std::unique_ptr<TickHistogram> > > histograms;
+};
+
+inline void ProfilePoint::Record(unsigned long long ticks) {
+  Profiler::Instance().Local(id)->Record(ticks);
+}
+
+// times its scope into the point, nothing but a flag check while the profiler is off
+class ScopedProfile {
+ public:
+  explicit ScopedProfile(ProfilePoint* p)
+    : point(p && Profiler::On() ? p : nullptr),
+      start(point ? Tsc() : 0) {
+  }
+
+  ~ScopedProfile() {
+    if (point) {
+      point->Record(Tsc() - start);
+    }
+  }
+
+ private:
+  ProfilePoint* point;
+  unsigned long long start;
+};
+
+// one callback (UpdateData, UpdateExchangeInfo) timed per strategy by a dispatcher,
+// used by a single thread
+class CallbackProfile {
+ public:
+  explicit CallbackProfile(const std::string & name)
+    : name(name) {
+  }
+
+  ProfilePoint* Of(const void* owner) {
+    auto it = points.find(owner);
+    if (it != points.end()) {
+      return it->second;
+    }
+    return points[owner] = Profiler::Instance().PointOf(owner, name);
+  }
+
+ private:
+  std::string name;
+  std::unordered_map<const void*, ProfilePoint*> points;
+};
+
+#endif  // PROFILER_HPP_
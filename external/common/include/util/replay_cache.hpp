@@ -0,0 +1,61 @@
+#ifndef REPLAY_CACHE_HPP_
+#define REPLAY_CACHE_HPP_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "util/shot_filter.hpp"
+#include "util/merged_source.hpp"
+
+// day data decoded once and shared read only by any number of handlers, with the
+// GetNext lookahead precomputed: Next(i) is the following record of the same ticker
+template <typename T>
+class ReplayCache {
+ public:
+  ReplayCache() {
+  }
+
+  ~ReplayCache() {
+  }
+
+  size_t Load(const std::vector<std::string> & files, const ShotFilter<T>* filter = nullptr) {
+    shots.clear();
+    next.clear();
+    MergedSource<T> source(files, filter);
+    T shot;
+    std::unordered_map<std::string, size_t> last;
+    while (source.Next(&shot)) {
+      size_t i = shots.size();
+      shots.push_back(shot);
+      next.push_back(i);
+      auto it = last.find(shot.ticker);
+      if (it != last.end()) {
+        next[it->second] = i;
+        it->second = i;
+      } else {
+        last[shot.ticker] = i;
+      }
+    }
+    return shots.size();
+  }
+
+  size_t Size() const {
+    return shots.size();
+  }
+
+  const T & Shot(size_t i) const {
+    return shots[i];
+  }
+
+  // the last record of a ticker points to itself, like DataHandler::GetNext
+  size_t Next(size_t i) const {
+    return next[i];
+  }
+
+ private:
+  std::vector<T> shots;
+  std::vector<size_t> next;
+};
+
+#endif  // REPLAY_CACHE_HPP_
@@ -0,0 +1,168 @@
+#ifndef REPLAY_CLOCK_HPP_
+#define REPLAY_CLOCK_HPP_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "util/common_tools.h"
+
+// below this the wait spins, the scheduler wakes a sleeper tens of us late
+#define REPLAY_SPIN_US 100
+
+// paces a replay by the recorded timestamps: the first record is sent at once, every
+// later one when the wall clock has moved (record time - first record time) / speed
+// modes, as parsed from a short spec:
+//   "max"       no waiting, as fast as the data can be read
+//   "realtime"  the recorded pace
+//   "10x"       ten times the recorded pace, any positive factor
+//   "step"      one record per enter, "n" + enter releases n records, a mode spec
+//               switches to that mode
+// max_gap_sec > 0 cuts longer pauses (lunch, the night) to that, so a day with its
+// breaks still replays in compressed time
+class ReplayClock {
+ public:
+  ReplayClock()
+    : mode(Max),
+      speed(1.0),
+      max_gap_us(0),
+      started(false),
+      first_us(0),
+      last_us(0),
+      shift_us(0),
+      step_left(0),
+      lag_us(0),
+      max_lag_us(0) {
+  }
+
+  ~ReplayClock() {
+  }
+
+  bool Parse(const std::string & spec) {
+    if (spec == "max") {
+      mode = Max;
+    } else if (spec == "realtime") {
+      mode = Paced;
+      speed = 1.0;
+    } else if (spec == "step") {
+      mode = Step;
+      step_left = 0;
+    } else if (!spec.empty() && spec.back() == 'x' && atof(spec.c_str()) > 0) {
+      mode = Paced;
+      speed = atof(spec.c_str());
+    } else {
+      printf("bad replay mode '%s', use max, realtime, step or <N>x\n", spec.c_str());
+      return false;
+    }
+    // a new pace counts from the next record
+    started = false;
+    return true;
+  }
+
+  void SetMaxGap(double sec) {
+    max_gap_us = static_cast<long long>(sec * 1000000);
+  }
+
+  // blocks until the record stamped t is due
+  void Wait(const timeval & t) {
+    long long us = static_cast<long long>(t.tv_sec) * 1000000LL + t.tv_usec;
+    if (mode == Step) {
+      WaitStep();
+      return;
+    }
+    if (mode == Max) {
+      return;
+    }
+    if (!started) {
+      started = true;
+      first_us = us;
+      last_us = us;
+      shift_us = 0;
+      start = std::chrono::steady_clock::now();
+      return;
+    }
+    if (max_gap_us > 0 && us - last_us > max_gap_us) {
+      shift_us += us - last_us - max_gap_us;
+    }
+    // out of order records go at once, never move the clock back
+    if (us > last_us) {
+      last_us = us;
+    }
+    long long due_us = static_cast<long long>((last_us - first_us - shift_us) / speed);
+    std::chrono::steady_clock::time_point due = start + std::chrono::microseconds(due_us);
+    std::chrono::steady_clock::duration left = due - std::chrono::steady_clock::now();
+    if (left > std::chrono::microseconds(REPLAY_SPIN_US)) {
+      std::this_thread::sleep_for(left - std::chrono::microseconds(REPLAY_SPIN_US));
+      left = due - std::chrono::steady_clock::now();
+    }
+    if (left > std::chrono::steady_clock::duration::zero()) {
+      busy_sleep(std::chrono::duration_cast<std::chrono::nanoseconds>(left));
+      lag_us = 0;
+    } else {
+      lag_us = std::chrono::duration_cast<std::chrono::microseconds>(-left).count();
+      max_lag_us = std::max(max_lag_us, lag_us);
+    }
+  }
+
+  // how late the last record went out, and the worst so far, in us
+  long long Lag() const {
+    return lag_us;
+  }
+
+  long long MaxLag() const {
+    return max_lag_us;
+  }
+
+ private:
+  enum Mode {
+    Max,
+    Paced,
+    Step
+  };
+
+  void WaitStep() {
+    while (step_left == 0) {
+      printf("step> ");
+      fflush(stdout);
+      char line[64];
+      if (!fgets(line, sizeof(line), stdin)) {
+        // stdin closed, run out the rest
+        mode = Max;
+        return;
+      }
+      std::string s(line);
+      while (!s.empty() && (s.back() == '\n' || s.back() == '\r' || s.back() == ' ')) {
+        s.pop_back();
+      }
+      if (s.empty()) {
+        step_left = 1;
+      } else if (s.find_first_not_of("0123456789") == std::string::npos) {
+        step_left = atoll(s.c_str());
+      } else if (Parse(s)) {
+        if (mode != Step) {
+          return;
+        }
+      }
+    }
+    step_left--;
+  }
+
+  Mode mode;
+  double speed;
+  long long max_gap_us;
+  bool started;
+  long long first_us;
+  long long last_us;
+  long long shift_us;  // cut out of the pauses longer than max_gap
+  long long step_left;
+  long long lag_us;
+  long long max_lag_us;
+  std::chrono::steady_clock::time_point start;
+};
+
+#endif  // REPLAY_CLOCK_HPP_
@@ -0,0 +1,401 @@
+#ifndef ROLLING_STATS_HPP_
+#define ROLLING_STATS_HPP_
+
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+// fixed capacity ring, the oldest value drops out when a new one comes into a full ring
+// [0] is the oldest, Back() the newest
+template <typename T>
+class RingBuffer {
+ public:
+  explicit RingBuffer(int capacity = 0) {
+    Reset(capacity);
+  }
+
+  ~RingBuffer() {
+  }
+
+  void Reset(int capacity) {
+    data.assign(std::max(capacity, 1), T());
+    head = 0;
+    count = 0;
+  }
+
+  // true when old was pushed out to make room
+  bool Push(const T & v, T* old = nullptr) {
+    int cap = Capacity();
+    int tail = head + count;
+    if (tail >= cap) {
+      tail -= cap;
+    }
+    bool full = count == cap;
+    if (full) {
+      if (old) {
+        *old = data[tail];
+      }
+      head = head + 1 == cap ? 0 : head + 1;
+    } else {
+      count++;
+    }
+    data[tail] = v;
+    return full;
+  }
+
+  const T & operator[](int i) const {
+    int j = head + i;
+    return data[j >= Capacity() ? j - Capacity() : j];
+  }
+
+  const T & Back() const {
+    return (*this)[count - 1];
+  }
+
+  const T & Front() const {
+    return data[head];
+  }
+
+  int Size() const {
+    return count;
+  }
+
+  int Capacity() const {
+    return data.size();
+  }
+
+  bool Full() const {
+    return count == Capacity();
+  }
+
+  bool Empty() const {
+    return count == 0;
+  }
+
+  void Clear() {
+    head = 0;
+    count = 0;
+  }
+
+ private:
+  std::vector<T> data;
+  int head;
+  int count;
+};
+
+// max (or min with Less = false) of the last n pushed values, a monotonic deque on a
+// fixed ring: every value goes in and out once, so Push is O(1) amortized
+template <bool Less>
+class WindowExtremeBase {
+ public:
+  explicit WindowExtremeBase(int window = 0) {
+    Reset(window);
+  }
+
+  ~WindowExtremeBase() {
+  }
+
+  void Reset(int window) {
+    n = std::max(window, 1);
+    ring.assign(n, Item{0, 0.0});
+    head = 0;
+    count = 0;
+    seq = 0;
+  }
+
+  void Push(double v) {
+    // out of the window
+    if (count > 0 && ring[head].seq + n <= seq) {
+      head = head + 1 == n ? 0 : head + 1;
+      count--;
+    }
+    // dominated by the new value
+    while (count > 0 && Worse(ring[Index(count - 1)].value, v)) {
+      count--;
+    }
+    ring[Index(count)] = Item{seq++, v};
+    count++;
+  }
+
+  // the extreme of the window, 0 before any push
+  double Value() const {
+    return count > 0 ? ring[head].value : 0.0;
+  }
+
+  void Clear() {
+    head = 0;
+    count = 0;
+    seq = 0;
+  }
+
+ private:
+  struct Item {
+    long long seq;
+    double value;
+  };
+
+  static bool Worse(double old_v, double v) {
+    return Less ? old_v <= v : old_v >= v;
+  }
+
+  int Index(int i) const {
+    int j = head + i;
+    return j >= n ? j - n : j;
+  }
+
+  int n;
+  std::vector<Item> ring;
+  int head;
+  int count;
+  long long seq;
+};
+
+typedef WindowExtremeBase<true> WindowMax;
+typedef WindowExtremeBase<false> WindowMin;
+
+// the newest of the last n values against the extreme of the n - 1 before it, so a
+// breakout check asks Margin() instead of copying and scanning the window; the
+// extreme of the whole window is max(Newest(), Prior()); O(1) amortized per push
+template <bool Less>
+class RecentExtremeBase {
+ public:
+  explicit RecentExtremeBase(int window = 2) {
+    Reset(window);
+  }
+
+  ~RecentExtremeBase() {
+  }
+
+  void Reset(int window) {
+    n = std::max(window, 2);
+    prior.Reset(n - 1);
+    newest = 0.0;
+    count = 0;
+  }
+
+  void Push(double v) {
+    if (count > 0) {
+      prior.Push(newest);
+    }
+    newest = v;
+    count = std::min(count + 1, n);
+  }
+
+  double Newest() const {
+    return newest;
+  }
+
+  // the max (min) of the values before the newest one, 0 with less than two values
+  double Prior() const {
+    return prior.Value();
+  }
+
+  // how far the newest value is beyond the prior extreme, negative when it is not
+  double Margin() const {
+    return Less ? newest - prior.Value() : prior.Value() - newest;
+  }
+
+  // how many values are in the window, at most n
+  int Size() const {
+    return count;
+  }
+
+  int Window() const {
+    return n;
+  }
+
+  void Clear() {
+    prior.Clear();
+    newest = 0.0;
+    count = 0;
+  }
+
+ private:
+  int n;
+  WindowExtremeBase<Less> prior;
+  double newest;
+  int count;
+};
+
+typedef RecentExtremeBase<true> RecentHigh;
+typedef RecentExtremeBase<false> RecentLow;
+
+// mean, std, min and max of the last n values, O(1) per push and memory bounded by n
+// mean and variance follow Welford with removal; the sums are rebuilt from the ring
+// once every n pushes, so rounding never builds up over a session
+// Std is the population std, as CalMeanStd gives
+class RollingStats {
+ public:
+  explicit RollingStats(int window = 0) {
+    Reset(window);
+  }
+
+  ~RollingStats() {
+  }
+
+  void Reset(int window) {
+    ring.Reset(window);
+    max_w.Reset(window);
+    min_w.Reset(window);
+    mean = 0.0;
+    m2 = 0.0;
+    since_sync = 0;
+  }
+
+  void Push(double v) {
+    double old = 0.0;
+    if (ring.Push(v, &old)) {
+      // replace old by v, the count stays n
+      int n = ring.Size();
+      double delta = v - old;
+      double new_mean = mean + delta / n;
+      m2 += delta * (v - new_mean + old - mean);
+      mean = new_mean;
+    } else {
+      int n = ring.Size();
+      double delta = v - mean;
+      mean += delta / n;
+      m2 += delta * (v - mean);
+    }
+    max_w.Push(v);
+    min_w.Push(v);
+    if (++since_sync >= ring.Capacity()) {
+      Sync();
+    }
+  }
+
+  double Mean() const {
+    return mean;
+  }
+
+  double Var() const {
+    return ring.Size() > 0 ? std::max(m2, 0.0) / ring.Size() : 0.0;
+  }
+
+  double Std() const {
+    return sqrt(Var());
+  }
+
+  // how many stds v is off the mean, 0 for a flat window
+  double ZScore(double v) const {
+    double s = Std();
+    return s > 0.0 ? (v - mean) / s : 0.0;
+  }
+
+  double Max() const {
+    return max_w.Value();
+  }
+
+  double Min() const {
+    return min_w.Value();
+  }
+
+  double Back() const {
+    return ring.Empty() ? 0.0 : ring.Back();
+  }
+
+  int Size() const {
+    return ring.Size();
+  }
+
+  int Window() const {
+    return ring.Capacity();
+  }
+
+  bool Full() const {
+    return ring.Full();
+  }
+
+  void Clear() {
+    Reset(ring.Capacity());
+  }
+
+ private:
+  void Sync() {
+    int n = ring.Size();
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) {
+      sum += ring[i];
+    }
+    mean = sum / n;
+    m2 = 0.0;
+    for (int i = 0; i < n; i++) {
+      m2 += (ring[i] - mean) * (ring[i] - mean);
+    }
+    since_sync = 0;
+  }
+
+  RingBuffer<double> ring;
+  WindowMax max_w;
+  WindowMin min_w;
+  double mean;
+  double m2;
+  int since_sync;
+};
+
+// exponentially weighted mean and variance, alpha is the weight of the newest value
+// the first value seeds the mean
+class Ewma {
+ public:
+  explicit Ewma(double alpha = 0.0)
+    : alpha(alpha),
+      mean(0.0),
+      var(0.0),
+      count(0) {
+  }
+
+  ~Ewma() {
+  }
+
+  // the alpha whose weights have the center of mass of a simple window of n
+  static double AlphaOf(int n) {
+    return 2.0 / (std::max(n, 1) + 1);
+  }
+
+  void Push(double v) {
+    if (count++ == 0) {
+      mean = v;
+      var = 0.0;
+      return;
+    }
+    double delta = v - mean;
+    mean += alpha * delta;
+    var = (1 - alpha) * (var + alpha * delta * delta);
+  }
+
+  double Mean() const {
+    return mean;
+  }
+
+  double Var() const {
+    return var;
+  }
+
+  double Std() const {
+    return sqrt(var);
+  }
+
+  double ZScore(double v) const {
+    double s = Std();
+    return s > 0.0 ? (v - mean) / s : 0.0;
+  }
+
+  long long Count() const {
+    return count;
+  }
+
+  void Clear() {
+    mean = 0.0;
+    var = 0.0;
+    count = 0;
+  }
+
+ private:
+  double alpha;
+  double mean;
+  double var;
+  long long count;
+};
+
+#endif  // ROLLING_STATS_HPP_
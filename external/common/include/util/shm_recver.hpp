@@ -26,6 +26,14 @@ class ShmRecver : public ShmWorker, BaseRecver <T> {
     read_index.fetch_add(1);
   }
 
+  inline bool TryRecv(T& t) override {
+    if (read_index.load() == ((atomic_int*)(m_data + 2*sizeof(int)))->load()) {
+      return false;
+    }
+    Recv(t);
+    return true;
+  }
+
  private:
   atomic<int> read_index;
   std::unique_ptr<ofstream> f;
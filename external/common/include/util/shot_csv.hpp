@@ -0,0 +1,63 @@
+#ifndef SHOT_CSV_HPP_
+#define SHOT_CSV_HPP_
+
+#include "struct/market_snapshot.h"
+#include "util/fast_number.hpp"
+
+// longest row ShotToCsv can produce, every double may fall back to wide %f text
+#define MAX_CSV_ROW_LENGTH (MAX_TICKER_LENGTH + 14 * MAX_FIXED_LENGTH + 16 * 24)
+
+// byte for byte the row of MarketSnapshot::ToCsv(), without snprintf
+inline char* ShotToCsv(const MarketSnapshot & shot, char* p, bool with_ln = true) {
+  using fast_number::FormatFixed;
+  using fast_number::FormatInt;
+  for (const char* t = shot.ticker; *t && t < shot.ticker + MAX_TICKER_LENGTH; t++) {
+    *p++ = *t;
+  }
+  for (int i = 0; i < MARKET_DATA_DEPTH; i++) {
+    *p++ = ',';
+    p = FormatFixed(p, shot.bids[i]);
+  }
+  for (int i = 0; i < MARKET_DATA_DEPTH; i++) {
+    *p++ = ',';
+    p = FormatFixed(p, shot.asks[i]);
+  }
+  for (int i = 0; i < MARKET_DATA_DEPTH; i++) {
+    *p++ = ',';
+    p = FormatInt(p, shot.bid_sizes[i]);
+  }
+  for (int i = 0; i < MARKET_DATA_DEPTH; i++) {
+    *p++ = ',';
+    p = FormatInt(p, shot.ask_sizes[i]);
+  }
+  *p++ = ',';
+  p = FormatFixed(p, shot.last_trade);
+  *p++ = ',';
+  p = FormatInt(p, shot.last_trade_size);
+  *p++ = ',';
+  p = FormatInt(p, shot.volume);
+  *p++ = ',';
+  p = FormatFixed(p, shot.turnover);
+  *p++ = ',';
+  p = FormatFixed(p, shot.open_interest);
+  *p++ = ',';
+  p = FormatInt(p, shot.is_trade_update);
+  *p++ = ',';
+  // ToCsv prints "%ld.%ld" through atof, so usec digits are left aligned, keep that
+  p = FormatInt(p, shot.time.tv_sec);
+  *p++ = '.';
+  char usec[8];
+  char* usec_end = FormatInt(usec, shot.time.tv_usec);
+  int len = static_cast<int>(usec_end - usec);
+  for (int i = 0; i < 6; i++) {
+    *p++ = i < len ? usec[i] : '0';
+  }
+  *p++ = ',';
+  p = FormatInt(p, shot.is_initialized);
+  if (with_ln) {
+    *p++ = '\n';
+  }
+  return p;
+}
+
+#endif  // SHOT_CSV_HPP_
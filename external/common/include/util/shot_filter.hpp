@@ -0,0 +1,156 @@
+#ifndef SHOT_FILTER_HPP_
+#define SHOT_FILTER_HPP_
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+
+#include "define.h"
+
+// decode-time predicate for recorded data, T needs char ticker[] and timeval time
+// empty filter lets everything pass, so it costs nothing when unused
+template <typename T>
+class ShotFilter {
+ public:
+  ShotFilter()
+    : gmt_offset(0) {
+    memset(first_byte, 0, sizeof(first_byte));
+    time_t now = time(NULL);
+    struct tm local_tm;
+    localtime_r(&now, &local_tm);
+    gmt_offset = local_tm.tm_gmtoff;
+  }
+
+  void AddTicker(const std::string & ticker) {
+    if (ticker.empty() || std::find(tickers.begin(), tickers.end(), ticker) != tickers.end()) {
+      return;
+    }
+    tickers.push_back(ticker);
+    first_byte[static_cast<unsigned char>(ticker[0])] = true;
+  }
+
+  // keys of the ticker->strategy map are exactly the tickers anyone listens to
+  template <typename V>
+  void AddTickers(const std::unordered_map<std::string, V> & m) {
+    for (auto & i : m) {
+      AddTicker(i.first);
+    }
+  }
+
+  // seconds of local day, start > end means the window crosses midnight
+  void AddTimeWindow(int start_sec, int end_sec) {
+    windows.push_back(std::make_pair(start_sec, end_sec));
+  }
+
+  // same "HH:MM:SS-HH:MM:SS" format as time.config
+  bool AddTimeWindow(const std::string & window) {
+    int sh, sm, ss, eh, em, es;
+    if (sscanf(window.c_str(), "%d:%d:%d-%d:%d:%d", &sh, &sm, &ss, &eh, &em, &es) != 6) {
+      printf("illegal time window %s\n", window.c_str());
+      return false;
+    }
+    AddTimeWindow(sh*3600 + sm*60 + ss, eh*3600 + em*60 + es);
+    return true;
+  }
+
+  bool Empty() const {
+    return tickers.empty() && windows.empty();
+  }
+
+  bool HasTickers() const {
+    return !tickers.empty();
+  }
+
+  bool HasWindows() const {
+    return !windows.empty();
+  }
+
+  inline bool PassTicker(const char* ticker) const {
+    if (tickers.empty()) {
+      return true;
+    }
+    if (!first_byte[static_cast<unsigned char>(ticker[0])]) {
+      return false;
+    }
+    for (auto & t : tickers) {
+      if (strncmp(t.c_str(), ticker, MAX_TICKER_LENGTH) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  inline bool PassTime(const timeval & t) const {
+    if (windows.empty()) {
+      return true;
+    }
+    return PassSecond(DaySecond(t.tv_sec));
+  }
+
+  // whether any second of [first, last] may fall in a window, for skipping whole blocks
+  bool PassTimeRange(const timeval & first, const timeval & last) const {
+    if (windows.empty() || last.tv_sec - first.tv_sec >= 86400) {
+      return true;
+    }
+    int start = DaySecond(first.tv_sec);
+    int end = DaySecond(last.tv_sec);
+    if (start <= end) {
+      return Overlap(start, end);
+    }
+    return Overlap(start, 86399) || Overlap(0, end);
+  }
+
+  inline bool Pass(const T & shot) const {
+    return PassTicker(shot.ticker) && PassTime(shot.time);
+  }
+
+  const std::vector<std::string> & GetTickers() const {
+    return tickers;
+  }
+
+ private:
+  inline int DaySecond(long int sec) const {
+    long int s = (sec + gmt_offset) % 86400;
+    return static_cast<int>(s < 0 ? s + 86400 : s);
+  }
+
+  inline bool PassSecond(int sec) const {
+    for (auto & w : windows) {
+      if (w.first <= w.second) {
+        if (sec >= w.first && sec <= w.second) {
+          return true;
+        }
+      } else if (sec >= w.first || sec <= w.second) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool Overlap(int start, int end) const {
+    for (auto & w : windows) {
+      if (w.first <= w.second) {
+        if (start <= w.second && end >= w.first) {
+          return true;
+        }
+      } else if (end >= w.first || start <= w.second) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::vector<std::string> tickers;
+  bool first_byte[256];
+  std::vector<std::pair<int, int> > windows;
+  long int gmt_offset;
+};
+
+#endif  // SHOT_FILTER_HPP_
@@ -0,0 +1,214 @@
+#ifndef SHOT_PARSER_HPP_
+#define SHOT_PARSER_HPP_
+
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "struct/market_snapshot.h"
+#include "util/fast_number.hpp"
+
+// zero allocation text -> MarketSnapshot, the fields of a line are located 16 bytes
+// at a time with SSE2 and the numbers are parsed straight out of the line
+
+#define CSV_SHOT_FIELDS 29
+#define MAX_LOG_SHOT_FIELDS 64
+
+struct TextField {
+  const char* begin;
+  const char* end;
+};
+
+// first c in [b, e), e when there is none
+inline const char* FindByte(const char* b, const char* e, char c) {
+#ifdef __SSE2__
+  const __m128i needle = _mm_set1_epi8(c);
+  while (b + 16 <= e) {
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b)), needle));
+    if (mask != 0) {
+      return b + __builtin_ctz(mask);
+    }
+    b += 16;
+  }
+#endif
+  while (b < e && *b != c) {
+    b++;
+  }
+  return b;
+}
+
+// splits [b, e) at delim, runs of delim count as one when merge is set (space padded logs)
+// returns the number of fields, or -1 when there are more than max_fields
+inline int ScanFields(const char* b, const char* e, char delim, TextField* fields, int max_fields, bool merge = false) {
+  int n = 0;
+  const char* start = b;
+  const char* p = b;
+#ifdef __SSE2__
+  const __m128i needle = _mm_set1_epi8(delim);
+  while (p + 16 <= e) {
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), needle));
+    while (mask != 0) {
+      const char* hit = p + __builtin_ctz(mask);
+      mask &= mask - 1;
+      if (!merge || hit > start) {
+        if (n == max_fields) {
+          return -1;
+        }
+        fields[n].begin = start;
+        fields[n++].end = hit;
+      }
+      start = hit + 1;
+    }
+    p += 16;
+  }
+#endif
+  for (; p < e; p++) {
+    if (*p != delim) {
+      continue;
+    }
+    if (!merge || p > start) {
+      if (n == max_fields) {
+        return -1;
+      }
+      fields[n].begin = start;
+      fields[n++].end = p;
+    }
+    start = p + 1;
+  }
+  if (!merge || e > start) {
+    if (n == max_fields) {
+      return -1;
+    }
+    fields[n].begin = start;
+    fields[n++].end = e;
+  }
+  return n;
+}
+
+namespace shot_parser {
+
+inline bool Double(const TextField & f, double* v) {
+  return fast_number::ParseDouble(f.begin, f.end, v) == f.end;
+}
+
+inline bool Int(const TextField & f, int* v) {
+  return fast_number::ParseInt(f.begin, f.end, v) == f.end;
+}
+
+inline bool Ticker(const TextField & f, char* ticker) {
+  size_t len = f.end - f.begin;
+  if (len == 0 || len >= MAX_TICKER_LENGTH) {
+    return false;
+  }
+  memcpy(ticker, f.begin, len);
+  ticker[len] = 0;
+  return true;
+}
+
+// "sec.frac" of ToCsv, frac is read as a decimal fraction of a second
+inline bool Time(const TextField & f, timeval* t) {
+  long long sec;
+  const char* p = fast_number::ParseInt(f.begin, f.end, &sec);
+  if (!p) {
+    return false;
+  }
+  long int usec = 0;
+  if (p < f.end && *p == '.') {
+    p++;
+    int digits = 0;
+    for (; p < f.end && static_cast<unsigned>(*p - '0') < 10; p++, digits++) {
+      if (digits < 6) {
+        usec = usec * 10 + (*p - '0');
+      }
+    }
+    for (; digits < 6; digits++) {
+      usec *= 10;
+    }
+  }
+  t->tv_sec = sec;
+  t->tv_usec = usec;
+  return p == f.end;
+}
+
+}  // namespace shot_parser
+
+// one row of MarketSnapshot::ToCsv(), trailing \r or \n allowed
+inline bool ParseCsvShot(const char* b, const char* e, MarketSnapshot* shot) {
+  using namespace shot_parser;
+  while (e > b && (e[-1] == '\n' || e[-1] == '\r')) {
+    e--;
+  }
+  TextField f[CSV_SHOT_FIELDS];
+  if (ScanFields(b, e, ',', f, CSV_SHOT_FIELDS) != CSV_SHOT_FIELDS) {
+    return false;
+  }
+  bool ok = Ticker(f[0], shot->ticker);
+  for (int i = 0; i < MARKET_DATA_DEPTH; i++) {
+    ok &= Double(f[1 + i], &shot->bids[i]);
+    ok &= Double(f[6 + i], &shot->asks[i]);
+    ok &= Int(f[11 + i], &shot->bid_sizes[i]);
+    ok &= Int(f[16 + i], &shot->ask_sizes[i]);
+  }
+  int is_trade_update = 0;
+  int is_initialized = 0;
+  ok &= Double(f[21], &shot->last_trade);
+  ok &= Int(f[22], &shot->last_trade_size);
+  ok &= Int(f[23], &shot->volume);
+  ok &= Double(f[24], &shot->turnover);
+  ok &= Double(f[25], &shot->open_interest);
+  ok &= Int(f[26], &is_trade_update);
+  ok &= Time(f[27], &shot->time);
+  ok &= Int(f[28], &is_initialized);
+  shot->is_trade_update = is_trade_update != 0;
+  shot->is_initialized = is_initialized != 0;
+  return ok;
+}
+
+// one line of MarketSnapshot::Show(), the text HandleSnapshot() takes
+// sec usec SNAPSHOT ticker | bid ask | bsize x asize | ... last size volume T
+// sec usec SNAPSHOT ticker | bid ask | bsize x asize | ... last size volume M turnover oi
+inline bool ParseLogShot(const char* b, const char* e, MarketSnapshot* shot) {
+  using namespace shot_parser;
+  while (e > b && (e[-1] == '\n' || e[-1] == '\r')) {
+    e--;
+  }
+  TextField f[MAX_LOG_SHOT_FIELDS];
+  int n = ScanFields(b, e, ' ', f, MAX_LOG_SHOT_FIELDS, true);
+  const int head = 5;
+  if (n < head + 4 || f[2].end - f[2].begin != 8 || memcmp(f[2].begin, "SNAPSHOT", 8) != 0) {
+    return false;
+  }
+  int depth = (n - head - 4) / 7;
+  if (depth > MARKET_DATA_DEPTH) {
+    depth = MARKET_DATA_DEPTH;
+  }
+  long long sec = 0;
+  int usec = 0;
+  bool ok = fast_number::ParseInt(f[0].begin, f[0].end, &sec) == f[0].end;
+  ok &= Int(f[1], &usec);
+  ok &= Ticker(f[3], shot->ticker);
+  shot->time.tv_sec = sec;
+  shot->time.tv_usec = usec;
+  for (int i = 0; i < depth; i++) {
+    const TextField* level = f + head + 7 * i;
+    ok &= Double(level[0], &shot->bids[i]);
+    ok &= Double(level[1], &shot->asks[i]);
+    ok &= Int(level[3], &shot->bid_sizes[i]);
+    ok &= Int(level[5], &shot->ask_sizes[i]);
+  }
+  const TextField* tail = f + head + 7 * depth;
+  int left = n - head - 7 * depth;
+  ok &= Double(tail[0], &shot->last_trade);
+  ok &= Int(tail[1], &shot->last_trade_size);
+  ok &= Int(tail[2], &shot->volume);
+  shot->is_trade_update = (tail[3].end - tail[3].begin == 1 && *tail[3].begin == 'T');
+  if (!shot->is_trade_update && left >= 6) {
+    ok &= Double(tail[4], &shot->turnover);
+    ok &= Double(tail[5], &shot->open_interest);
+  }
+  shot->is_initialized = true;
+  return ok;
+}
+
+#endif  // SHOT_PARSER_HPP_
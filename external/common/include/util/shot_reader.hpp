@@ -0,0 +1,112 @@
+#ifndef SHOT_READER_HPP_
+#define SHOT_READER_HPP_
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <string>
+
+#include "util/common_tools.h"
+
+// block reader over a .dat or .dat.gz file of fixed size records
+// a .dat file is mapped read only, so processes replaying the same day read the same
+// page cache pages instead of each copying the file through its own stdio buffer
+template <typename T>
+class ShotReader {
+ public:
+  explicit ShotReader(const std::string & file_path)
+    : path(file_path),
+      gzfp(nullptr),
+      fp(nullptr),
+      map(nullptr),
+      map_size(0),
+      map_pos(0),
+      is_gz(Split(file_path, ".").back() == "gz") {
+    if (is_gz) {
+      gzfp = gzopen(file_path.c_str(), "rb");
+      if (gzfp) {
+        gzbuffer(gzfp, 1 << 20);
+      }
+    } else if (!Map(file_path)) {
+      fp = fopen(file_path.c_str(), "rb");
+    }
+  }
+
+  ~ShotReader() {
+    if (gzfp) {
+      gzclose(gzfp);
+    }
+    if (fp) {
+      fclose(fp);
+    }
+    if (map) {
+      munmap(map, map_size);
+    }
+  }
+
+  bool Good() const {
+    return gzfp != nullptr || fp != nullptr || map != nullptr;
+  }
+
+  bool IsGz() const {
+    return is_gz;
+  }
+
+  // complete records only, a half written tail record is dropped
+  size_t Read(T* buf, size_t n) {
+    if (gzfp) {
+      int bytes = gzread(gzfp, buf, static_cast<unsigned>(n * sizeof(T)));
+      return bytes > 0 ? static_cast<size_t>(bytes) / sizeof(T) : 0;
+    }
+    if (fp) {
+      return fread(buf, sizeof(T), n, fp);
+    }
+    if (map) {
+      n = std::min(n, (map_size - map_pos) / sizeof(T));
+      memcpy(buf, map + map_pos, n * sizeof(T));
+      map_pos += n * sizeof(T);
+      return n;
+    }
+    return 0;
+  }
+
+  const std::string & Path() const {
+    return path;
+  }
+
+ private:
+  // false for empty or unmappable files, they go through fopen
+  bool Map(const std::string & file_path) {
+    int fd = open(file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (p != MAP_FAILED) {
+        madvise(p, st.st_size, MADV_SEQUENTIAL);
+        map = static_cast<char*>(p);
+        map_size = st.st_size;
+      }
+    }
+    close(fd);
+    return map != nullptr;
+  }
+
+  std::string path;
+  gzFile gzfp;
+  FILE* fp;
+  char* map;
+  size_t map_size;
+  size_t map_pos;
+  bool is_gz;
+};
+
+#endif  // SHOT_READER_HPP_
@@ -0,0 +1,362 @@
+#ifndef SIM_EXCHANGE_HPP_
+#define SIM_EXCHANGE_HPP_
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "define.h"
+#include "struct/exchange_info.h"
+#include "struct/market_snapshot.h"
+#include "struct/order.h"
+#include "util/base_sender.hpp"
+#include "util/latency_model.hpp"
+
+#define SIM_PRICE_EPS 1e-8
+
+// one of our orders resting in the simulated book
+struct SimOrder {
+  char order_ref[MAX_ORDERREF_SIZE];
+  OrderSide::Enum side;
+  double price;
+  int left;
+  int queue_ahead;  // estimated lots in front of us at our price
+};
+
+// recorded L5 book of a ticker plus our resting orders on it
+struct SimBook {
+  MarketSnapshot shot;
+  bool has_shot;
+  // lots our aggressive orders already took from the current shot
+  int bid_taken[MARKET_DATA_DEPTH];
+  int ask_taken[MARKET_DATA_DEPTH];
+  std::vector<SimOrder> orders;  // arrival order
+
+  SimBook()
+    : has_shot(false) {
+    ResetTaken();
+  }
+
+  void ResetTaken() {
+    for (int i = 0; i < MARKET_DATA_DEPTH; i++) {
+      bid_taken[i] = 0;
+      ask_taken[i] = 0;
+    }
+  }
+};
+
+// price-time matching of our orders against the recorded book, for backtests
+// plugs in as the order sender of a strategy; the exchange infos it creates are queued
+// and handed out by Deliver(), never from inside Send, so a strategy is not re-entered
+// while it is still placing an order
+// it runs on an event clock driven by the recorded shot times: the strategy sees a shot
+// market_data later, an order reaches the book submit after that, an info reaches the
+// strategy ack after it happened; both directions keep their message order like a socket
+//   marketable orders take the visible levels at their prices, the rest rests at its
+//   limit behind the lots shown at that price when it arrived; trade volume at our price
+//   eats that queue first, a shrinking level caps it (cancels), a trade or an opposite
+//   quote through our price fills us completely at our price
+//   ModOrder is a cancel, like on the ctp side, the strategy sends the new order itself
+class SimExchange : public BaseSender<Order> {
+ public:
+  // every accepted message is also passed to tap, to keep the order_<date> record
+  explicit SimExchange(BaseSender<Order>* tap = nullptr, const SimLatency & latency = SimLatency())
+    : tap(tap),
+      latency(latency),
+      now_us(0),
+      view_us(0),
+      last_arrival(0),
+      last_visible(0),
+      order_count(0),
+      fill_count(0),
+      cancel_count(0),
+      reject_count(0),
+      last_book(nullptr) {
+    last_ticker[0] = 0;
+  }
+
+  ~SimExchange() {
+  }
+
+  void Send(const Order & o) override {
+    if (tap) {
+      tap->Send(o);
+    }
+    last_arrival = std::max(view_us + latency.submit.Sample(), last_arrival);
+    arrivals.push_back(Arrival{last_arrival, o});
+  }
+
+  // a new recorded shot: orders that got to the exchange before it are handled on the
+  // old book, then the book moves and our resting orders on it may fill
+  void OnShot(const MarketSnapshot & shot) {
+    long long t = TimevalUs(shot.time);
+    Advance(t);
+    now_us = std::max(now_us, t);
+    view_us = std::max(view_us, now_us + latency.market_data.Sample());
+    SimBook & book = *Book(shot.ticker);
+    int traded = book.has_shot ? std::max(0, shot.volume - book.shot.volume) : 0;
+    book.shot = shot;
+    book.has_shot = true;
+    book.ResetTaken();
+    if (book.orders.empty()) {
+      return;
+    }
+    for (auto & o : book.orders) {
+      Match(shot, traded, &o);
+    }
+    book.orders.erase(std::remove_if(book.orders.begin(), book.orders.end(), [](const SimOrder & o) {
+      return o.left <= 0;
+    }), book.orders.end());
+  }
+
+  // hands f the infos that reached the strategy by the time it sees the last shot
+  template <typename F>
+  size_t Deliver(F f) {
+    size_t n = 0;
+    while (!infos.empty() && infos.front().visible <= view_us) {
+      ExchangeInfo info = infos.front().info;
+      infos.pop_front();
+      f(info);
+      n++;
+    }
+    return n;
+  }
+
+  // infos still on their way back
+  size_t Pending() const {
+    return infos.size();
+  }
+
+  // orders still on their way out
+  size_t InFlight() const {
+    return arrivals.size();
+  }
+
+  // resting orders of a ticker, nullptr before the ticker was seen
+  const std::vector<SimOrder>* Resting(const std::string & ticker) const {
+    auto it = books.find(ticker);
+    return it == books.end() ? nullptr : &it->second.orders;
+  }
+
+  long long Orders() const {
+    return order_count;
+  }
+
+  long long Fills() const {
+    return fill_count;
+  }
+
+  long long Cancels() const {
+    return cancel_count;
+  }
+
+  long long Rejects() const {
+    return reject_count;
+  }
+
+ private:
+  struct Arrival {
+    long long time;
+    Order order;
+  };
+
+  struct PendingInfo {
+    long long visible;
+    ExchangeInfo info;
+  };
+
+  // handles the orders that reached the exchange by t, each at its own arrival time
+  void Advance(long long t) {
+    while (!arrivals.empty() && arrivals.front().time <= t) {
+      now_us = std::max(now_us, arrivals.front().time);
+      const Order & o = arrivals.front().order;
+      switch (o.action) {
+       case OrderAction::NewOrder:
+        New(o);
+        break;
+       case OrderAction::ModOrder:
+       case OrderAction::CancelOrder:
+        Cancel(o);
+        break;
+       default:
+        break;
+      }
+      arrivals.pop_front();
+    }
+  }
+
+  // one strategy mostly talks about one or two tickers in a row, skip the hashing then
+  SimBook* Book(const char* ticker) {
+    if (last_book && strcmp(last_ticker, ticker) == 0) {
+      return last_book;
+    }
+    last_book = &books[ticker];  // nodes of an unordered_map never move
+    snprintf(last_ticker, sizeof(last_ticker), "%s", ticker);
+    return last_book;
+  }
+
+  static bool Same(double a, double b) {
+    return fabs(a - b) < SIM_PRICE_EPS;
+  }
+
+  // lots shown at price on one side of the recorded book, 0 when it is not a visible level
+  static int VisibleSize(const MarketSnapshot & shot, OrderSide::Enum side, double price) {
+    const double* prices = side == OrderSide::Buy ? shot.bids : shot.asks;
+    const int* sizes = side == OrderSide::Buy ? shot.bid_sizes : shot.ask_sizes;
+    for (int i = 0; i < MARKET_DATA_DEPTH; i++) {
+      if (Same(prices[i], price)) {
+        return sizes[i];
+      }
+    }
+    return 0;
+  }
+
+  void New(const Order & o) {
+    order_count++;
+    SimBook & book = *Book(o.ticker);
+    if (o.size <= 0 || o.price <= 0.0) {
+      Info(o.ticker, o.order_ref, o.side, InfoType::Rej, 0, 0.0, "bad order");
+      return;
+    }
+    if (!book.has_shot) {
+      Info(o.ticker, o.order_ref, o.side, InfoType::Rej, 0, 0.0, "no quote");
+      return;
+    }
+    Info(o.ticker, o.order_ref, o.side, InfoType::Acc, 0, 0.0, "sim");
+    int left = Take(o, &book);
+    if (left <= 0) {
+      return;
+    }
+    SimOrder r;
+    snprintf(r.order_ref, sizeof(r.order_ref), "%s", o.order_ref);
+    r.side = o.side;
+    r.price = o.price;
+    r.left = left;
+    r.queue_ahead = VisibleSize(book.shot, o.side, o.price);
+    // our own earlier orders at the same price are in front as well
+    for (auto & other : book.orders) {
+      if (other.side == o.side && Same(other.price, o.price)) {
+        r.queue_ahead += other.left;
+      }
+    }
+    book.orders.push_back(r);
+  }
+
+  // takes the opposite levels up to the limit price, returns the lots left
+  int Take(const Order & o, SimBook* book) {
+    bool buy = o.side == OrderSide::Buy;
+    const double* prices = buy ? book->shot.asks : book->shot.bids;
+    const int* sizes = buy ? book->shot.ask_sizes : book->shot.bid_sizes;
+    int* taken = buy ? book->ask_taken : book->bid_taken;
+    int left = o.size;
+    for (int i = 0; i < MARKET_DATA_DEPTH && left > 0; i++) {
+      if (prices[i] <= 0.0 || (buy ? prices[i] > o.price + SIM_PRICE_EPS : prices[i] < o.price - SIM_PRICE_EPS)) {
+        break;
+      }
+      int n = std::min(left, sizes[i] - taken[i]);
+      if (n <= 0) {
+        continue;
+      }
+      taken[i] += n;
+      left -= n;
+      Fill(o.ticker, o.order_ref, o.side, n, prices[i]);
+    }
+    return left;
+  }
+
+  void Match(const MarketSnapshot & shot, int traded, SimOrder* o) {
+    bool buy = o->side == OrderSide::Buy;
+    double opposite = buy ? shot.asks[0] : shot.bids[0];
+    bool crossed = opposite > 0.0 && (buy ? opposite <= o->price + SIM_PRICE_EPS : opposite >= o->price - SIM_PRICE_EPS);
+    bool traded_through = traded > 0 && shot.last_trade > 0.0 && (buy ? shot.last_trade < o->price - SIM_PRICE_EPS : shot.last_trade > o->price + SIM_PRICE_EPS);
+    if (crossed || traded_through) {
+      Fill(shot.ticker, o->order_ref, o->side, o->left, o->price);
+      o->left = 0;
+      return;
+    }
+    if (traded > 0 && Same(shot.last_trade, o->price)) {
+      o->queue_ahead -= traded;
+      if (o->queue_ahead < 0) {
+        int n = std::min(o->left, -o->queue_ahead);
+        Fill(shot.ticker, o->order_ref, o->side, n, o->price);
+        o->left -= n;
+        o->queue_ahead = 0;
+      }
+    }
+    // lots that left the level without trading were cancelled, assume ahead of us
+    double best = buy ? shot.bids[0] : shot.asks[0];
+    if (best <= 0.0 || (buy ? o->price > best + SIM_PRICE_EPS : o->price < best - SIM_PRICE_EPS)) {
+      o->queue_ahead = 0;
+    } else {
+      int level = VisibleSize(shot, o->side, o->price);
+      const double* prices = buy ? shot.bids : shot.asks;
+      double deepest = prices[MARKET_DATA_DEPTH - 1];
+      bool visible = deepest <= 0.0 || (buy ? o->price >= deepest - SIM_PRICE_EPS : o->price <= deepest + SIM_PRICE_EPS);
+      if (visible) {
+        o->queue_ahead = std::min(o->queue_ahead, level);
+      }
+    }
+  }
+
+  void Cancel(const Order & o) {
+    std::vector<SimOrder> & orders = Book(o.ticker)->orders;
+    for (size_t i = 0; i < orders.size(); i++) {
+      if (strcmp(orders[i].order_ref, o.order_ref) == 0) {
+        cancel_count++;
+        Info(o.ticker, o.order_ref, o.side, InfoType::Cancelled, orders[i].left, orders[i].price, "sim");
+        orders.erase(orders.begin() + i);
+        return;
+      }
+    }
+    Info(o.ticker, o.order_ref, o.side, InfoType::CancelRej, 0, 0.0, "not resting");
+  }
+
+  void Fill(const char* ticker, const char* order_ref, OrderSide::Enum side, int size, double price) {
+    fill_count++;
+    Info(ticker, order_ref, side, InfoType::Filled, size, price, "sim");
+  }
+
+  void Info(const char* ticker, const char* order_ref, OrderSide::Enum side, InfoType::Enum type, int size, double price, const char* reason) {
+    if (type == InfoType::Rej) {
+      reject_count++;
+    }
+    last_visible = std::max(now_us + latency.ack.Sample(), last_visible);
+    infos.emplace_back();
+    infos.back().visible = last_visible;
+    ExchangeInfo & info = infos.back().info;
+    info.show_time = UsTimeval(last_visible);
+    info.shot_time = UsTimeval(now_us);
+    info.type = type;
+    info.side = side;
+    info.trade_size = size;
+    info.trade_price = price;
+    snprintf(info.ticker, sizeof(info.ticker), "%s", ticker);
+    snprintf(info.order_ref, sizeof(info.order_ref), "%s", order_ref);
+    snprintf(info.reason, sizeof(info.reason), "%s", reason);
+  }
+
+  BaseSender<Order>* tap;
+  SimLatency latency;
+  std::unordered_map<std::string, SimBook> books;
+  std::deque<Arrival> arrivals;
+  std::deque<PendingInfo> infos;
+  long long now_us;  // exchange clock
+  long long view_us;  // strategy clock, the last shot as the strategy sees it
+  long long last_arrival;
+  long long last_visible;
+  long long order_count;
+  long long fill_count;
+  long long cancel_count;
+  long long reject_count;
+  char last_ticker[MAX_TICKER_LENGTH];
+  SimBook* last_book;
+};
+
+#endif  // SIM_EXCHANGE_HPP_
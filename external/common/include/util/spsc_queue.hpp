@@ -0,0 +1,111 @@
+#ifndef SPSC_QUEUE_HPP_
+#define SPSC_QUEUE_HPP_
+
+#include <stddef.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#define SPSC_CACHE_LINE 64
+// full pushes spin this many times before they start yielding
+#define SPSC_SPIN 1024
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#else
+  std::this_thread::yield();
+#endif
+}
+
+// bounded lock free queue for exactly one producer and one consumer thread
+// head and tail never share a cache line, each side keeps a copy of the other
+// side's index and only reloads it when the copy says full or empty
+template <typename T>
+class SpscQueue {
+ public:
+  // capacity is rounded up to a power of two
+  explicit SpscQueue(size_t capacity)
+    : head(0),
+      tail_cache(0),
+      tail(0),
+      head_cache(0) {
+    size_t n = 2;
+    while (n < capacity) {
+      n <<= 1;
+    }
+    mask = n - 1;
+    data.resize(n);
+  }
+
+  ~SpscQueue() {
+  }
+
+  // producer side, false when full
+  bool TryPush(const T & v) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head_cache > mask) {
+      head_cache = head.load(std::memory_order_acquire);
+      if (t - head_cache > mask) {
+        return false;
+      }
+    }
+    data[t & mask] = v;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // producer side, waits for room: a slow consumer holds the producer back rather
+  // than losing data
+  void Push(const T & v) {
+    int spins = 0;
+    while (!TryPush(v)) {
+      if (++spins < SPSC_SPIN) {
+        CpuRelax();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  // consumer side, false when empty
+  bool TryPop(T* v) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail_cache) {
+      tail_cache = tail.load(std::memory_order_acquire);
+      if (h == tail_cache) {
+        return false;
+      }
+    }
+    *v = data[h & mask];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // approximate from any thread
+  size_t Size() const {
+    return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_relaxed);
+  }
+
+  size_t Capacity() const {
+    return mask + 1;
+  }
+
+ private:
+  // padded rather than alignas, so the queue can live in plain new'd memory in c++11
+  std::vector<T> data;
+  size_t mask;
+  char pad0[SPSC_CACHE_LINE];
+  std::atomic<size_t> head;  // consumer
+  size_t tail_cache;
+  char pad1[SPSC_CACHE_LINE - sizeof(size_t) * 2];
+  std::atomic<size_t> tail;  // producer
+  size_t head_cache;
+  char pad2[SPSC_CACHE_LINE - sizeof(size_t) * 2];
+};
+
+#endif  // SPSC_QUEUE_HPP_
@@ -0,0 +1,255 @@
+#ifndef STREAM_TRANSFORMER_HPP_
+#define STREAM_TRANSFORMER_HPP_
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "struct/market_snapshot.h"
+#include "util/work_stealing_pool.hpp"
+#include "util/shot_csv.hpp"
+#include "util/shot_parser.hpp"
+#include "util/shot_reader.hpp"
+#include "util/time_controller.h"
+
+// parallel replacement for the DataTransformer converters:
+// every file is read in fixed size chunks, chunks are formatted on the pool and
+// written back in order, at most max_inflight chunks per file live in memory
+class StreamTransformer {
+ public:
+  explicit StreamTransformer(int thread_num = 0, size_t chunk_records = 8192)
+    : cpu_count(thread_num > 0 ? thread_num : std::max(1u, std::thread::hardware_concurrency())),
+      chunk_size(chunk_records),
+      text_chunk_size(chunk_records * 256),
+      max_inflight(2 * cpu_count),
+      pool(new WorkStealingPool(cpu_count)) {
+  }
+
+  ~StreamTransformer() {
+  }
+
+  // .dat or .dat.gz -> .csv, dest_dir defaults to the source dir
+  bool BinToCsv(const std::string & source_path, const std::string & dest_dir = "", const std::string & file_name = "") {
+    ShotReader<MarketSnapshot> reader(source_path);
+    if (!reader.Good()) {
+      printf("open %s failed!\n", source_path.c_str());
+      return false;
+    }
+    std::string dest_path = GenFileName(source_path, dest_dir, file_name, ".csv");
+    FILE* out = fopen(dest_path.c_str(), "w");
+    if (!out) {
+      printf("open %s failed!\n", dest_path.c_str());
+      return false;
+    }
+    std::deque<std::future<std::string> > inflight;
+    bool ok = true;
+    while (true) {
+      std::shared_ptr<std::vector<MarketSnapshot> > chunk(new std::vector<MarketSnapshot>(chunk_size));
+      size_t n = reader.Read(chunk->data(), chunk_size);
+      if (n == 0) {
+        break;
+      }
+      chunk->resize(n);
+      inflight.emplace_back(pool->enqueue([chunk]() {
+        std::string s(chunk->size() * 256, '\0');
+        char* begin = &s[0];
+        char* p = begin;
+        for (auto & shot : *chunk) {
+          if (static_cast<size_t>(p - begin) + MAX_CSV_ROW_LENGTH > s.size()) {
+            size_t used = p - begin;
+            s.resize(s.size() * 2);
+            begin = &s[0];
+            p = begin + used;
+          }
+          p = ShotToCsv(shot, p);
+        }
+        s.resize(p - begin);
+        return s;
+      }));
+      if (inflight.size() >= max_inflight) {
+        ok &= Flush(&inflight, out, 1);
+      }
+    }
+    ok &= Flush(&inflight, out, inflight.size());
+    fclose(out);
+    return ok;
+  }
+
+  // .csv written by ToCsv (or .csv.gz) -> .dat
+  bool CsvToBin(const std::string & source_path, const std::string & dest_dir = "", const std::string & file_name = "") {
+    return TextToBin(source_path, GenFileName(source_path, dest_dir, file_name, ".dat"), &ParseCsvShot);
+  }
+
+  // .log written by Show (or .log.gz) -> .dat
+  bool LogToBin(const std::string & source_path, const std::string & dest_dir = "", const std::string & file_name = "") {
+    return TextToBin(source_path, GenFileName(source_path, dest_dir, file_name, ".dat"), &ParseLogShot);
+  }
+
+  // picks the converter by suffix: csv and log go to binary, binary goes to csv
+  bool Convert(const std::string & source_path, const std::string & dest_dir = "") {
+    std::string base = source_path;
+    if (HasSuffix(base, ".gz")) {
+      base = base.substr(0, base.size() - 3);
+    }
+    if (HasSuffix(base, ".csv")) {
+      return CsvToBin(source_path, dest_dir);
+    }
+    if (HasSuffix(base, ".log")) {
+      return LogToBin(source_path, dest_dir);
+    }
+    return BinToCsv(source_path, dest_dir);
+  }
+
+  // each file gets its own reader thread, formatting of all of them shares the pool
+  int BatchRun(const std::vector<std::string> & files, const std::string & dest_dir = "", int file_parallel = 0) {
+    TimeController tc;
+    tc.StartTimer();
+    int reader_num = file_parallel > 0 ? file_parallel : std::max(1, cpu_count / 4);
+    std::atomic<size_t> next(0);
+    std::atomic<int> failed(0);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < reader_num; i++) {
+      readers.emplace_back([&]() {
+        for (size_t j = next++; j < files.size(); j = next++) {
+          if (!Convert(files[j], dest_dir)) {
+            failed++;
+          }
+        }
+      });
+    }
+    for (auto & t : readers) {
+      t.join();
+    }
+    tc.EndTimer("BatchRun " + std::to_string(files.size()) + " files");
+    return failed.load();
+  }
+
+  static std::string GenFileName(const std::string & source_path, const std::string & dest_dir, const std::string & file_name, const std::string & suffix) {
+    if (!file_name.empty()) {
+      return dest_dir.empty() ? file_name : dest_dir + "/" + file_name;
+    }
+    size_t slash = source_path.rfind('/');
+    std::string base = slash == std::string::npos ? source_path : source_path.substr(slash + 1);
+    for (auto ext : {".gz", ".dat", ".csv", ".log"}) {
+      size_t pos = base.rfind(ext);
+      if (pos != std::string::npos && pos + strlen(ext) == base.size()) {
+        base = base.substr(0, pos);
+      }
+    }
+    std::string dir = dest_dir.empty() ? (slash == std::string::npos ? "" : source_path.substr(0, slash)) : dest_dir;
+    return dir.empty() ? base + suffix : dir + "/" + base + suffix;
+  }
+
+ private:
+  typedef bool (*LineParser)(const char*, const char*, MarketSnapshot*);
+
+  static bool HasSuffix(const std::string & s, const std::string & suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+  }
+
+  // text is cut into blocks at line ends, blocks are parsed on the pool into raw records
+  bool TextToBin(const std::string & source_path, const std::string & dest_path, LineParser parser) {
+    // gzread passes plain files through, so one reader covers .csv and .csv.gz
+    gzFile in = gzopen(source_path.c_str(), "rb");
+    if (!in) {
+      printf("open %s failed!\n", source_path.c_str());
+      return false;
+    }
+    gzbuffer(in, 1 << 20);
+    FILE* out = fopen(dest_path.c_str(), "wb");
+    if (!out) {
+      printf("open %s failed!\n", dest_path.c_str());
+      gzclose(in);
+      return false;
+    }
+    std::shared_ptr<std::atomic<size_t> > bad(new std::atomic<size_t>(0));
+    std::deque<std::future<std::string> > inflight;
+    std::string rest;
+    bool ok = true;
+    bool eof = false;
+    while (!eof) {
+      std::shared_ptr<std::string> block(new std::string(rest));
+      size_t used = block->size();
+      block->resize(used + text_chunk_size);
+      int n = gzread(in, &(*block)[used], static_cast<unsigned>(text_chunk_size));
+      if (n <= 0) {
+        eof = true;
+        n = 0;
+      }
+      block->resize(used + n);
+      size_t cut = block->rfind('\n');
+      if (eof || cut == std::string::npos) {
+        rest.clear();
+        if (!eof) {
+          // no line end in a whole block, keep reading
+          rest.swap(*block);
+          continue;
+        }
+      } else {
+        rest.assign(*block, cut + 1, std::string::npos);
+        block->resize(cut + 1);
+      }
+      if (block->empty()) {
+        continue;
+      }
+      inflight.emplace_back(pool->enqueue([block, parser, bad]() {
+        std::string s;
+        s.reserve(block->size() / 64 * sizeof(MarketSnapshot));
+        const char* p = block->data();
+        const char* end = p + block->size();
+        MarketSnapshot shot;
+        while (p < end) {
+          const char* ln = FindByte(p, end, '\n');
+          if (ln > p) {
+            shot = MarketSnapshot();
+            if (parser(p, ln, &shot)) {
+              s.append(reinterpret_cast<const char*>(&shot), sizeof(shot));
+            } else {
+              (*bad)++;
+            }
+          }
+          p = ln + 1;
+        }
+        return s;
+      }));
+      if (inflight.size() >= max_inflight) {
+        ok &= Flush(&inflight, out, 1);
+      }
+    }
+    ok &= Flush(&inflight, out, inflight.size());
+    fclose(out);
+    gzclose(in);
+    if (bad->load() > 0) {
+      printf("%s: %zu lines not parsed\n", source_path.c_str(), bad->load());
+    }
+    return ok;
+  }
+
+  bool Flush(std::deque<std::future<std::string> >* inflight, FILE* out, size_t n) {
+    bool ok = true;
+    for (size_t i = 0; i < n && !inflight->empty(); i++) {
+      std::string s = inflight->front().get();
+      inflight->pop_front();
+      ok &= (fwrite(s.data(), 1, s.size(), out) == s.size());
+    }
+    return ok;
+  }
+
+  int cpu_count;
+  size_t chunk_size;
+  size_t text_chunk_size;
+  size_t max_inflight;
+  std::unique_ptr<WorkStealingPool> pool;
+};
+
+#endif  // STREAM_TRANSFORMER_HPP_
@@ -0,0 +1,262 @@
+#ifndef THREAD_CONFIG_HPP_
+#define THREAD_CONFIG_HPP_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <libconfig.h++>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define THREAD_PAGE_SIZE 4096
+
+// cpu, scheduling class and stack pre-touch of the named hot threads, from the
+// threads group of a config:
+//   threads = {
+//     prefault_stack_kb = 256;  // default for every named thread
+//     md_listener = { cpus = [2]; policy = "fifo"; priority = 80; };
+//     shard0 = { cpus = [4]; stack_kb = 1024; };
+//   };
+// policy is other (default), batch, idle, fifo or rr, fifo and rr need a priority
+// and CAP_SYS_NICE; a thread calls Apply with its name when it starts, names missing
+// from the config only get named and reported
+struct ThreadSetting {
+  std::vector<int> cpus;
+  int policy;
+  int priority;
+  int stack_kb;
+
+  ThreadSetting()
+    : policy(SCHED_OTHER),
+      priority(0),
+      stack_kb(0) {
+  }
+};
+
+class ThreadConfig {
+ public:
+  static ThreadConfig & Instance() {
+    static ThreadConfig c;
+    return c;
+  }
+
+  // call before the threads start, a file without a threads group is fine
+  bool Load(const std::string & path) {
+    libconfig::Config cfg;
+    try {
+      cfg.readFile(path.c_str());
+    } catch (const libconfig::FileIOException & e) {
+      printf("thread config: can't read %s, threads run unpinned\n", path.c_str());
+      return false;
+    } catch (const libconfig::ParseException & e) {
+      printf("thread config: %s:%d %s\n", e.getFile(), e.getLine(), e.getError());
+      return false;
+    }
+    if (cfg.exists("threads")) {
+      Load(cfg.lookup("threads"));
+    }
+    return true;
+  }
+
+  void Load(const libconfig::Setting & threads) {
+    int default_stack_kb = threads.exists("prefault_stack_kb") ? static_cast<int>(threads["prefault_stack_kb"]) : 0;
+    for (int i = 0; i < threads.getLength(); i++) {
+      const libconfig::Setting & t = threads[i];
+      if (!t.isGroup()) {
+        continue;
+      }
+      ThreadSetting s;
+      s.stack_kb = default_stack_kb;
+      if (t.exists("cpus")) {
+        const libconfig::Setting & cpus = t["cpus"];
+        for (int j = 0; j < cpus.getLength(); j++) {
+          s.cpus.push_back(cpus[j]);
+        }
+      }
+      if (t.exists("policy")) {
+        std::string policy = t["policy"].c_str();
+        s.policy = ParsePolicy(policy);
+        if (s.policy < 0) {
+          printf("thread config: unknown policy %s for %s\n", policy.c_str(), t.getName());
+          s.policy = SCHED_OTHER;
+        }
+      }
+      if (t.exists("priority")) {
+        s.priority = static_cast<int>(t["priority"]);
+      }
+      if (t.exists("stack_kb")) {
+        s.stack_kb = static_cast<int>(t["stack_kb"]);
+      }
+      settings[t.getName()] = s;
+    }
+  }
+
+  bool Has(const std::string & name) const {
+    return settings.find(name) != settings.end();
+  }
+
+  // names the calling thread and applies its setting, then reports what took effect
+  // cpu >= 0 pins there when the config has no cpus for the name
+  void Apply(const std::string & name, int cpu = -1) {
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+    ThreadSetting s;
+    auto it = settings.find(name);
+    if (it != settings.end()) {
+      s = it->second;
+    }
+    if (s.cpus.empty() && cpu >= 0) {
+      s.cpus.push_back(cpu);
+    }
+    if (!s.cpus.empty()) {
+      cpu_set_t mask;
+      CPU_ZERO(&mask);
+      for (auto c : s.cpus) {
+        CPU_SET(c, &mask);
+      }
+      int r = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+      if (r != 0) {
+        printf("thread %s: set affinity failed: %s\n", name.c_str(), strerror(r));
+      }
+    }
+    if (s.policy != SCHED_OTHER) {
+      sched_param param;
+      param.sched_priority = 0;
+      if (s.policy == SCHED_FIFO || s.policy == SCHED_RR) {
+        param.sched_priority = std::max(sched_get_priority_min(s.policy), std::min(s.priority, sched_get_priority_max(s.policy)));
+      }
+      int r = pthread_setschedparam(pthread_self(), s.policy, &param);
+      if (r != 0) {
+        printf("thread %s: set %s policy failed: %s\n", name.c_str(), PolicyName(s.policy), strerror(r));
+      }
+    }
+    if (s.stack_kb > 0) {
+      TouchStack(s.stack_kb);
+    }
+    Report(name);
+  }
+
+  // the effective settings of the calling thread, with a warning for every cpu
+  // it may run on that is not isolated from the kernel scheduler
+  void Report(const std::string & name) {
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    pthread_getaffinity_np(pthread_self(), sizeof(mask), &mask);
+    int policy = SCHED_OTHER;
+    sched_param param;
+    param.sched_priority = 0;
+    pthread_getschedparam(pthread_self(), &policy, &param);
+    std::vector<int> cpus;
+    for (int c = 0; c < CPU_SETSIZE; c++) {
+      if (CPU_ISSET(c, &mask)) {
+        cpus.push_back(c);
+      }
+    }
+    bool pinned = static_cast<long>(cpus.size()) < sysconf(_SC_NPROCESSORS_ONLN);
+    std::string not_isolated;
+    if (pinned) {
+      std::vector<int> isolated = Isolated();
+      for (auto c : cpus) {
+        if (std::find(isolated.begin(), isolated.end(), c) == isolated.end()) {
+          not_isolated += (not_isolated.empty() ? "" : ",") + std::to_string(c);
+        }
+      }
+    }
+    printf("thread %s tid %ld cpus %s policy %s priority %d%s%s\n", name.c_str(), syscall(SYS_gettid),
+           pinned ? CpuList(cpus).c_str() : "all", PolicyName(policy), param.sched_priority,
+           not_isolated.empty() ? "" : " not isolated: ", not_isolated.c_str());
+  }
+
+  // the cpus in isolcpus, from /sys/devices/system/cpu/isolated ("2-5,8")
+  static std::vector<int> Isolated() {
+    std::vector<int> cpus;
+    std::ifstream f("/sys/devices/system/cpu/isolated");
+    std::string line;
+    if (!f || !std::getline(f, line)) {
+      return cpus;
+    }
+    size_t pos = 0;
+    while (pos < line.size()) {
+      size_t end = line.find(',', pos);
+      if (end == std::string::npos) {
+        end = line.size();
+      }
+      std::string range = line.substr(pos, end - pos);
+      size_t dash = range.find('-');
+      if (!range.empty()) {
+        int first = atoi(range.c_str());
+        int last = dash == std::string::npos ? first : atoi(range.c_str() + dash + 1);
+        for (int c = first; c <= last; c++) {
+          cpus.push_back(c);
+        }
+      }
+      pos = end + 1;
+    }
+    return cpus;
+  }
+
+ private:
+  ThreadConfig() {
+  }
+
+  static int ParsePolicy(const std::string & policy) {
+    if (policy == "other") {
+      return SCHED_OTHER;
+    } else if (policy == "batch") {
+      return SCHED_BATCH;
+    } else if (policy == "idle") {
+      return SCHED_IDLE;
+    } else if (policy == "fifo") {
+      return SCHED_FIFO;
+    } else if (policy == "rr") {
+      return SCHED_RR;
+    }
+    return -1;
+  }
+
+  static const char* PolicyName(int policy) {
+    switch (policy) {
+     case SCHED_OTHER:
+      return "other";
+     case SCHED_BATCH:
+      return "batch";
+     case SCHED_IDLE:
+      return "idle";
+     case SCHED_FIFO:
+      return "fifo";
+     case SCHED_RR:
+      return "rr";
+     default:
+      return "unknown";
+    }
+  }
+
+  static std::string CpuList(const std::vector<int> & cpus) {
+    std::string s;
+    for (auto c : cpus) {
+      s += (s.empty() ? "" : ",") + std::to_string(c);
+    }
+    return s;
+  }
+
+  // faults the top kb of the stack in now, not on the first deep call on the hot path
+  static void __attribute__((noinline)) TouchStack(int kb) {
+    volatile char* p = static_cast<volatile char*>(alloca(kb * 1024));
+    for (int i = 0; i < kb * 1024; i += THREAD_PAGE_SIZE) {
+      p[i] = 0;
+    }
+  }
+
+  std::unordered_map<std::string, ThreadSetting> settings;
+};
+
+#endif  // THREAD_CONFIG_HPP_
@@ -0,0 +1,274 @@
+#ifndef WORK_STEALING_POOL_HPP_
+#define WORK_STEALING_POOL_HPP_
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// thread pool with one deque per worker: a worker pushes and pops its own tasks at
+// the back, idle workers steal from the front of the others, so one long task
+// no longer leaves the rest of the queue waiting behind it
+// enqueue is call compatible with ThreadPool, TaskGroup adds fork/join on top
+class WorkStealingPool {
+ public:
+  // threads = 0 takes the hardware core count, worker i is pinned to cpus[i % cpus.size()]
+  explicit WorkStealingPool(size_t threads = 0, const std::vector<int> & cpus = std::vector<int>())
+    : queues(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency())),
+      queued(0),
+      next_queue(0),
+      stop(false) {
+    for (size_t i = 0; i < queues.size(); i++) {
+      queues[i].reset(new WorkQueue);
+    }
+    for (size_t i = 0; i < queues.size(); i++) {
+      int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+      workers.emplace_back([this, i, cpu]() {
+        WorkerLoop(i, cpu);
+      });
+    }
+  }
+
+  // runs everything still queued, then joins
+  ~WorkStealingPool() {
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex);
+      stop = true;
+    }
+    sleep_cv.notify_all();
+    for (auto & w : workers) {
+      w.join();
+    }
+  }
+
+  template <class F, class... Args>
+  auto enqueue(F&& f, Args&&... args) -> std::future<typename std::result_of<F(Args...)>::type> {
+    typedef typename std::result_of<F(Args...)>::type return_type;
+    auto task = std::make_shared<std::packaged_task<return_type()> >(
+        std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+    std::future<return_type> res = task->get_future();
+    Submit([task]() {
+      (*task)();
+    });
+    return res;
+  }
+
+  // from a worker the task lands on its own deque (nested work stays local),
+  // from any other thread the deques are filled round robin; group tags the task for
+  // RunOne(group)
+  void Submit(std::function<void()> task, const void* group = nullptr) {
+    bool from_worker = (CurrentPool() == this);
+    if (stop && !from_worker) {
+      throw std::runtime_error("submit on stopped WorkStealingPool");
+    }
+    size_t i = from_worker ? CurrentWorker() : next_queue++ % queues.size();
+    {
+      std::lock_guard<std::mutex> lock(queues[i]->mtx);
+      queues[i]->tasks.push_back(Task{std::move(task), group});
+    }
+    queued++;
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex);
+    }
+    sleep_cv.notify_one();
+  }
+
+  // runs one pending task on the calling thread, false when there was none; with a
+  // group only a task submitted with that group
+  bool RunOne(const void* group = nullptr) {
+    std::function<void()> task;
+    size_t self = (CurrentPool() == this) ? CurrentWorker() : 0;
+    if (!Take(self, &task, group)) {
+      return false;
+    }
+    task();
+    return true;
+  }
+
+  size_t Size() const {
+    return queues.size();
+  }
+
+  // worker index of the calling thread, -1 outside this pool
+  int WorkerIndex() const {
+    return CurrentPool() == this ? static_cast<int>(CurrentWorker()) : -1;
+  }
+
+ private:
+  struct Task {
+    std::function<void()> fn;
+    const void* group;
+  };
+
+  struct WorkQueue {
+    std::mutex mtx;
+    std::deque<Task> tasks;
+  };
+
+  static const WorkStealingPool*& CurrentPool() {
+    static thread_local const WorkStealingPool* pool = nullptr;
+    return pool;
+  }
+
+  static size_t& CurrentWorker() {
+    static thread_local size_t index = 0;
+    return index;
+  }
+
+  // own deque from the back (hot in cache), then the others from the front; a group
+  // skips the tasks of other groups
+  bool Take(size_t self, std::function<void()>* task, const void* group = nullptr) {
+    if (queued.load() <= 0) {
+      return false;
+    }
+    {
+      WorkQueue & q = *queues[self];
+      std::lock_guard<std::mutex> lock(q.mtx);
+      for (size_t j = q.tasks.size(); j-- > 0;) {
+        if (!group || q.tasks[j].group == group) {
+          TakeAt(&q, j, task);
+          return true;
+        }
+      }
+    }
+    for (size_t k = 1; k < queues.size(); k++) {
+      WorkQueue & q = *queues[(self + k) % queues.size()];
+      std::lock_guard<std::mutex> lock(q.mtx);
+      for (size_t j = 0; j < q.tasks.size(); j++) {
+        if (!group || q.tasks[j].group == group) {
+          TakeAt(&q, j, task);
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // q.mtx held
+  void TakeAt(WorkQueue* q, size_t j, std::function<void()>* task) {
+    *task = std::move(q->tasks[j].fn);
+    q->tasks.erase(q->tasks.begin() + j);
+    queued--;
+  }
+
+  void WorkerLoop(size_t index, int cpu) {
+    CurrentPool() = this;
+    CurrentWorker() = index;
+    if (cpu >= 0) {
+      cpu_set_t mask;
+      CPU_ZERO(&mask);
+      CPU_SET(cpu, &mask);
+      if (pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) != 0) {
+        printf("pin worker %zu to cpu %d failed\n", index, cpu);
+      }
+    }
+    std::function<void()> task;
+    while (true) {
+      if (Take(index, &task)) {
+        task();
+        task = nullptr;
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(sleep_mutex);
+      if (stop && queued.load() <= 0) {
+        return;
+      }
+      sleep_cv.wait(lock, [this]() {
+        return stop || queued.load() > 0;
+      });
+    }
+  }
+
+  std::vector<std::unique_ptr<WorkQueue> > queues;
+  std::vector<std::thread> workers;
+  std::atomic<long> queued;  // may dip below 0 for a moment, a task is taken before its count lands
+  std::atomic<size_t> next_queue;
+  std::mutex sleep_mutex;
+  std::condition_variable sleep_cv;
+  std::atomic<bool> stop;
+};
+
+// fork/join over a pool: Run() forks, Wait() joins and helps with the group's own
+// pending tasks meanwhile, so waiting inside a pool task (a day waiting on its
+// variants) can't starve the pool, and never picks up unrelated work (another whole
+// day) that would nest under the wait; the first exception of the group is rethrown
+// by Wait()
+class TaskGroup {
+ public:
+  explicit TaskGroup(WorkStealingPool* pool)
+    : pool(pool),
+      pending(0) {
+  }
+
+  ~TaskGroup() {
+    Join();
+  }
+
+  void Run(std::function<void()> f) {
+    pending++;
+    pool->Submit([this, f]() {
+      try {
+        f();
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+      // under the lock, so Join can't return while this task still touches the group
+      std::lock_guard<std::mutex> lock(mtx);
+      if (--pending == 0) {
+        cv.notify_all();
+      }
+    }, this);
+  }
+
+  void Wait() {
+    Join();
+    std::exception_ptr e;
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      e = error;
+      error = nullptr;
+    }
+    if (e) {
+      std::rethrow_exception(e);
+    }
+  }
+
+ private:
+  void Join() {
+    while (pending.load() > 0) {
+      if (pool->RunOne(this)) {
+        continue;
+      }
+      // the rest is running elsewhere, nap until it ends or new work shows up
+      std::unique_lock<std::mutex> lock(mtx);
+      cv.wait_for(lock, std::chrono::milliseconds(1), [this]() {
+        return pending.load() == 0;
+      });
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+  }
+
+  WorkStealingPool* pool;
+  std::atomic<int> pending;
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::exception_ptr error;
+};
+
+#endif  // WORK_STEALING_POOL_HPP_
@@ -46,6 +46,10 @@ class ZmqRecver : public BaseRecver <T> {
     sock.get()->recv(&t, sizeof(T));
   }
 
+  inline bool TryRecv(T& t) override {
+    return sock.get()->recv(&t, sizeof(T), ZMQ_DONTWAIT) > 0;
+  }
+
  private:
   unique_ptr<zmq::context_t> con;
   unique_ptr<zmq::socket_t> sock;
@@ -56,6 +56,16 @@ class demostrat_class(BuildContext):
   cmd = "demostrat"
 class simdata_class(BuildContext):
   cmd = "simdata"
+class day_summary_class(BuildContext):
+  cmd = "day_summary"
+class transform_class(BuildContext):
+  cmd = "transform"
+class parse_bench_class(BuildContext):
+  cmd = "parse_bench"
+class day_index_class(BuildContext):
+  cmd = "day_index"
+class log_decoder_class(BuildContext):
+  cmd = "log_decoder"
 from lint import add_lint_ignore
 
 def build(bld):
@@ -106,6 +116,21 @@ def build(bld):
   if bld.cmd == "simdata":
     run_simdata(bld)
     return
+  if bld.cmd == "day_summary":
+    run_day_summary(bld)
+    return
+  if bld.cmd == "transform":
+    run_transform(bld)
+    return
+  if bld.cmd == "parse_bench":
+    run_parse_bench(bld)
+    return
+  if bld.cmd == "day_index":
+    run_day_index(bld)
+    return
+  if bld.cmd == "log_decoder":
+    run_log_decoder(bld)
+    return
   else:
     print "error! " + str(bld.cmd)
     return
@@ -256,7 +281,7 @@ def run_demostrat(bld):
     use = 'zmq nick pthread config++'
   )
 
-def run_demostrat(bld):
+def run_simdata(bld):
   bld.read_shlib('nick', paths=['external/common/lib'])
   bld.program(
     target = 'bin/simdata',
@@ -265,6 +290,45 @@ def run_demostrat(bld):
     use = 'zmq nick pthread config++ z'
   )
 
+def run_day_summary(bld):
+  bld.read_shlib('nick', paths=['external/common/lib'])
+  bld.program(
+    target = 'bin/day_summary',
+    source = ['src/day_summary/main.cpp'],
+    use = 'nick pthread config++ z'
+  )
+
+def run_transform(bld):
+  bld.read_shlib('nick', paths=['external/common/lib'])
+  bld.program(
+    target = 'bin/transform',
+    source = ['src/transform/main.cpp'],
+    use = 'nick pthread config++ z'
+  )
+
+def run_parse_bench(bld):
+  bld.read_shlib('nick', paths=['external/common/lib'])
+  bld.program(
+    target = 'bin/parse_bench',
+    source = ['src/parse_bench/main.cpp'],
+    use = 'nick pthread config++ z'
+  )
+
+def run_day_index(bld):
+  bld.read_shlib('nick', paths=['external/common/lib'])
+  bld.program(
+    target = 'bin/day_index',
+    source = ['src/day_index/main.cpp'],
+    use = 'nick pthread config++ z'
+  )
+
+def run_log_decoder(bld):
+  bld.program(
+    target = 'bin/log_decoder',
+    source = ['src/log_decoder/main.cpp'],
+    use = 'pthread config++'
+  )
+
 def run_all(bld):
   run_mid_data(bld)
   run_proxy(bld)
@@ -277,4 +341,10 @@ def run_all(bld):
   run_backtest(bld)
   run_order_matcher(bld)
   run_demostrat(bld)
+  run_simdata(bld)
   run_simplemaker(bld)
+  run_day_summary(bld)
+  run_transform(bld)
+  run_parse_bench(bld)
+  run_day_index(bld)
+  run_log_decoder(bld)
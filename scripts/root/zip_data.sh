@@ -3,6 +3,8 @@ export LD_LIBRARY_PATH=/usr/local/lib
 
 cd /today
 gzip data_binary.dat
+./bin/day_summary data_binary.dat.gz
+./bin/day_index data_binary.dat.gz
 
 cd /today/log
 
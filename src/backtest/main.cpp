@@ -1,48 +1,106 @@
 #include <libconfig.h++>
+#include <sys/stat.h>
 #include <unordered_map>
 #include <map>
 #include <utility>
 #include <string>
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <algorithm>
 
 #include "core/backtester.h"
-#include "util/ThreadPool.h"
+#include "core/sim_backtester.hpp"
+#include "util/work_stealing_pool.hpp"
+#include "util/process_pool.hpp"
+#include "util/profiler.hpp"
 #include "util/time_controller.h"
 #include "util/zmq_sender.hpp"
 #include "util/zmq_recver.hpp"
+#include "util/memory_sender.hpp"
 #include "util/dater.h"
 #include "util/history_worker.h"
+#include "util/day_summary.hpp"
+#include "util/day_index.hpp"
 #include "util/contract_worker.h"
 #include "util/common_tools.h"
 #include "struct/market_snapshot.h"
+#include "util/replay_cache.hpp"
+#include "util/backtest_result.hpp"
+#include "util/checkpoint.hpp"
 #include "./strategy.h"
+#include "./param_sweep.hpp"
 
 // std::unique_ptr<Sender<MarketSnapshot> > ui_sender(new ZmqSender<MarketSnapshot>("*:33333", "bind", "tcp", "mid.dat"));
 // std::unique_ptr<Sender<Order> > order_sender(new ZmqSender<Order>("order_sender", "connect", "ipc", "order.dat"));
 // std::unique_ptr<Sender<Order> > order_sender(new ZmqSender<Order>("order_sender", 100000, "order.dat"));
 
+// what one simulated day sends, kept in memory and dumped once the day is done
+struct DaySinks {
+  MemorySender<MarketSnapshot> ui_sender;
+  MemorySender<Order> order_sender;
+  std::unique_ptr<std::ofstream> exchange_file;
+  std::unique_ptr<SimExchange> exchange;  // test_mode sim only
+};
+
+// one strategy set up of a sweep run: parameters, latency, and the label it reports under
+struct Variant {
+  const libconfig::Setting* setting;
+  std::string label;
+  long long latency_us;  // extra submit latency of a latency sweep
+  SimLatency latency;
+};
+
+// one unit of a run: a day, or the merged period, for every strategy or for a slice
+// of the sweep variants
+struct Task {
+  std::string date;
+  std::vector<std::string> files;
+  std::vector<Variant> variants;  // empty for a plain run
+};
+
 struct BTConfig {
   std::string fixed_path;
   std::string backtest_outputdir;
   std::string start_date;
   int period;
   std::string test_mode;
+  bool continuous;
+  std::string sink_dump;
+  std::vector<std::string> time_window;
+  ParamSweep* sweep;
+  int sweep_threads;
+  SimLatency latency;
+  std::vector<long long> latency_sweep;
+  Checkpoint* checkpoint;  // nullptr when checkpoint = false
+  unsigned long long run_hash;  // binary, contract file and run settings, shared by every task
+  int threads;
+  std::vector<int> cpus;
+  int processes;  // > 0 runs the tasks in forked workers instead of threads
+  int process_retries;
+  int process_max_tasks;
+  bool profile;  // callback timings of every strategy in profile.txt
   // std::vector<const libconfig::Setting> strats;
   ContractWorker* strat_cw;
   ContractWorker* cw;
   TimeController* tc;
-  inline std::tuple<ZmqSender<MarketSnapshot> *, ZmqSender<Order> *, std::ofstream*> GenSender(const std::string& date) {
-    std::string ui_address = "backtest_ui_" + date;
-    std::string order_address = "order_sender_" + date;
-    std::string ui_file = backtest_outputdir + "/mid_" + date + ".dat";
-    std::string order_file = backtest_outputdir + "/order_" + date + ".dat";
-    return std::make_tuple(new ZmqSender<MarketSnapshot>(ui_address, "bind", "ipc", ui_file), new ZmqSender<Order>(order_address, "connect",  "ipc", order_file), new std::ofstream(backtest_outputdir + "/exchange_" + date + ".dat", ios::out | ios::binary));
+  inline void DumpSinks(const std::string& date, const DaySinks & sinks) {
+    if (sink_dump == "none") {
+      return;
+    }
+    std::string suffix = sink_dump == "gz" ? ".dat.gz" : ".dat";
+    sinks.ui_sender.Dump(backtest_outputdir + "/mid_" + date + suffix);
+    sinks.order_sender.Dump(backtest_outputdir + "/order_" + date + suffix);
   }
   inline HistoryWorker* GenHw(const std::string & date) {
-    return new HistoryWorker(Dater::FindOneValid(date, -20, fixed_path));
+    HistoryWorker* hw = new HistoryWorker();
+    LoadHistory(hw, Dater::FindOneValid(date, -20, fixed_path));
+    return hw;
   }
 } bt_config;
 
+ResultCollector results;
+
 void LoadConfig() {
   std::string default_path = GetDefaultPath();
   libconfig::Config param_cfg;
@@ -68,6 +126,30 @@ void LoadConfig() {
     bt_config.start_date = start_date;
     bt_config.period = period;
     bt_config.test_mode = test_mode;
+    bt_config.continuous = param_cfg.exists("continuous") && static_cast<bool>(param_cfg.lookup("continuous"));
+    bt_config.sink_dump = param_cfg.exists("sink_dump") ? param_cfg.lookup("sink_dump").c_str() : "dat";
+    bt_config.threads = param_cfg.exists("threads") ? static_cast<int>(param_cfg.lookup("threads")) : 0;
+    if (param_cfg.exists("cpus")) {
+      const libconfig::Setting & cpus = param_cfg.lookup("cpus");
+      for (int i = 0; i < cpus.getLength(); i++) {
+        bt_config.cpus.push_back(cpus[i]);
+      }
+    }
+    bt_config.profile = param_cfg.exists("profile") && static_cast<bool>(param_cfg.lookup("profile"));
+    Profiler::Instance().Enable(bt_config.profile);
+    bt_config.processes = 0;
+    bt_config.process_retries = 1;
+    bt_config.process_max_tasks = 0;
+    if (param_cfg.exists("processes")) {
+      const libconfig::Setting & processes = param_cfg.lookup("processes");
+      bt_config.processes = processes.exists("workers") ? static_cast<int>(processes["workers"]) : std::thread::hardware_concurrency();
+      if (processes.exists("retries")) {
+        bt_config.process_retries = static_cast<int>(processes["retries"]);
+      }
+      if (processes.exists("max_tasks")) {
+        bt_config.process_max_tasks = static_cast<int>(processes["max_tasks"]);
+      }
+    }
   } catch(const libconfig::SettingNotFoundException &nfex) {
     printf("Setting '%s' is missing", nfex.getPath());
     exit(1);
@@ -81,44 +163,471 @@ void LoadConfig() {
 
   std::string time_config_path = default_path + "/hft/config/prod/time.config";
   bt_config.tc = new TimeController(time_config_path);
+  libconfig::Config time_cfg;
+  time_cfg.readFile(time_config_path.c_str());
+  if (time_cfg.exists("time_controller.trade_time")) {
+    const libconfig::Setting & windows = time_cfg.lookup("time_controller.trade_time");
+    for (int i = 0; i < windows.getLength(); i++) {
+      std::string window = windows[i];
+      bt_config.time_window.push_back(window);
+    }
+  }
   bt_config.cw = new ContractWorker(contract_config_path);
   bt_config.strat_cw = new ContractWorker(config_path, "strategy");
+  bt_config.sweep = nullptr;
+  bt_config.sweep_threads = std::thread::hardware_concurrency();
+  if (param_cfg.exists("sweep")) {
+    const libconfig::Setting & sweep = param_cfg.lookup("sweep");
+    std::string strategy = sweep["strategy"];
+    bt_config.sweep = new ParamSweep(bt_config.strat_cw->Lookup(strategy), sweep);
+    if (sweep.exists("threads")) {
+      bt_config.sweep_threads = static_cast<int>(sweep["threads"]);
+    }
+    printf("sweep %s over %zu variants\n", strategy.c_str(), bt_config.sweep->Size());
+  }
+  if (param_cfg.exists("latency")) {
+    const libconfig::Setting & latency = param_cfg.lookup("latency");
+    const char* legs[] = {"market_data", "submit", "ack"};
+    LatencyModel* models[] = {&bt_config.latency.market_data, &bt_config.latency.submit, &bt_config.latency.ack};
+    for (int i = 0; i < 3; i++) {
+      if (latency.exists(legs[i]) && !models[i]->Parse(latency[legs[i]].c_str())) {
+        exit(1);
+      }
+    }
+    if (latency.exists("sweep")) {
+      const libconfig::Setting & values = latency["sweep"];
+      for (int i = 0; i < values.getLength(); i++) {
+        bt_config.latency_sweep.push_back(static_cast<int>(values[i]));
+      }
+    }
+    if (bt_config.test_mode != "sim") {
+      printf("latency only applies to test_mode sim, latency sweeps run in sim mode\n");
+    }
+  }
+  bt_config.checkpoint = nullptr;
+  if (!param_cfg.exists("checkpoint") || static_cast<bool>(param_cfg.lookup("checkpoint"))) {
+    bt_config.checkpoint = new Checkpoint(bt_config.backtest_outputdir + "/checkpoint");
+    // a rebuilt binary may trade differently, its results are not reused
+    unsigned long long h = Checkpoint::HashFile("/proc/self/exe");
+    h = Checkpoint::HashLibrary("nick", h);
+    h = Checkpoint::HashFile(contract_config_path, h);
+    // the force close, close and sleep windows of BaseStrategy::CheckStatus
+    h = Checkpoint::HashFile(time_config_path, h);
+    h = Fnv1a(bt_config.test_mode, h);
+    for (auto & w : bt_config.time_window) {
+      h = Fnv1a(w, h);
+    }
+    h = Fnv1a(bt_config.latency.market_data.Spec(), h);
+    h = Fnv1a(bt_config.latency.submit.Spec(), h);
+    h = Fnv1a(bt_config.latency.ack.Spec(), h);
+    bt_config.run_hash = h;
+  }
+}
+
+unsigned long long DataHash(const std::vector<std::string>& files) {
+  unsigned long long h = FNV_OFFSET;
+  for (auto & f : files) {
+    h = Checkpoint::HashDataFile(f, h);
+  }
+  return h;
+}
+
+// one (date, parameter set) task, from the content of everything that goes into it
+std::string TaskKey(unsigned long long data_hash, const std::string& date, const libconfig::Setting & setting, const std::string& label) {
+  unsigned long long h = Fnv1a(&data_hash, sizeof(data_hash), bt_config.run_hash);
+  h = Fnv1a(date, h);
+  h = Fnv1a(Checkpoint::SettingText(setting), h);
+  h = Fnv1a(label, h);
+  return Checkpoint::KeyString(h);
+}
+
+// true when the task finished in an earlier run, its result is collected again
+bool TaskDone(const std::string& key) {
+  BacktestResult r;
+  if (!bt_config.checkpoint || !bt_config.checkpoint->Load(key, &r)) {
+    return false;
+  }
+  results.Add(r);
+  return true;
+}
+
+void TaskFinished(const std::string& key, const BacktestResult & r) {
+  results.Add(r);
+  if (bt_config.checkpoint) {
+    bt_config.checkpoint->Save(key, r);
+  }
 }
 
 std::map<std::string, std::string> GetBacktestFile() {
   auto dt = Dater();
-  return dt.GetValidMap(bt_config.start_date, bt_config.period, bt_config.fixed_path);
+  std::map<std::string, std::string> m = dt.GetValidMap(bt_config.start_date, bt_config.period, bt_config.fixed_path);
+  // days whose index says there is nothing complete to replay are dropped up front
+  for (auto it = m.begin(); it != m.end();) {
+    DayIndex index(it->second);
+    if (index.LoadIfFresh() && !index.Usable()) {
+      printf("skip %s %s: %s\n", it->first.c_str(), it->second.c_str(), index.Problem().c_str());
+      it = m.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return m;
 }
 
-std::unordered_map<std::string, std::vector<BaseStrategy*> > GetStratMap(std::string date) {
+std::unordered_map<std::string, std::vector<BaseStrategy*> > GetStratMap(std::string date, DaySinks* sinks, const std::vector<std::string>& strat_names, std::vector<Strategy*>* strats) {
   std::unordered_map<std::string, std::vector<BaseStrategy*> > ticker_strat_map;
-  ZmqSender<MarketSnapshot> * data_sender;
-  ZmqSender<Order> * order_sender;
-  std::ofstream* f;
-  std::tie(data_sender, order_sender, f) = bt_config.GenSender(date);
-  for (auto ticker : bt_config.strat_cw->GetTicker()) {
+  sinks->exchange_file.reset(new std::ofstream(bt_config.backtest_outputdir + "/exchange_" + date + ".dat", ios::out | ios::binary));
+  BaseSender<Order>* order_sender = &sinks->order_sender;
+  if (bt_config.test_mode == "sim") {
+    sinks->exchange.reset(new SimExchange(&sinks->order_sender, bt_config.latency));
+    order_sender = sinks->exchange.get();
+  }
+  for (auto ticker : strat_names) {
     const libconfig::Setting & p = bt_config.strat_cw->Lookup(ticker);
-    auto s = new Strategy(p, &ticker_strat_map, data_sender, order_sender, bt_config.tc, bt_config.cw, date, bt_config.test_mode, f);
+    auto s = new Strategy(p, &ticker_strat_map, &sinks->ui_sender, order_sender, bt_config.tc, bt_config.cw, date, bt_config.test_mode, sinks->exchange_file.get());
     s->Print();
+    strats->push_back(s);
   }
   return ticker_strat_map;
 }
 
-void RunBacktest(const std::string& date, const std::string& f) {
+template <typename B>
+void LoadDay(B* bt, const std::unordered_map<std::string, std::vector<BaseStrategy*> > & tsm, const std::vector<std::string>& files) {
+  bt->FilterTickers(tsm);
+  for (auto & w : bt_config.time_window) {
+    bt->FilterTimeWindow(w);
+  }
+  bt->LoadData(files);
+}
+
+void RunBacktestFiles(const std::string& date, const std::vector<std::string>& files) {
   TimeController tc;
   tc.StartTimer();
-  auto tsm = GetStratMap(date);
-  Backtester bt(tsm);
-  bt.LoadData(f);
+  unsigned long long data_hash = bt_config.checkpoint ? DataHash(files) : 0;
+  std::vector<std::string> todo;
+  std::vector<std::string> keys;
+  for (auto ticker : bt_config.strat_cw->GetTicker()) {
+    std::string key = bt_config.checkpoint ? TaskKey(data_hash, date, bt_config.strat_cw->Lookup(ticker), "") : "";
+    if (!TaskDone(key)) {
+      todo.push_back(ticker);
+      keys.push_back(key);
+    }
+  }
+  if (todo.empty()) {
+    printf("%s: every strategy done in an earlier run\n", date.c_str());
+    return;
+  }
+  DaySinks sinks;
+  std::vector<Strategy*> strats;
+  auto tsm = GetStratMap(date, &sinks, todo, &strats);
+  // only the SimBacktester runs strategy timers, a strategy that uses them always
+  // gets it, so profiling or exchange output never changes what it trades
+  if (sinks.exchange || bt_config.profile || TimersUsed(tsm)) {
+    SimBacktester bt(tsm);
+    if (sinks.exchange) {
+      bt.AddExchange(sinks.exchange.get(), &tsm);
+    }
+    LoadDay(&bt, tsm, files);
+  } else {
+    Backtester bt(tsm);
+    LoadDay(&bt, tsm, files);
+  }
+  // strategies that failed their set up never joined positionend
+  const std::vector<BaseStrategy*> & running = tsm["positionend"];
+  for (size_t i = 0; i < strats.size(); i++) {
+    if (std::find(running.begin(), running.end(), strats[i]) != running.end()) {
+      TaskFinished(keys[i], strats[i]->Result());
+    }
+  }
+  bt_config.DumpSinks(date, sinks);
   tc.EndTimer("Run@" + date);
 }
 
+// parameter sets (the sweep group, or every configured strategy) times latencies (the
+// latency sweep, or the configured one)
+std::vector<Variant> GetVariants() {
+  std::vector<std::pair<const libconfig::Setting*, std::string> > params;
+  if (bt_config.sweep) {
+    for (size_t i = 0; i < bt_config.sweep->Size(); i++) {
+      params.push_back(std::make_pair(&bt_config.sweep->Get(i), bt_config.sweep->Label(i)));
+    }
+  } else {
+    for (auto ticker : bt_config.strat_cw->GetTicker()) {
+      params.push_back(std::make_pair(&bt_config.strat_cw->Lookup(ticker), std::string()));
+    }
+  }
+  std::vector<long long> latencies = bt_config.latency_sweep;
+  if (latencies.empty()) {
+    latencies.push_back(0);
+  }
+  std::vector<Variant> variants;
+  for (auto & p : params) {
+    for (auto us : latencies) {
+      Variant v;
+      v.setting = p.first;
+      v.label = p.second;
+      v.latency_us = us;
+      v.latency = bt_config.latency;
+      if (!bt_config.latency_sweep.empty()) {
+        v.latency.submit.SetOffset(us);
+        v.label += (v.label.empty() ? "" : " ") + std::string("latency_us=") + std::to_string(us);
+      }
+      variants.push_back(v);
+    }
+  }
+  return variants;
+}
+
+// every variant on one decoded day: the day goes through the merged reader once,
+// then each thread replays the shared cache into its shard of variants
+void RunSweep(WorkStealingPool* pool, const std::string& date, const std::vector<std::string>& files, const std::vector<Variant> & all_variants) {
+  unsigned long long data_hash = bt_config.checkpoint ? DataHash(files) : 0;
+  std::vector<Variant> variants;
+  std::vector<std::string> keys;
+  for (auto & v : all_variants) {
+    std::string key = bt_config.checkpoint ? TaskKey(data_hash, date, *v.setting, v.label) : "";
+    if (!TaskDone(key)) {
+      variants.push_back(v);
+      keys.push_back(key);
+    }
+  }
+  if (variants.empty()) {
+    printf("%s: every variant done in an earlier run\n", date.c_str());
+    return;
+  }
+  TimeController tc;
+  tc.StartTimer();
+  size_t shard_num = std::max<size_t>(1, std::min<size_t>(std::max(1, bt_config.sweep_threads), variants.size()));
+  std::vector<std::unordered_map<std::string, std::vector<BaseStrategy*> > > shard_tsm(shard_num);
+  std::vector<std::unique_ptr<std::ofstream> > exchange_files;
+  for (size_t i = 0; i < shard_num; i++) {
+    exchange_files.emplace_back(new std::ofstream("/dev/null", ios::out | ios::binary));
+  }
+  NullSender<MarketSnapshot> ui_sender;
+  NullSender<Order> order_sender;
+  std::vector<std::unique_ptr<Strategy> > strats;
+  // in sim mode every variant trades on its own exchange, its own queue positions
+  bool sim = bt_config.test_mode == "sim" || !bt_config.latency_sweep.empty();
+  std::string mode = sim ? "sim" : bt_config.test_mode;
+  std::vector<std::unordered_map<std::string, std::vector<BaseStrategy*> > > variant_tsm(variants.size());
+  std::vector<std::unique_ptr<SimExchange> > exchanges;
+  for (size_t i = 0; i < variants.size(); i++) {
+    size_t s = i % shard_num;
+    BaseSender<Order>* sender = &order_sender;
+    if (sim) {
+      exchanges.emplace_back(new SimExchange(nullptr, variants[i].latency));
+      sender = exchanges.back().get();
+    }
+    strats.emplace_back(new Strategy(*variants[i].setting, &variant_tsm[i], &ui_sender, sender, bt_config.tc, bt_config.cw, date, mode, exchange_files[s].get()));
+    strats.back()->SetResultLabel(variants[i].label);
+    for (auto & t : variant_tsm[i]) {
+      std::vector<BaseStrategy*> & v = shard_tsm[s][t.first];
+      v.insert(v.end(), t.second.begin(), t.second.end());
+    }
+  }
+  ShotFilter<MarketSnapshot> filter;
+  for (auto & m : shard_tsm) {
+    filter.AddTickers(m);
+  }
+  for (auto & w : bt_config.time_window) {
+    filter.AddTimeWindow(w);
+  }
+  ReplayCache<MarketSnapshot> cache;
+  cache.Load(files, &filter);
+  TaskGroup shards(pool);
+  for (size_t s = 0; s < shard_num; s++) {
+    shards.Run([&shard_tsm, &variant_tsm, &exchanges, &cache, sim, shard_num, s]() {
+      if (sim || bt_config.profile || TimersUsed(shard_tsm[s])) {
+        SimBacktester bt(shard_tsm[s]);
+        for (size_t i = s; i < exchanges.size(); i += shard_num) {
+          bt.AddExchange(exchanges[i].get(), &variant_tsm[i]);
+        }
+        bt.Replay(cache);
+      } else {
+        Backtester bt(shard_tsm[s]);
+        bt.Replay(cache);
+      }
+    });
+  }
+  shards.Wait();
+  for (size_t i = 0; i < strats.size(); i++) {
+    TaskFinished(keys[i], strats[i]->Result());
+  }
+  tc.EndTimer("Sweep@" + date + " " + std::to_string(cache.Size()) + " shots x " + std::to_string(variants.size()) + " variants");
+}
+
+// written once after all runs: results.csv has a line per run, results_summary.csv
+// merges the days per strategy and parameter set, results.json adds the hourly pnl
+void WriteResults() {
+  results.WriteCsv(bt_config.backtest_outputdir + "/results.csv");
+  results.WriteSummaryCsv(bt_config.backtest_outputdir + "/results_summary.csv");
+  results.WriteJson(bt_config.backtest_outputdir + "/results.json");
+  results.Print();
+  if (bt_config.profile) {
+    Profiler::Instance().Write(bt_config.backtest_outputdir + "/profile.txt");
+    Profiler::Instance().Print();
+  }
+}
+
+// pnl against the extra submit latency, one line per parameter set and latency
+void WriteLatencyCurve(const std::vector<Variant> & variants) {
+  std::map<std::string, BacktestResult> totals;
+  for (auto & r : results.Totals()) {
+    totals[r.Key()] = r;
+  }
+  std::string path = bt_config.backtest_outputdir + "/latency_curve.csv";
+  FILE* f = fopen(path.c_str(), "w");
+  if (!f) {
+    printf("open %s failed!\n", path.c_str());
+    return;
+  }
+  fprintf(f, "strategy,params,latency_us,pnl,fee,rounds,max_drawdown\n");
+  for (auto & v : variants) {
+    BacktestResult key;
+    key.strategy = (*v.setting)["unique_name"].c_str();
+    key.params = v.label;
+    auto it = totals.find(key.Key());
+    if (it == totals.end()) {
+      continue;
+    }
+    const BacktestResult & r = it->second;
+    size_t cut = v.label.rfind("latency_us=");
+    std::string params = cut == std::string::npos || cut == 0 ? "" : v.label.substr(0, cut - 1);
+    fprintf(f, "%s,%s,%lld,%lf,%lf,%d,%lf\n", r.strategy.c_str(), params.c_str(), v.latency_us, r.pnl, r.fee, r.rounds, r.max_drawdown);
+  }
+  fclose(f);
+}
+
+void RunBacktest(const std::string& date, const std::string& f) {
+  RunBacktestFiles(date, std::vector<std::string>(1, f));
+}
+
+// biggest files first, so a long day never starts last while the others idle
+std::vector<std::pair<std::string, std::string> > SortBySize(const std::map<std::string, std::string> & file_v) {
+  std::vector<std::pair<long long, std::pair<std::string, std::string> > > v;
+  for (auto & i : file_v) {
+    struct stat st;
+    long long size = stat(i.second.c_str(), &st) == 0 ? st.st_size : 0;
+    v.push_back(std::make_pair(size, i));
+  }
+  std::stable_sort(v.begin(), v.end(), [](const std::pair<long long, std::pair<std::string, std::string> > & a, const std::pair<long long, std::pair<std::string, std::string> > & b) {
+    return a.first > b.first;
+  });
+  std::vector<std::pair<std::string, std::string> > r;
+  for (auto & i : v) {
+    r.push_back(i.second);
+  }
+  return r;
+}
+
+// days biggest first; with slices > 1 the variants of a sweep are cut into that many
+// tasks per day, so a few days still keep every worker process busy
+std::vector<Task> GetTasks(const std::map<std::string, std::string> & file_v, const std::vector<Variant> & variants, size_t slices) {
+  std::vector<Task> tasks;
+  if (bt_config.continuous) {
+    Task t;
+    t.date = file_v.begin()->first;
+    for (auto & i : file_v) {
+      t.files.push_back(i.second);
+    }
+    tasks.push_back(t);
+  } else {
+    for (auto & i : SortBySize(file_v)) {
+      Task t;
+      t.date = i.first;
+      t.files.push_back(i.second);
+      tasks.push_back(t);
+    }
+  }
+  if (variants.empty()) {
+    return tasks;
+  }
+  slices = std::max<size_t>(1, std::min(slices, variants.size()));
+  std::vector<Task> sliced;
+  for (auto & t : tasks) {
+    for (size_t s = 0; s < slices; s++) {
+      Task part = t;
+      for (size_t i = s; i < variants.size(); i += slices) {
+        part.variants.push_back(variants[i]);
+      }
+      sliced.push_back(part);
+    }
+  }
+  return sliced;
+}
+
+void RunTask(WorkStealingPool* pool, const Task & t) {
+  if (t.variants.empty()) {
+    RunBacktestFiles(t.date, t.files);
+  } else {
+    RunSweep(pool, t.date, t.files, t.variants);
+  }
+}
+
+// every task in a forked worker, a crash costs the task, not the run
+void RunProcesses(const std::vector<Task> & tasks) {
+  ProcessPool processes(bt_config.processes, bt_config.process_retries, bt_config.process_max_tasks, bt_config.cpus);
+  processes.Run(tasks.size(), [&tasks](size_t i) {
+    // a worker forked mid run inherits the results the parent already merged, and the
+    // tasks before this one on the same worker were sent already
+    results.Take();
+    {
+      WorkStealingPool pool(1);
+      RunTask(&pool, tasks[i]);
+    }
+    // histograms stay in the worker, each leaves its own table
+    if (bt_config.profile) {
+      Profiler::Instance().Write(bt_config.backtest_outputdir + "/profile_" + std::to_string(getpid()) + ".txt");
+    }
+    std::string payload;
+    for (auto & r : results.Take()) {
+      payload += r.Serialize();
+    }
+    return payload;
+  }, [](size_t /*i*/, const std::string & payload) {
+    std::istringstream in(payload);
+    std::string names, numbers;
+    while (getline(in, names) && getline(in, numbers)) {
+      BacktestResult r;
+      if (r.Deserialize(names + "\n" + numbers)) {
+        results.Add(r);
+      }
+    }
+  }, [&tasks](size_t i) {
+    printf("task %s with %zu variants failed, rerun to retry it\n", tasks[i].date.c_str(), tasks[i].variants.size());
+  });
+}
+
 int main() {
   LoadConfig();
   auto file_v = GetBacktestFile();
   PrintMap(file_v);
-  ThreadPool pool(6);
-  for (auto i: file_v) {
-    pool.enqueue(RunBacktest, i.first, i.second);
+  if (file_v.empty()) {
+    WriteResults();
+    return 0;
+  }
+  bool sweep = bt_config.sweep || !bt_config.latency_sweep.empty();
+  std::vector<Variant> variants;
+  if (sweep) {
+    variants = GetVariants();
+  }
+  if (bt_config.processes > 0) {
+    // no thread may exist before the workers fork, each worker starts its own
+    size_t days = bt_config.continuous ? 1 : file_v.size();
+    RunProcesses(GetTasks(file_v, variants, (bt_config.processes + days - 1) / days));
+  } else {
+    // days and the variant shards inside them share the pool, a waiting day helps its shards
+    WorkStealingPool pool(bt_config.threads, bt_config.cpus);
+    TaskGroup days(&pool);
+    for (auto & t : GetTasks(file_v, variants, 1)) {
+      days.Run([&pool, t]() {
+        RunTask(&pool, t);
+      });
+    }
+    days.Wait();
+  }
+  WriteResults();
+  if (!bt_config.latency_sweep.empty()) {
+    WriteLatencyCurve(variants);
   }
 }
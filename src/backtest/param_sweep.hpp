@@ -0,0 +1,179 @@
+#ifndef SRC_BACKTEST_PARAM_SWEEP_HPP_
+#define SRC_BACKTEST_PARAM_SWEEP_HPP_
+
+#include <stdio.h>
+#include <math.h>
+#include <libconfig.h++>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// expands the sweep group of backtest.config into full strategy settings:
+//   sweep = {
+//     strategy = "IC";
+//     threads = 4;
+//     grid = { range_width = [1.5, 2.0]; min_range = [3.0, 4.0]; };
+//     list = ( { range_width = 2.5; min_train_samples = 600; } );
+//   };
+// grid gives the cartesian product, list gives explicit sets, both may be present
+// every variant is a copy of the base strategy with the listed keys overridden
+class ParamSweep {
+ public:
+  ParamSweep(const libconfig::Setting & base, const libconfig::Setting & sweep) {
+    if (sweep.exists("grid")) {
+      const libconfig::Setting & grid = sweep["grid"];
+      std::vector<const libconfig::Setting*> choice;
+      ExpandGrid(base, grid, 0, &choice);
+    }
+    if (sweep.exists("list")) {
+      const libconfig::Setting & list = sweep["list"];
+      for (int i = 0; i < list.getLength(); i++) {
+        std::vector<const libconfig::Setting*> choice;
+        for (int j = 0; j < list[i].getLength(); j++) {
+          choice.push_back(&list[i][j]);
+        }
+        AddVariant(base, choice);
+      }
+    }
+  }
+
+  ~ParamSweep() {
+  }
+
+  size_t Size() const {
+    return variants.size();
+  }
+
+  const libconfig::Setting & Get(size_t i) const {
+    return variants[i].cfg->getRoot()["strategy"];
+  }
+
+  // "range_width=1.5 min_range=3"
+  const std::string & Label(size_t i) const {
+    return variants[i].label;
+  }
+
+  // overridden keys with their values, in config order
+  const std::vector<std::pair<std::string, std::string> > & Params(size_t i) const {
+    return variants[i].params;
+  }
+
+  static std::string ValueString(const libconfig::Setting & s) {
+    char buffer[64];
+    switch (s.getType()) {
+     case libconfig::Setting::TypeInt:
+     case libconfig::Setting::TypeInt64:
+     case libconfig::Setting::TypeFloat:
+      snprintf(buffer, sizeof(buffer), "%.10g", Number(s));
+      return buffer;
+     case libconfig::Setting::TypeBoolean:
+      return static_cast<bool>(s) ? "true" : "false";
+     case libconfig::Setting::TypeString:
+      return s.c_str();
+     default:
+      return "?";
+    }
+  }
+
+ private:
+  struct Variant {
+    std::unique_ptr<libconfig::Config> cfg;
+    std::string label;
+    std::vector<std::pair<std::string, std::string> > params;
+  };
+
+  void ExpandGrid(const libconfig::Setting & base, const libconfig::Setting & grid, int k, std::vector<const libconfig::Setting*>* choice) {
+    if (k == grid.getLength()) {
+      AddVariant(base, *choice);
+      return;
+    }
+    const libconfig::Setting & values = grid[k];
+    if (!values.isAggregate()) {
+      choice->push_back(&values);
+      ExpandGrid(base, grid, k + 1, choice);
+      choice->pop_back();
+      return;
+    }
+    for (int i = 0; i < values.getLength(); i++) {
+      choice->push_back(&values[i]);
+      ExpandGrid(base, grid, k + 1, choice);
+      choice->pop_back();
+    }
+  }
+
+  // the name of an array element is the name of its array
+  static const char* KeyOf(const libconfig::Setting & s) {
+    return s.getName() ? s.getName() : s.getParent().getName();
+  }
+
+  void AddVariant(const libconfig::Setting & base, const std::vector<const libconfig::Setting*> & choice) {
+    Variant v;
+    v.cfg.reset(new libconfig::Config);
+    libconfig::Setting & strat = v.cfg->getRoot().add("strategy", libconfig::Setting::TypeGroup);
+    Copy(base, strat);
+    for (auto c : choice) {
+      const char* key = KeyOf(*c);
+      libconfig::Setting::Type type = c->getType();
+      // keep the type the strategy reads, 2 in the grid still fills a double param
+      if (strat.exists(key)) {
+        if (strat[key].isNumber() && c->isNumber()) {
+          type = strat[key].getType();
+        }
+        strat.remove(key);
+      }
+      Assign(*c, strat.add(key, type));
+      std::string value = ValueString(strat[key]);
+      v.params.push_back(std::make_pair(std::string(key), value));
+      v.label += (v.label.empty() ? "" : " ") + std::string(key) + "=" + value;
+    }
+    variants.push_back(std::move(v));
+  }
+
+  // libconfig only converts between number types with auto convert on, so read the stored type
+  static double Number(const libconfig::Setting & s) {
+    switch (s.getType()) {
+     case libconfig::Setting::TypeInt:
+      return static_cast<int>(s);
+     case libconfig::Setting::TypeInt64:
+      return static_cast<double>(static_cast<long long>(s));
+     default:
+      return static_cast<double>(s);
+    }
+  }
+
+  static void Assign(const libconfig::Setting & from, libconfig::Setting & to) {
+    switch (to.getType()) {
+     case libconfig::Setting::TypeInt:
+      to = static_cast<int>(llround(Number(from)));
+      break;
+     case libconfig::Setting::TypeInt64:
+      to = static_cast<long long>(llround(Number(from)));
+      break;
+     case libconfig::Setting::TypeFloat:
+      to = Number(from);
+      break;
+     case libconfig::Setting::TypeBoolean:
+      to = static_cast<bool>(from);
+      break;
+     case libconfig::Setting::TypeString:
+      to = from.c_str();
+      break;
+     default:
+      Copy(from, to);
+    }
+  }
+
+  static void Copy(const libconfig::Setting & from, libconfig::Setting & to) {
+    for (int i = 0; i < from.getLength(); i++) {
+      const libconfig::Setting & s = from[i];
+      libconfig::Setting & t = to.isGroup() ? to.add(s.getName(), s.getType()) : to.add(s.getType());
+      Assign(s, t);
+    }
+  }
+
+  std::vector<Variant> variants;
+};
+
+#endif  // SRC_BACKTEST_PARAM_SWEEP_HPP_
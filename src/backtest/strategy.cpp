@@ -5,7 +5,7 @@
 
 #include "./strategy.h"
 
-Strategy::Strategy(const libconfig::Setting & param_setting, std::unordered_map<std::string, std::vector<BaseStrategy*> >*ticker_strat_map, ZmqSender<MarketSnapshot>* uisender, ZmqSender<Order>* ordersender, TimeController* tc, ContractWorker* cw, const std::string & date, const std::string & mode, std::ofstream* exchange_file)
+Strategy::Strategy(const libconfig::Setting & param_setting, std::unordered_map<std::string, std::vector<BaseStrategy*> >*ticker_strat_map, BaseSender<MarketSnapshot>* uisender, BaseSender<Order>* ordersender, TimeController* tc, ContractWorker* cw, const std::string & date, const std::string & mode, std::ofstream* exchange_file)
   : mode(mode),
     date(date),
     last_valid_mid(0.0),
@@ -16,18 +16,30 @@ Strategy::Strategy(const libconfig::Setting & param_setting, std::unordered_map<
     close_round(0),
     sample_head(0),
     sample_tail(0),
-    exchange_file(exchange_file) {
+    exchange_file(exchange_file),
+    holding_deadline(false),
+    holding_timer(0) {
   m_tc = tc;
   m_cw = cw;
+  main_slot = nullptr;
+  hedge_slot = nullptr;
   if (FillStratConfig(param_setting)) {
     RunningSetup(ticker_strat_map, uisender, ordersender, mode);
   }
+  result.date = date;
+  result.strategy = m_strat_name;
+  Profiler & profiler = Profiler::Instance();
+  profiler.SetOwner(this, m_strat_name);
+  prof_update_data = profiler.Point(m_strat_name, "DoOperationAfterUpdateData");
+  prof_run = profiler.Point(m_strat_name, "Run");
+  prof_moderate_orders = profiler.Point(m_strat_name, "ModerateOrders");
+  prof_cal_params = profiler.Point(m_strat_name, "CalParams");
 }
 
 Strategy::~Strategy() {
 }
 
-void Strategy::RunningSetup(std::unordered_map<std::string, std::vector<BaseStrategy*> >*ticker_strat_map, ZmqSender<MarketSnapshot>* uisender, ZmqSender<Order>* ordersender, const std::string & mode) {
+void Strategy::RunningSetup(std::unordered_map<std::string, std::vector<BaseStrategy*> >*ticker_strat_map, BaseSender<MarketSnapshot>* uisender, BaseSender<Order>* ordersender, const std::string & mode) {
   ui_sender = uisender;
   order_sender = ordersender;
   (*ticker_strat_map)[main_ticker].emplace_back(this);
@@ -38,7 +50,10 @@ void Strategy::RunningSetup(std::unordered_map<std::string, std::vector<BaseStra
   shot_map[hedge_ticker] = shot;
   avgcost_map[main_ticker] = 0.0;
   avgcost_map[hedge_ticker] = 0.0;
-  if (mode == "test" || mode == "nexttest") {
+  main_slot = slots.Get(slots.Add(main_ticker, &shot_map, &next_shot_map));
+  hedge_slot = slots.Get(slots.Add(hedge_ticker, &shot_map, &next_shot_map));
+  map_stats.Reset(min_train_sample);
+  if (mode == "test" || mode == "nexttest" || mode == "sim") {
     position_ready = true;
   }
 }
@@ -78,6 +93,9 @@ bool Strategy::FillStratConfig(const libconfig::Setting& param_setting) {
     if (param_setting.exists("no_close_today")) {
       no_close_today = param_setting["no_close_today"];
     }
+    if (param_setting.exists("holding_deadline")) {
+      holding_deadline = param_setting["holding_deadline"];
+    }
   } catch(const libconfig::SettingNotFoundException &nfex) {
     printf("Setting '%s' is missing", nfex.getPath());
     exit(1);
@@ -101,7 +119,7 @@ void Strategy::Stop() {
 }
 
 bool Strategy::IsAlign() {
-  if (shot_map[main_ticker].time.tv_sec == shot_map[hedge_ticker].time.tv_sec && abs(shot_map[main_ticker].time.tv_usec-shot_map[hedge_ticker].time.tv_usec) < 100000) {
+  if (main_slot->shot->time.tv_sec == hedge_slot->shot->time.tv_sec && abs(main_slot->shot->time.tv_usec-hedge_slot->shot->time.tv_usec) < 100000) {
     return true;
   }
   return false;
@@ -136,20 +154,20 @@ double Strategy::OrderPrice(const std::string & ticker, OrderSide::Enum side, bo
     // double slip = (side == OrderSide::Buy)? shot_map[ticker].asks[0] - next_shot_map[ticker].asks[0] : next_shot_map[ticker].bids[0] - shot_map[ticker].bids[0];
     if (ticker == hedge_ticker) {
       // printf("Slip hedge[%s] %s: %lf %lf ->> %lf %lf pnl:%lf\n", ticker.c_str(), OrderSide::ToString(side), shot_map[ticker].asks[0], shot_map[ticker].bids[0], next_shot_map[ticker].asks[0], next_shot_map[ticker].bids[0], slip);
-      return (side == OrderSide::Buy)?next_shot_map[ticker].asks[0]:next_shot_map[ticker].bids[0];
+      return (side == OrderSide::Buy)?NextShot(ticker).asks[0]:NextShot(ticker).bids[0];
     } else if (ticker == main_ticker) {
       // printf("Slip main[%s] %s: %lf %lf ->> %lf %lf pnl:%lf\n", ticker.c_str(), OrderSide::ToString(side), shot_map[ticker].asks[0], shot_map[ticker].bids[0], next_shot_map[ticker].asks[0], next_shot_map[ticker].bids[0], slip);
       // return (side == OrderSide::Buy)?next_shot_map[ticker].asks[0]:next_shot_map[ticker].bids[0];
-      return (side == OrderSide::Buy)?shot_map[ticker].asks[0]:shot_map[ticker].bids[0];
+      return (side == OrderSide::Buy)?Shot(ticker).asks[0]:Shot(ticker).bids[0];
     } else {
       printf("error ticker %s\n", ticker.c_str());
       return -1.0;
     }
   } else {
     if (ticker == hedge_ticker) {
-      return (side == OrderSide::Buy)?shot_map[hedge_ticker].asks[0]:shot_map[hedge_ticker].bids[0];
+      return (side == OrderSide::Buy)?hedge_slot->shot->asks[0]:hedge_slot->shot->bids[0];
     } else if (ticker == main_ticker) {
-      return (side == OrderSide::Buy)?shot_map[main_ticker].asks[0]:shot_map[main_ticker].bids[0];
+      return (side == OrderSide::Buy)?main_slot->shot->asks[0]:main_slot->shot->bids[0];
     } else {
       printf("error ticker %s\n", ticker.c_str());
       return -1.0;
@@ -157,38 +175,27 @@ double Strategy::OrderPrice(const std::string & ticker, OrderSide::Enum side, bo
   }
 }
 
-std::tuple<double, double> Strategy::CalMeanStd(const std::vector<double> & v, int head, int num) {
-  std::vector<double> cal_v(v.begin() + head, v.begin() + head + num);
-  double mean = 0.0;
-  double std = 0.0;
-  for (auto i : cal_v) {
-    mean += i;
-  }
-  mean /= num;
-  for (auto i : cal_v) {
-    std += (i-mean) * (i-mean);
-  }
-  std /= num;
-  std = sqrt(std);
-  return std::tie(mean, std);
+// slots for the own tickers, the map for anything else
+const MarketSnapshot & Strategy::Shot(const std::string & ticker) {
+  InstrumentSlot* slot = slots.Find(ticker);
+  return slot ? *slot->shot : shot_map[ticker];
+}
+
+const MarketSnapshot & Strategy::NextShot(const std::string & ticker) {
+  InstrumentSlot* slot = slots.Find(ticker);
+  return slot ? *slot->next_shot : next_shot_map[ticker];
 }
 
 void Strategy::CalParams() {
+  ScopedProfile prof(prof_cal_params);
   // int num_sample = sample_tail - sample_head;
   if (sample_tail < min_train_sample) {
     printf("[%s %s]no enough mid data! tail is %d\n", main_ticker.c_str(), hedge_ticker.c_str(), sample_tail);
     exit(1);
   }
   param_v.clear();
-  auto r = CalMeanStd(map_vector, sample_tail - min_train_sample, min_train_sample);
-  double avg = std::get<0>(r);
-  double std = std::get<1>(r);
-  /*
-  unsigned int head = map_vector.size() - min_train_sample;
-  for (int i = 0; i < split_num; ++i) {
-    param_v.push_back(std::get<0>(CalMeanStd(map_vector, head+i*min_train_sample/split_num, min_train_sample/split_num)));
-  }
-  */
+  double avg = map_stats.Mean();
+  double std = map_stats.Std();
   FeePoint main_point = m_cw->CalFeePoint(main_ticker, GetMid(main_ticker), 1, GetMid(main_ticker), 1, no_close_today);
   FeePoint hedge_point = m_cw->CalFeePoint(hedge_ticker, GetMid(hedge_ticker), 1, GetMid(hedge_ticker), 1, no_close_today);
   double round_fee_cost = main_point.open_fee_point + main_point.close_fee_point + hedge_point.open_fee_point + hedge_point.close_fee_point;
@@ -221,9 +228,9 @@ bool Strategy::HitMean() {
 }
 
 void Strategy::ForceFlat() {
-  printf("%ld [%s %s]this round hit stop_loss condition, pos:%d current_mid:%lf, current_spread:%lf stoplossline %lf-%lf forceflat\n", shot_map[hedge_ticker].time.tv_sec, main_ticker.c_str(), hedge_ticker.c_str(), position_map[main_ticker], GetPairMid(), current_spread, stop_loss_down_line, stop_loss_up_line);
-  shot_map[main_ticker].Show(stdout);
-  shot_map[hedge_ticker].Show(stdout);
+  printf("%ld [%s %s]this round hit stop_loss condition, pos:%d current_mid:%lf, current_spread:%lf stoplossline %lf-%lf forceflat\n", hedge_slot->shot->time.tv_sec, main_ticker.c_str(), hedge_ticker.c_str(), position_map[main_ticker], GetPairMid(), current_spread, stop_loss_down_line, stop_loss_up_line);
+  main_slot->shot->Show(stdout);
+  hedge_slot->shot->Show(stdout);
   for (int i = 0; i < max_close_try; i++) {
     if (Close(true)) {
       break;
@@ -238,11 +245,12 @@ void Strategy::ForceFlat() {
 }
 
 void Strategy::RecordSlip(const std::string & ticker, OrderSide::Enum side, bool is_close) {
-    double slip = (side == OrderSide::Buy)? shot_map[ticker].asks[0] - next_shot_map[ticker].asks[0] : next_shot_map[ticker].bids[0] - shot_map[ticker].bids[0];
+    double slip = (side == OrderSide::Buy)? Shot(ticker).asks[0] - NextShot(ticker).asks[0] : NextShot(ticker).bids[0] - Shot(ticker).bids[0];
+  result.AddSlip(slip);
   if (ticker == hedge_ticker) {
-    printf("Slip%s hedge[%s] %s: %lf %lf ->> %lf %lf pnl:%lf\n", is_close ? " close" : " open", ticker.c_str(), OrderSide::ToString(side), shot_map[ticker].asks[0], shot_map[ticker].bids[0], next_shot_map[ticker].asks[0], next_shot_map[ticker].bids[0], slip);
+    printf("Slip%s hedge[%s] %s: %lf %lf ->> %lf %lf pnl:%lf\n", is_close ? " close" : " open", ticker.c_str(), OrderSide::ToString(side), Shot(ticker).asks[0], Shot(ticker).bids[0], NextShot(ticker).asks[0], NextShot(ticker).bids[0], slip);
   } else if (ticker == main_ticker) {
-    printf("Slip%s main[%s] %s: %lf %lf ->> %lf %lf pnl:%lf\n", is_close ? " close" : " open", ticker.c_str(), OrderSide::ToString(side), shot_map[ticker].asks[0], shot_map[ticker].bids[0], next_shot_map[ticker].asks[0], next_shot_map[ticker].bids[0], slip);
+    printf("Slip%s main[%s] %s: %lf %lf ->> %lf %lf pnl:%lf\n", is_close ? " close" : " open", ticker.c_str(), OrderSide::ToString(side), Shot(ticker).asks[0], Shot(ticker).bids[0], NextShot(ticker).asks[0], NextShot(ticker).bids[0], slip);
   } else {
     printf("error ticker %s\n", ticker.c_str());
   }
@@ -320,7 +328,7 @@ void Strategy::CloseLogic() {
   }
 
   if (TimeUp()) {
-    printf("[%s %s] holding time up, start from %ld, now is %ld, max_hold is %d close diff is %lf force to close position!\n", main_ticker.c_str(), hedge_ticker.c_str(), build_position_time, mode == "test" || mode == "nexttest" ? shot_map[main_ticker].time.tv_sec : m_tc->CurrentInt(), max_holding_sec, GetPairMid());
+    printf("[%s %s] holding time up, start from %ld, now is %ld, max_hold is %d close diff is %lf force to close position!\n", main_ticker.c_str(), hedge_ticker.c_str(), build_position_time, mode != "real" ? main_slot->shot->time.tv_sec : m_tc->CurrentInt(), max_holding_sec, GetPairMid());
     ForceFlat();
     return;
   }
@@ -371,6 +379,7 @@ bool Strategy::OpenLogic() {
 }
 
 void Strategy::Run() {
+  ScopedProfile prof(prof_run);
   if (IsAlign() && close_round < max_round) {
       if (!OpenLogic()) {
         CloseLogic();
@@ -387,38 +396,42 @@ void Strategy::Init() {
 }
 
 void Strategy::DoOperationAfterUpdateData(const MarketSnapshot& shot) {
-  mid_map[shot.ticker] = (shot.bids[0]+shot.asks[0]) / 2;  // mid_map saved the newest mid, no matter it is aligned or not
-  current_spread = shot_map[main_ticker].asks[0] - shot_map[main_ticker].bids[0] + shot_map[hedge_ticker].asks[0] - shot_map[hedge_ticker].bids[0];
+  ScopedProfile prof(prof_update_data);
+  InstrumentSlot* slot = slots.Find(shot.ticker);
+  if (slot) {
+    slot->mid = (shot.bids[0]+shot.asks[0]) / 2;  // the newest mid, no matter it is aligned or not
+  }
+  current_spread = main_slot->shot->asks[0] - main_slot->shot->bids[0] + hedge_slot->shot->asks[0] - hedge_slot->shot->bids[0];
   if (IsAlign()) {
     double mid = GetPairMid();
-    map_vector.emplace_back(mid);  // map_vector saved the aligned mid, all the elements here are safe to trade
+    map_stats.Push(mid);  // map_stats holds the aligned mids, all the elements here are safe to trade
     int num_sample = ++sample_tail - sample_head;
     if (num_sample > min_train_sample && num_sample % (min_train_sample) == 1) {
       CalParams();
     }
-    if (mode != "test" && mode != "nexttest") {
-      printf("%ld [%s, %s]mid_diff is %lf\n", shot.time.tv_sec, main_ticker.c_str(), hedge_ticker.c_str(), mid_map[main_ticker]-mid_map[hedge_ticker]);
+    if (mode == "real") {
+      printf("%ld [%s, %s]mid_diff is %lf\n", shot.time.tv_sec, main_ticker.c_str(), hedge_ticker.c_str(), main_slot->mid-hedge_slot->mid);
     }
     if (ss == StrategyStatus::Training) {
       mean = down_diff = up_diff = stop_loss_down_line = stop_loss_up_line = mid;
     }
     MarketSnapshot shot;
     snprintf(shot.ticker, sizeof(shot.ticker), "['%s', '%s']", main_ticker.c_str(), hedge_ticker.c_str());
-    shot.time = shot_map[hedge_ticker].time;
+    shot.time = hedge_slot->shot->time;
     shot.bids[0] = down_diff - current_spread/2;
     shot.bids[1] = stop_loss_down_line;
     shot.bids[2] = mean - current_spread/2;
     shot.asks[0] = up_diff + current_spread/2;
     shot.asks[1] = stop_loss_up_line;
     shot.asks[2] = mean + current_spread/2;
-    shot.bids[3] = shot_map[main_ticker].bids[0];
-    shot.asks[3] = shot_map[main_ticker].asks[0];
-    shot.bids[4] = shot_map[hedge_ticker].bids[0];
-    shot.asks[4] = shot_map[hedge_ticker].asks[0];
-    shot.bid_sizes[3] = shot_map[main_ticker].bid_sizes[0];
-    shot.ask_sizes[3] = shot_map[main_ticker].ask_sizes[0];
-    shot.bid_sizes[4] = shot_map[hedge_ticker].bid_sizes[0];
-    shot.ask_sizes[4] = shot_map[hedge_ticker].ask_sizes[0];
+    shot.bids[3] = main_slot->shot->bids[0];
+    shot.asks[3] = main_slot->shot->asks[0];
+    shot.bids[4] = hedge_slot->shot->bids[0];
+    shot.asks[4] = hedge_slot->shot->asks[0];
+    shot.bid_sizes[3] = main_slot->shot->bid_sizes[0];
+    shot.ask_sizes[3] = main_slot->shot->ask_sizes[0];
+    shot.bid_sizes[4] = hedge_slot->shot->bid_sizes[0];
+    shot.ask_sizes[4] = hedge_slot->shot->ask_sizes[0];
     shot.open_interest = mean;
     std::string label = main_ticker + '|' + hedge_ticker;
     snprintf(shot.ticker, sizeof(shot.ticker), "%s", label.c_str());
@@ -460,7 +473,7 @@ void Strategy::Resume() {
 
 bool Strategy::Ready() {
   int num_sample = sample_tail - sample_head;
-  if (position_ready && shot_map[main_ticker].IsGood() && shot_map[hedge_ticker].IsGood() && num_sample >= min_train_sample) {
+  if (position_ready && main_slot->shot->IsGood() && hedge_slot->shot->IsGood() && num_sample >= min_train_sample) {
     if (num_sample == min_train_sample) {
       // first cal params
       CalParams();
@@ -474,13 +487,14 @@ bool Strategy::Ready() {
 }
 
 void Strategy::ModerateOrders(const std::string & ticker) {
+  ScopedProfile prof(prof_moderate_orders);
   // just make sure the order filled
-  if (mode == "real") {
+  if (mode == "real" || mode == "sim") {
     for (auto m:order_map) {
       Order* o = m.second;
       if (o->Valid()) {
         std::string ticker = o->ticker;
-        MarketSnapshot shot = shot_map[ticker];
+        const MarketSnapshot & shot = Shot(ticker);
         double reasonable_price = (o->side == OrderSide::Buy ? shot.asks[0] : shot.bids[0]);
         bool is_price_move = (fabs(reasonable_price - o->price) >= min_price_move/2);
         if (!is_price_move) {
@@ -537,7 +551,7 @@ void Strategy::UpdateBound(OrderSide::Enum side) {
       stop_loss_up_line += increment/2;
     }
   }
-  printf("spread is %lf %lf min_profit is %lf, next open will be %lf mean is %lf\n", shot_map[main_ticker].asks[0]-shot_map[main_ticker].bids[0], shot_map[hedge_ticker].asks[0]-shot_map[hedge_ticker].bids[0], min_profit, side == OrderSide::Sell ? down_diff: up_diff, mean);
+  printf("spread is %lf %lf min_profit is %lf, next open will be %lf mean is %lf\n", main_slot->shot->asks[0]-main_slot->shot->bids[0], hedge_slot->shot->asks[0]-hedge_slot->shot->bids[0], min_profit, side == OrderSide::Sell ? down_diff: up_diff, mean);
 }
 
 void Strategy::HandleTestOrder(Order* o) {
@@ -556,7 +570,6 @@ void Strategy::HandleTestOrder(Order* o) {
   snprintf(info.reason, sizeof(info.reason), "%s", "test");
   // position_map[o->ticker] += o->side == OrderSide::Buy ? o->size : -o->size;
   exchange_file->write(reinterpret_cast<char*>(&info), sizeof(info));
-  exchange_file->flush();
   info.Show(stdout);
   UpdatePos(o, info);
   // order_map.clear();
@@ -570,35 +583,49 @@ void Strategy::UpdateBuildPosTime() {
   int hedge_pos = position_map[hedge_ticker];
   if (hedge_pos == 0) {  // closed all position, reinitialize build_position_time
     build_position_time = MAX_UNIX_TIME;
+    timers.Cancel(holding_timer);
+    holding_timer = 0;
   } else if (hedge_pos == 1) {  // position 0->1, record build_time
     build_position_time = m_tc->TimevalInt(last_shot.time);
+    // fires on the clock even when the pair stops ticking, TimeUp in CloseLogic
+    // stays as the retry while the position is still open; build_position_time is
+    // seconds of the day, the wheel runs on epoch time
+    timers.Cancel(holding_timer);
+    holding_timer = 0;
+    if (holding_deadline && TimersDriven()) {
+      holding_timer = timers.At(TimerNs(last_shot.time) + static_cast<int64_t>(max_holding_sec) * 1000000000LL, [this]() {
+        HoldingTimeUp();
+      });
+    }
   }
 }
 
+bool Strategy::UsesTimers() const {
+  return holding_deadline;
+}
+
+void Strategy::HoldingTimeUp() {
+  holding_timer = 0;
+  if (position_map[main_ticker] == 0 || (ss != StrategyStatus::Running && ss != StrategyStatus::Flatting)) {
+    return;
+  }
+  printf("[%s %s] holding deadline, start from %ld, max_hold is %d close diff is %lf force to close position!\n", main_ticker.c_str(), hedge_ticker.c_str(), build_position_time, max_holding_sec, GetPairMid());
+  ForceFlat();
+}
+
 void Strategy::RecordPnl(Order* o, bool force_flat) {
   int pos = o->size;
   OrderSide::Enum pos_side = o->side == OrderSide::Sell ? OrderSide::Buy: OrderSide::Sell;
   OrderSide::Enum close_side = o->side;
-  double hedge_price = pos > 0 ? shot_map[hedge_ticker].asks[0] : shot_map[hedge_ticker].bids[0];
+  double hedge_price = pos > 0 ? hedge_slot->shot->asks[0] : hedge_slot->shot->bids[0];
   // cout << "main pnl param:" << main_ticker <<" " <<  avgcost_map[main_ticker]<< " " <<  abs(pos) << " " << o->price << " " << abs(pos) << endl;
   // cout << "hedge pnl param:" << hedge_ticker <<" " <<  avgcost_map[hedge_ticker]<< " " <<  abs(pos) << " " << hedge_price << " " << abs(pos) << endl;
   double this_round_pnl = m_cw->CalNetPnl(main_ticker, avgcost_map[main_ticker], abs(pos), o->price, abs(pos), close_side, no_close_today) + m_cw->CalNetPnl(hedge_ticker, avgcost_map[hedge_ticker], abs(pos), hedge_price, abs(pos), pos_side, no_close_today);
-  /*
-  Fee main_fee = m_cal.CalFee(main_ticker, avgcost_map[main_ticker], abs(pos), shot_map[main_ticker].  bids[0], abs(pos), no_close_today);
-  Fee hedge_fee = m_cal.CalFee(hedge_ticker, avgcost_map[hedge_ticker], abs(pos), hedge_price, abs(pos), no_close_today);
+  Fee main_fee = m_cw->CalFee(main_ticker, avgcost_map[main_ticker], abs(pos), o->price, abs(pos), no_close_today);
+  Fee hedge_fee = m_cw->CalFee(hedge_ticker, avgcost_map[hedge_ticker], abs(pos), hedge_price, abs(pos), no_close_today);
   double this_round_fee = main_fee.open_fee + main_fee.close_fee + hedge_fee.open_fee + hedge_fee.close_fee;
-  */
-  std::string str = GetCon(main_ticker);
-  std::string split_c = ",";
-  char buffer[32];
-  snprintf(buffer, sizeof(buffer), "%lf", this_round_pnl);
-  str += split_c + buffer;
-  for (auto i : param_v) {
-    snprintf(buffer, sizeof(buffer), "%lf", i);
-    str += split_c + buffer;
-  }
-  str += "\n";
-  cout << "recordpnl," << str;
+  // kept in memory, the totals come from Result() instead of a recordpnl line per round
+  result.AddRound(this_round_pnl, this_round_fee, main_slot->shot->time.tv_sec);
   /*
   printf("%ld [%s %s]%sThis round close pnl: %lf, fee_cost: %lf pos is %d, holding second is %ld, param is ", shot_map[hedge_ticker].time.tv_sec, main_ticker.c_str(), hedge_ticker.c_str(), force_flat ? "[Time up] " : "", this_round_pnl, this_round_fee, pos, shot_map[hedge_ticker].time.tv_sec - build_position_time);
   for (auto i : param_v) {
@@ -635,6 +662,29 @@ void Strategy::DoOperationAfterFilled(Order* o, const ExchangeInfo& info) {
   }
 }
 
+double Strategy::TotalPnl() const {
+  return result.pnl;
+}
+
+int Strategy::Rounds() const {
+  return result.rounds;
+}
+
+int Strategy::Position() const {
+  auto it = position_map.find(main_ticker);
+  return it == position_map.end() ? 0 : it->second;
+}
+
+BacktestResult Strategy::Result() const {
+  BacktestResult r = result;
+  r.position = Position();
+  return r;
+}
+
+void Strategy::SetResultLabel(const std::string & params) {
+  result.params = params;
+}
+
 bool Strategy::Spread_Good() {
   return (current_spread > spread_threshold) ? false : true;
 }
@@ -13,7 +13,12 @@
 #include <util/history_worker.h>
 #include <util/contract_worker.h>
 #include <util/common_tools.h>
+#include <util/backtest_result.hpp>
+#include <util/profiler.hpp>
+#include <util/rolling_stats.hpp>
 #include <core/base_strategy.h>
+#include <core/instrument_slots.hpp>
+#include <core/timer_wheel.hpp>
 #include <libconfig.h++>
 #include <unordered_map>
 
@@ -23,20 +28,28 @@
 #include <iostream>
 #include <memory>
 
-class Strategy : public BaseStrategy {
+class Strategy : public BaseStrategy, public TimerOwner {
  public:
-  explicit Strategy(const libconfig::Setting & param_setting, std::unordered_map<std::string, std::vector<BaseStrategy*> >*ticker_strat_map, ZmqSender<MarketSnapshot>* uisender, ZmqSender<Order>* ordersender, TimeController* tc, ContractWorker* cw, const std::string & date, const std::string & mode = "real", std::ofstream* exchange_file = nullptr);
+  explicit Strategy(const libconfig::Setting & param_setting, std::unordered_map<std::string, std::vector<BaseStrategy*> >*ticker_strat_map, BaseSender<MarketSnapshot>* uisender, BaseSender<Order>* ordersender, TimeController* tc, ContractWorker* cw, const std::string & date, const std::string & mode = "real", std::ofstream* exchange_file = nullptr);
   ~Strategy();
 
   void Start() override;
   void Stop() override;
+  bool UsesTimers() const override;
 
   // void Clear() override;
   void HandleCommand(const Command& shot) override;
   // void UpdateTicker() override;
+
+  // realized results of the run, collected without parsing the logs
+  double TotalPnl() const;
+  int Rounds() const;
+  int Position() const;
+  BacktestResult Result() const;
+  void SetResultLabel(const std::string & params);
  private:
   bool FillStratConfig(const libconfig::Setting& param_setting);
-  void RunningSetup(std::unordered_map<std::string, std::vector<BaseStrategy*> >*ticker_strat_map, ZmqSender<MarketSnapshot>* uisender, ZmqSender<Order>* ordersender, const std::string & mode);
+  void RunningSetup(std::unordered_map<std::string, std::vector<BaseStrategy*> >*ticker_strat_map, BaseSender<MarketSnapshot>* uisender, BaseSender<Order>* ordersender, const std::string & mode);
   void ClearPositionRecord();
   void DoOperationAfterUpdateData(const MarketSnapshot& shot) override;
   void DoOperationAfterUpdatePos(Order* o, const ExchangeInfo& info) override;
@@ -53,6 +66,7 @@ class Strategy : public BaseStrategy {
   void Flatting() override;
 
   void UpdateBuildPosTime();
+  void HoldingTimeUp();
 
   double OrderPrice(const std::string & contract, OrderSide::Enum side, bool control_price) override;
 
@@ -67,7 +81,8 @@ class Strategy : public BaseStrategy {
   void RecordPnl(Order* o, bool force_flat = false);
 
   void CalParams();
-  std::tuple<double, double> CalMeanStd(const std::vector<double> & v, int head, int num);
+  const MarketSnapshot & Shot(const std::string & ticker);
+  const MarketSnapshot & NextShot(const std::string & ticker);
   bool HitMean();
 
   double GetPairMid();
@@ -90,12 +105,15 @@ class Strategy : public BaseStrategy {
 
   // std::unordered_map<std::string, std::vector<BaseStrategy*> >*tsm;
   int cancel_limit;
-  std::unordered_map<std::string, double> mid_map;
+  // main_ticker and hedge_ticker, resolved once in RunningSetup
+  InstrumentSlots slots;
+  InstrumentSlot* main_slot;
+  InstrumentSlot* hedge_slot;
   double up_diff;
   double down_diff;
   double range_width;
   double mean;
-  std::vector<double> map_vector;
+  RollingStats map_stats;  // the last min_train_sample aligned mids
   int current_pos;
   double min_profit;
   int min_train_sample;
@@ -103,6 +121,10 @@ class Strategy : public BaseStrategy {
   double increment;
   std::string mode;
   std::string date;
+  ProfilePoint* prof_update_data;
+  ProfilePoint* prof_run;
+  ProfilePoint* prof_moderate_orders;
+  ProfilePoint* prof_cal_params;
   double spread_threshold;
   int closed_size;
   double last_valid_mid;
@@ -124,6 +146,11 @@ class Strategy : public BaseStrategy {
   int sample_head;
   int sample_tail;
   std::ofstream* exchange_file;
+  BacktestResult result;
+  // holding_deadline = true force flats on a timer max_holding_sec after the position
+  // was built, even while the pair is quiet; off, TimeUp in CloseLogic alone does it
+  bool holding_deadline;
+  TimerId holding_timer;
 };
 
 #endif  // SRC_BACKTEST_STRATEGY_H_
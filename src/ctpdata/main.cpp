@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <util/zmq_sender.hpp>
 #include <util/shm_worker.hpp>
+#include <util/thread_config.hpp>
 #include <sys/time.h>
 #include <unordered_map>
 #include <struct/market_snapshot.h>
@@ -58,6 +59,8 @@ class Listener : public CThostFtdcMdSpi {
 
   virtual void OnFrontConnected() {
     printf("on front connected\n");
+    // the api calls every callback from this thread
+    ThreadConfig::Instance().Apply("md_callback");
     SendLogin();
   }
 
@@ -245,6 +248,7 @@ class Listener : public CThostFtdcMdSpi {
 };
 
 int main() {
+  ThreadConfig::Instance().Load(GetDefaultPath() + "/hft/config/prod/prod.config");
   CThostFtdcMdApi* user_api = CThostFtdcMdApi::CreateFtdcMdApi();
 
   Listener listener(
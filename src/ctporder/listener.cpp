@@ -9,6 +9,7 @@
 #include <string>
 #include <vector>
 
+#include "util/thread_config.hpp"
 #include "./message_sender.h"
 #include "./listener.h"
 
@@ -63,6 +64,8 @@ void Listener::OnRspError(CThostFtdcRspInfoField *info, int request_id, bool is_
 
 void Listener::OnFrontConnected() {
   printf("enter onfrontconnected\n");
+  // the api calls every callback from this thread
+  ThreadConfig::Instance().Apply("trade_callback");
   // message_sender_->Auth();
   message_sender_->SendLogin();
 }
@@ -121,7 +124,7 @@ void Listener::OnRspOrderInsert(CThostFtdcInputOrderField* order,
                                 CThostFtdcRspInfoField* info,
                                 int request_id,
                                 bool is_last) {
-  printf("on errinsert for %s\n", order->OrderRef);
+  LOG_INFO("on errinsert for %s\n", order->OrderRef);
   if (CheckError("OnRspOrderInsert", info, order->OrderRef)) {
     ExchangeInfo exchangeinfo;
     gettimeofday(&exchangeinfo.show_time, NULL);
@@ -133,14 +136,14 @@ void Listener::OnRspOrderInsert(CThostFtdcInputOrderField* order,
     snprintf(exchangeinfo.ticker, sizeof(exchangeinfo.ticker), "%s", o.ticker);
     snprintf(exchangeinfo.order_ref, sizeof(exchangeinfo.order_ref), "%s", o.order_ref);
     std::string orderref = t_m->GetOrderRef(ctp_order_ref);
-    printf("sent Rej for %s %d back\n", orderref.c_str(), ctp_order_ref);
+    LOG_INFO("sent Rej for %s %d back\n", orderref.c_str(), ctp_order_ref);
     if (orderref == "-1") {
-      printf("ctporderref %d not found\n", ctp_order_ref);
+      LOG_WARN("ctporderref %d not found\n", ctp_order_ref);
       return;
     }
     t_m->HandleCancelled(o);
     SendExchangeInfo(exchangeinfo);
-    exchangeinfo.Show(stdout);
+    LOG_SHOW(LOG_INFO_LEVEL, exchangeinfo);
     /*
     HandleOrder(OrderUpdateReason::Rejected,
                 OrderStatus::Rejected,
@@ -154,9 +157,9 @@ void Listener::OnRspOrderInsert(CThostFtdcInputOrderField* order,
 
 void Listener::OnErrRtnOrderInsert(CThostFtdcInputOrderField* order,
                                    CThostFtdcRspInfoField *info) {
-  printf("on errrtnorderinsert for %s\n", order->OrderRef);
+  LOG_INFO("on errrtnorderinsert for %s\n", order->OrderRef);
   if (!CheckError("OnErrRtnOrderInsert", info, order->OrderRef)) {
-    printf("Got unexpected OnErrRtnOrderInsert");
+    LOG_WARN("Got unexpected OnErrRtnOrderInsert");
   }
 }
 
@@ -170,7 +173,7 @@ void Listener::OnRspOrderAction(CThostFtdcInputOrderActionField* order_action,
                                 int request_id,
                                 bool is_last) {
   // ErrorID = 26 is a failed cancel
-  printf("on errrtnorderaction for %s\n", order_action->OrderRef);
+  LOG_INFO("on errrtnorderaction for %s\n", order_action->OrderRef);
   if (info->ErrorID == 26) {
     // HandleFailedCancel();
     // TODO(nick): handle error
@@ -178,7 +181,7 @@ void Listener::OnRspOrderAction(CThostFtdcInputOrderActionField* order_action,
   }
 
   if (!CheckError("OnRspOrderAction", info, order_action->OrderRef)) {
-    printf("Got unexpected OnRspOrderAction %s", order_action->OrderRef);
+    LOG_WARN("Got unexpected OnRspOrderAction %s", order_action->OrderRef);
   } else {
     int ctp_order_ref = atoi(order_action->OrderRef);
     Order o = t_m->GetOrder(ctp_order_ref);
@@ -194,7 +197,7 @@ void Listener::OnRspOrderAction(CThostFtdcInputOrderActionField* order_action,
 void Listener::OnErrRtnOrderAction(CThostFtdcOrderActionField* order,
                                    CThostFtdcRspInfoField *info) {
   // Cancel after fill
-  printf("on errrtnorderaction for %s\n", order->OrderRef);
+  LOG_INFO("on errrtnorderaction for %s\n", order->OrderRef);
   if (info && info->ErrorID == 91) {
     // HandleFailedCancel();
     // TODO(nick): handle error
@@ -209,9 +212,9 @@ void Listener::OnErrRtnOrderAction(CThostFtdcOrderActionField* order,
 
 void Listener::OnRtnOrder(CThostFtdcOrderField* order) {
   if (front_id_ != order->FrontID || session_id_ != order->SessionID) {
-    printf("[WARNING] got other client's order: %s %.2f %d %s, don't handle\n",
+    LOG_WARN("[WARNING] got other client's order: %s %.2f %d %s, don't handle\n",
         order->InstrumentID, order->LimitPrice, order->VolumeTotalOriginal, order->OrderRef);
-    printf("front_id %d %d session_id %d %d\n", front_id_, order->FrontID, session_id_, order->SessionID);
+    LOG_INFO("front_id %d %d session_id %d %d\n", front_id_, order->FrontID, session_id_, order->SessionID);
     return;
   }
 
@@ -221,13 +224,13 @@ void Listener::OnRtnOrder(CThostFtdcOrderField* order) {
   int ctp_order_ref = atoi(order->OrderRef);
   Order o = t_m->GetOrder(ctp_order_ref);
   exchangeinfo.side = o.side;
-  printf("received onRtnOrder for %d\n", ctp_order_ref);
+  LOG_INFO("received onRtnOrder for %d\n", ctp_order_ref);
   std::string orderref = t_m->GetOrderRef(ctp_order_ref);
   if (orderref == "-1") {
-    printf("ctporderref %d not found\n", ctp_order_ref);
+    LOG_WARN("ctporderref %d not found\n", ctp_order_ref);
     return;
   }
-  printf("map it into %s\n", orderref.c_str());
+  LOG_INFO("map it into %s\n", orderref.c_str());
   snprintf(exchangeinfo.order_ref, sizeof(exchangeinfo.order_ref), "%s", orderref.c_str());
   snprintf(exchangeinfo.ticker, sizeof(exchangeinfo.ticker), "%s", o.ticker);
   switch (order->OrderSubmitStatus) {
@@ -269,7 +272,7 @@ void Listener::OnRtnOrder(CThostFtdcOrderField* order) {
       exchangeinfo.type = InfoType::Cancelled;
       t_m->HandleCancelled(o);
     } else {
-      printf("InsertRejected %s %c\n",
+      LOG_INFO("InsertRejected %s %c\n",
         order->OrderRef,
         order->OrderStatus);
       exchangeinfo.type = InfoType::Rej;
@@ -277,26 +280,26 @@ void Listener::OnRtnOrder(CThostFtdcOrderField* order) {
     }
     break;
   case THOST_FTDC_OSS_CancelRejected:
-    printf("CancelRejected %s",
+    LOG_INFO("CancelRejected %s",
       order->OrderRef);
     exchangeinfo.type = InfoType::CancelRej;
     return;
   }
 
   if (exchangeinfo.type == InfoType::Unknown) {
-    printf("OnRtnOrder did not set type!\n");
+    LOG_INFO("OnRtnOrder did not set type!\n");
     return;
   }
 
   SendExchangeInfo(exchangeinfo);
   if (e_s) {
-    exchangeinfo.Show(stdout);
+    LOG_SHOW(LOG_INFO_LEVEL, exchangeinfo);
   }
   if (e_f) {
     exchangeinfo.Show(exchange_file);
   }
 
-  printf("OrderUpdate Id:%s %c %c VolTraded:%d VolTot:%d\n",
+  LOG_INFO("OrderUpdate Id:%s %c %c VolTraded:%d VolTot:%d\n",
     order->OrderRef,
     order->OrderStatus,
     order->OrderSubmitStatus,
@@ -313,7 +316,7 @@ void Listener::OnRtnTrade(CThostFtdcTradeField* trade) {
     side = OrderSide::Sell;
   } else {
     side = OrderSide::Buy;
-    printf("Unexpected OrderSide!");
+    LOG_WARN("Unexpected OrderSide!");
     return;
   }
   */
@@ -325,7 +328,7 @@ void Listener::OnRtnTrade(CThostFtdcTradeField* trade) {
   Order o = t_m->GetOrder(ctp_order_ref);
   exchangeinfo.side = o.side;
   if (orderref == "-1") {
-    printf("trade ctporderref %d not found\n", ctp_order_ref);
+    LOG_WARN("trade ctporderref %d not found\n", ctp_order_ref);
     return;
   }
 
@@ -336,17 +339,17 @@ void Listener::OnRtnTrade(CThostFtdcTradeField* trade) {
   exchangeinfo.side = o.side;
   exchangeinfo.trade_price = trade->Price;
   exchangeinfo.trade_size = trade->Volume;
-  printf("received onRtnTrade for %d, and map it into %s\n", ctp_order_ref, orderref.c_str());
+  LOG_INFO("received onRtnTrade for %d, and map it into %s\n", ctp_order_ref, orderref.c_str());
 
   if (e_s) {
-    exchangeinfo.Show(stdout);
+    LOG_SHOW(LOG_INFO_LEVEL, exchangeinfo);
   }
   if (e_f) {
     exchangeinfo.Show(exchange_file);
   }
   SendExchangeInfo(exchangeinfo);
 
-  printf("Order %s executed %d at %lf\n",
+  LOG_INFO("Order %s executed %d at %lf\n",
     trade->OrderRef,
     trade->Volume,
     trade->Price);
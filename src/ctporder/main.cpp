@@ -12,6 +12,7 @@
 #include "util/contract_worker.h"
 #include "util/zmq_recver.hpp"
 #include "util/zmq_sender.hpp"
+#include "util/thread_config.hpp"
 #include "./message_sender.h"
 #include "./listener.h"
 #include "./token_manager.h"
@@ -37,6 +38,7 @@ std::unordered_map<std::string, std::string> RegisterExchange() {
 }
 
 void* RunOrderCommandListener(void *param) {
+  ThreadConfig::Instance().Apply("order_listener");
   MessageSender* message_sender = reinterpret_cast<MessageSender*>(param);
   auto r = new ZmqRecver<Order>("order_recver");
   std::shared_ptr<ZmqSender<Order> > sender(new ZmqSender<Order>("*:33335", "bind", "tcp"));
@@ -45,14 +47,14 @@ void* RunOrderCommandListener(void *param) {
     r->Recv(o);
     sender.get()->Send(o);
     if (enable_stdout) {
-      o.Show(stdout);
+      LOG_SHOW(LOG_INFO_LEVEL, o);
     }
     if (enable_file) {
       o.Show(order_file);
     }
     // check order's correct
     if (!message_sender->Handle(o)) {
-      printf("Handle Order %s failed!\n", o.order_ref);
+      LOG_WARN("Handle Order %s failed!\n", o.order_ref);
       // handle error
     }
   }
@@ -89,6 +91,8 @@ int main() {
                                exchange_map);
 
   std::string default_path = GetDefaultPath();
+  ThreadConfig::Instance().Load(default_path + "/hft/config/prod/prod.config");
+  AsyncLog::Instance().Load(default_path + "/hft/config/prod/prod.config");
   std::string contract_config_path = default_path + "/hft/config/contract/bk_contract.config";
   ContractWorker cw(contract_config_path);
   Listener listener("exchange_info",
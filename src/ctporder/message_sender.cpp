@@ -116,7 +116,7 @@ void MessageSender::SendQueryInvestorPosition() {
 
 bool MessageSender::Handle(const Order & order) {
   if (strcmp(order.exchange, "simulate") == 0) {
-    printf("messagesender recived simulated order\n");
+    LOG_INFO("messagesender recived simulated order\n");
     return false;
   }
   if (order.action == OrderAction::NewOrder) {
@@ -131,7 +131,7 @@ bool MessageSender::Handle(const Order & order) {
     return true;
   }
   if (order.action == OrderAction::QueryPos) {
-    order.Show(stdout);
+    LOG_SHOW(LOG_INFO_LEVEL, order);
     SendQueryInvestorPosition();
     return true;
   }
@@ -140,7 +140,10 @@ bool MessageSender::Handle(const Order & order) {
 }
 
 bool MessageSender::NewOrder(const Order& order) {
-  t_m->RegisterOrderRef(order);
+  // an order without a ctp ref could never be cancelled or matched to its fills
+  if (!t_m->RegisterOrderRef(order)) {
+    return false;
+  }
   CThostFtdcInputOrderField req;
   memset(&req, 0, sizeof(req));
 
@@ -150,13 +153,13 @@ bool MessageSender::NewOrder(const Order& order) {
   strncpy(req.InstrumentID, order.ticker, sizeof(req.InstrumentID));
   std::string con = GetCon(order.ticker);
   if (exchange_map.find(con) == exchange_map.end()) {
-    printf("%s %s not found exchange", con.c_str(), order.ticker);
+    LOG_WARN("%s %s not found exchange", con.c_str(), order.ticker);
     PrintMap(exchange_map);
     return false;
   }
 
   strncpy(req.ExchangeID, exchange_map[con].c_str(), sizeof(req.InstrumentID));
-  printf("order %s exchangeid is %s\n", order.order_ref, exchange_map[con].c_str());
+  LOG_INFO("order %s exchangeid is %s\n", order.order_ref, exchange_map[con].c_str());
 
   snprintf(req.OrderRef, sizeof(req.OrderRef), "%d", t_m->GetCtpId(order));
 
@@ -209,11 +212,11 @@ bool MessageSender::NewOrder(const Order& order) {
   req.IsAutoSuspend = 0;
 
   CloseType t = t_m->CheckOffset(order);
-  printf("%d %d %d\n", t.yes_size, t.tod_size, t.open_size);
+  LOG_INFO("%d %d %d\n", t.yes_size, t.tod_size, t.open_size);
 
   /*
   if (t.NeedSplit()) {
-    printf("%s need split handle, but current handler dont support it!, %d %d %d\n", order.order_ref, t.yes_size, t.tod_size, t.open_size);
+    LOG_INFO("%s need split handle, but current handler dont support it!, %d %d %d\n", order.order_ref, t.yes_size, t.tod_size, t.open_size);
     t_m->Restore(order);
     return false;
   }
@@ -239,7 +242,7 @@ bool MessageSender::NewOrder(const Order& order) {
   }
   int result = user_api_->ReqOrderInsert(&req, ++request_id_);
 
-  printf("SubmitNew %s %s %d@%lf %s %c\n",
+  LOG_INFO("SubmitNew %s %s %d@%lf %s %c\n",
     OrderSide::ToString(order.side),
     order.ticker,
     order.size,
@@ -266,13 +269,13 @@ void MessageSender::CancelOrder(const Order& order) {
 
   std::string con = GetCon(order.ticker);
   if (exchange_map.find(con) == exchange_map.end()) {
-    printf("cancel %s %s not found exchange", con.c_str(), order.ticker);
+    LOG_WARN("cancel %s %s not found exchange", con.c_str(), order.ticker);
     PrintMap(exchange_map);
     return;
   }
 
   strncpy(req.ExchangeID, exchange_map[con].c_str(), sizeof(req.InstrumentID));
-  printf("cancel order %s exchangeid is %s\n", order.order_ref, exchange_map[con].c_str());
+  LOG_INFO("cancel order %s exchangeid is %s\n", order.order_ref, exchange_map[con].c_str());
 
   req.FrontID = front_id_;
   req.SessionID = session_id_;
@@ -280,5 +283,5 @@ void MessageSender::CancelOrder(const Order& order) {
 
   user_api_->ReqOrderAction(&req, ++request_id_);
 
-  printf("SubmitCancel %s ticker %s\n", o.order_ref, o.ticker);
+  LOG_INFO("SubmitCancel %s ticker %s\n", o.order_ref, o.ticker);
 }
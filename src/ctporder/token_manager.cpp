@@ -1,24 +1,13 @@
 #include "ctporder/token_manager.h"
 #include <string>
 
-TokenManager::TokenManager()
-    : ctp_id(0) {
+TokenManager::TokenManager(int capacity)
+    : orders(capacity),
+      ctp_ids(ORDER_REF_MAX_STRATEGIES),
+      ctp_id(0),
+      ctp_base(0) {
   pthread_mutex_init(&token_mutex, NULL);
-}
-
-OrderRefStruct TokenManager::SplitOrderRef(std::string orderref) {
-  // TODO(nick): check the format
-  int num_pos = -1;
-  for (unsigned int i = 0; i < orderref.size(); i++) {
-    if (isdigit(orderref[i])) {
-      num_pos = i;
-      break;
-    }
-  }
-  OrderRefStruct os;
-  os.strat_name = orderref.substr(0, num_pos);
-  os.ref_num = atoi(orderref.substr(num_pos, orderref.size()-num_pos).c_str());
-  return os;
+  pthread_mutex_init(&ref_mutex, NULL);
 }
 
 void TokenManager::Init() {
@@ -26,16 +15,39 @@ void TokenManager::Init() {
   sell_token.clear();
   yes_buy_token.clear();
   yes_sell_token.clear();
-  order_id_map.clear();
-  ctpid_order_map.clear();
-  is_close.clear();
-  is_yes_close.clear();
-  ref_close.clear();
+  pthread_mutex_lock(&ref_mutex);
+  orders.Clear();
+  for (auto & ids : ctp_ids) {
+    ids.clear();
+  }
+  // ctp refs keep growing over the session
+  ctp_base = ctp_id;
+  pthread_mutex_unlock(&ref_mutex);
+}
+
+CtpOrder* TokenManager::Slot(int ctp_order_ref) {
+  return ctp_order_ref < 0 ? nullptr : orders.Get(ctp_order_ref - ctp_base);
+}
+
+int TokenManager::CtpIdLocked(const Order & o) {
+  OrderRef r;
+  if (!codec.Parse(o.order_ref, &r)) {
+    return -1;
+  }
+  if (r.seq < static_cast<long long>(ctp_ids[r.strategy].size())) {
+    return ctp_ids[r.strategy][r.seq];
+  }
+  return -1;
 }
 
 void TokenManager::Restore(Order order) {
-  int ctporderref = GetCtpId(order);
-  CloseType t = ref_close[ctporderref];
+  pthread_mutex_lock(&ref_mutex);
+  CtpOrder* slot = Slot(CtpIdLocked(order));
+  CloseType t = slot ? slot->close : CloseType();
+  pthread_mutex_unlock(&ref_mutex);
+  if (!slot) {
+    LOG_WARN("ctporderref not found for %s\n", order.order_ref);
+  }
   if (order.side == OrderSide::Buy) {
     pthread_mutex_lock(&token_mutex);
     yes_buy_token[order.ticker] += t.yes_size;
@@ -69,51 +81,80 @@ void TokenManager::RegisterYesToken(std::string ticker, int num, OrderSide::Enum
   }
 }
 
-void TokenManager::RegisterOrderRef(Order o) {
-  OrderRefStruct os = SplitOrderRef(o.order_ref);
-  if (os.ref_num == 0) {
-    // order_id_map.clear();
-    for (std::unordered_map<std::string, int>::iterator it = order_id_map.begin(); it != order_id_map.end(); it++) {
-      OrderRefStruct temp = SplitOrderRef(it->first);
-      if (temp.strat_name == os.strat_name) {
-        order_id_map.erase(it);
-      }
-    }
+bool TokenManager::RegisterOrderRef(Order o) {
+  OrderRef r;
+  // the codec learns new strategy names while parsing, so it is shared state too
+  pthread_mutex_lock(&ref_mutex);
+  if (!codec.Parse(o.order_ref, &r)) {
+    pthread_mutex_unlock(&ref_mutex);
+    LOG_WARN("bad order ref %s\n", o.order_ref);
+    return false;
+  }
+  int h = orders.Alloc();
+  if (h < 0) {
+    pthread_mutex_unlock(&ref_mutex);
+    LOG_ERROR("ORDER POOL FULL: more than %d orders this session, %s not registered, not sent! raise the TokenManager capacity\n", orders.Capacity(), o.order_ref);
+    return false;
+  }
+  orders.Get(h)->order = o;
+  std::vector<int> & ids = ctp_ids[r.strategy];
+  if (r.seq < 0 || r.seq >= orders.Capacity() * 16LL) {
+    orders.Free(h);
+    pthread_mutex_unlock(&ref_mutex);
+    LOG_ERROR("order ref %s out of range, not sent!\n", o.order_ref);
+    return false;
+  }
+  if (ids.capacity() == 0) {
+    ids.reserve(orders.Capacity());
+  }
+  // a restarted strategy counts from 0 again, its old refs are gone
+  if (r.seq == 0) {
+    ids.clear();
+  }
+  if (r.seq >= static_cast<long long>(ids.size())) {
+    ids.resize(r.seq + 1, -1);
   }
-  ctpid_order_map[ctp_id] = o;
-  order_id_map[o.order_ref] = ctp_id++;
+  // handles come out in order, so this is the running ctp id
+  ids[r.seq] = ctp_base + h;
+  ctp_id = ctp_base + h + 1;
+  pthread_mutex_unlock(&ref_mutex);
+  return true;
 }
 
 int TokenManager::GetCtpId(Order o) {
-  std::unordered_map<std::string, int>::iterator it = order_id_map.find(o.order_ref);
-  if (it == order_id_map.end()) {
-    printf("ctporderref not found for %s\n", o.order_ref);
-    return -1;
+  pthread_mutex_lock(&ref_mutex);
+  int id = CtpIdLocked(o);
+  pthread_mutex_unlock(&ref_mutex);
+  if (id < 0) {
+    LOG_WARN("ctporderref not found for %s\n", o.order_ref);
   }
-  return it->second;
+  return id;
 }
 
 std::string TokenManager::GetOrderRef(int ctp_id) {
-  for (std::unordered_map<std::string, int>::iterator it = order_id_map.begin(); it != order_id_map.end(); it++) {
-    if (it->second == ctp_id) {
-      return it->first;
-    }
+  pthread_mutex_lock(&ref_mutex);
+  CtpOrder* slot = Slot(ctp_id);
+  std::string ref = slot ? slot->order.order_ref : "-1";
+  pthread_mutex_unlock(&ref_mutex);
+  if (!slot) {
+    LOG_WARN("ctpref %d not found!\n", ctp_id);
   }
-  printf("ctpref %d not found!\n", ctp_id);
-  return "-1";
+  return ref;
 }
 
 Order TokenManager::GetOrder(int ctp_order_ref) {
-  std::unordered_map<int, Order>::iterator it = ctpid_order_map.find(ctp_order_ref);
-  if (it == ctpid_order_map.end()) {
-    printf("order not found for ctpref %d\n", ctp_order_ref);
+  pthread_mutex_lock(&ref_mutex);
+  CtpOrder* slot = Slot(ctp_order_ref);
+  Order o = slot ? slot->order : Order();
+  pthread_mutex_unlock(&ref_mutex);
+  if (!slot) {
+    LOG_WARN("order not found for ctpref %d\n", ctp_order_ref);
   }
-  return it->second;
+  return o;
 }
 
 CloseType TokenManager::CheckOffset(Order order) {
-  printf("check offset for order %s: size is %d, side is %s, and token is: buy %d, sell %d, yesbuy %d, yessell %d\n", order.order_ref, order.size, OrderSide::ToString(order.side), buy_token[order.ticker], sell_token[order.ticker], yes_buy_token[order.ticker], yes_sell_token[order.ticker]);
-  int ctp_order_ref = GetCtpId(order);
+  LOG_INFO("check offset for order %s: size is %d, side is %s, and token is: buy %d, sell %d, yesbuy %d, yessell %d\n", order.order_ref, order.size, OrderSide::ToString(order.side), buy_token[order.ticker], sell_token[order.ticker], yes_buy_token[order.ticker], yes_sell_token[order.ticker]);
   int pos;
   int yes_pos;
   CloseType t;
@@ -124,18 +165,16 @@ CloseType TokenManager::CheckOffset(Order order) {
     pos = sell_token[order.ticker];
     yes_pos = yes_sell_token[order.ticker];
   } else {
-    printf("token unknown side!\n");
+    LOG_WARN("token unknown side!\n");
     exit(1);
   }
 
   if (order.size <= yes_pos) {  // just close_yesterday
     t.yes_size = order.size;
-    is_yes_close[ctp_order_ref] = true;
     t.OffsetFlag = THOST_FTDC_OF_CloseYesterday;
   } else {
     if (order.size <= pos) {  // close today
       t.tod_size = order.size;
-      is_close[ctp_order_ref] = true;
       t.OffsetFlag = THOST_FTDC_OF_CloseToday;
     } else {  // open
       t.open_size = order.size;
@@ -153,23 +192,40 @@ CloseType TokenManager::CheckOffset(Order order) {
     sell_token[order.ticker] -= t.tod_size;
     pthread_mutex_unlock(&token_mutex);
   }
-  ref_close[ctp_order_ref] = t;
-  printf("todsize is %d, yessize is %d, opensize is %d\n", t.tod_size, t.yes_size, t.open_size);
+  pthread_mutex_lock(&ref_mutex);
+  CtpOrder* slot = Slot(CtpIdLocked(order));
+  if (slot) {
+    slot->is_yes_close = t.yes_size > 0;
+    slot->is_close = t.tod_size > 0;
+    slot->close = t;
+  }
+  pthread_mutex_unlock(&ref_mutex);
+  if (!slot) {
+    LOG_WARN("ctporderref not found for %s\n", order.order_ref);
+  }
+  LOG_INFO("todsize is %d, yessize is %d, opensize is %d\n", t.tod_size, t.yes_size, t.open_size);
   return t;
 }
 
 void TokenManager::HandleFilled(Order o) {
-  int ctp_order_ref = GetCtpId(o);
-  printf("tokenmanager handling filled order %s, isclose is %d\n", o.order_ref, is_close[ctp_order_ref]);
-  if (o.side == OrderSide::Buy && !is_close[ctp_order_ref] && !is_yes_close[ctp_order_ref]) {
+  pthread_mutex_lock(&ref_mutex);
+  CtpOrder* slot = Slot(CtpIdLocked(o));
+  bool is_close = slot && slot->is_close;
+  bool is_yes_close = slot && slot->is_yes_close;
+  pthread_mutex_unlock(&ref_mutex);
+  if (!slot) {
+    LOG_WARN("ctporderref not found for %s\n", o.order_ref);
+  }
+  LOG_INFO("tokenmanager handling filled order %s, isclose is %d\n", o.order_ref, is_close);
+  if (o.side == OrderSide::Buy && !is_close && !is_yes_close) {
     pthread_mutex_lock(&token_mutex);
     sell_token[o.ticker] += o.size;
-    printf("sell token added for %s, now is %d\n", o.ticker, sell_token[o.ticker]);
+    LOG_INFO("sell token added for %s, now is %d\n", o.ticker, sell_token[o.ticker]);
     pthread_mutex_unlock(&token_mutex);
-  } else if (o.side == OrderSide::Sell && !is_close[ctp_order_ref] && !is_yes_close[ctp_order_ref]) {
+  } else if (o.side == OrderSide::Sell && !is_close && !is_yes_close) {
     pthread_mutex_lock(&token_mutex);
     buy_token[o.ticker] += o.size;
-    printf("buy token added for %s, now is %d\n", o.ticker, buy_token[o.ticker]);
+    LOG_INFO("buy token added for %s, now is %d\n", o.ticker, buy_token[o.ticker]);
     pthread_mutex_unlock(&token_mutex);
   } else {
     // printf("unknown side!listener 251\n");
@@ -177,30 +233,37 @@ void TokenManager::HandleFilled(Order o) {
 }
 
 void TokenManager::HandleCancelled(Order o) {
-  int ctp_order_ref = GetCtpId(o);
-  printf("tokenmanager handling cancelled order %s, isclose is %d\n", o.order_ref, is_close[ctp_order_ref]);
+  pthread_mutex_lock(&ref_mutex);
+  CtpOrder* slot = Slot(CtpIdLocked(o));
+  bool is_close = slot && slot->is_close;
+  bool is_yes_close = slot && slot->is_yes_close;
+  pthread_mutex_unlock(&ref_mutex);
+  if (!slot) {
+    LOG_WARN("ctporderref not found for %s\n", o.order_ref);
+  }
+  LOG_INFO("tokenmanager handling cancelled order %s, isclose is %d\n", o.order_ref, is_close);
   if (o.side == OrderSide::Buy) {
-    if (is_close[ctp_order_ref]) {
+    if (is_close) {
       pthread_mutex_lock(&token_mutex);
       buy_token[o.ticker] += o.size;
-      printf("cancel buy token added for %s, now is %d\n", o.ticker, buy_token[o.ticker]);
+      LOG_INFO("cancel buy token added for %s, now is %d\n", o.ticker, buy_token[o.ticker]);
       pthread_mutex_unlock(&token_mutex);
-    } else if (is_yes_close[ctp_order_ref]) {
+    } else if (is_yes_close) {
       pthread_mutex_lock(&token_mutex);
       yes_buy_token[o.ticker] += o.size;
-      printf("cancel yesbuy token added for %s, now is %d\n", o.ticker, yes_buy_token[o.ticker]);
+      LOG_INFO("cancel yesbuy token added for %s, now is %d\n", o.ticker, yes_buy_token[o.ticker]);
       pthread_mutex_unlock(&token_mutex);
     }
   } else if (o.side == OrderSide::Sell) {
-    if (is_close[ctp_order_ref]) {
+    if (is_close) {
       pthread_mutex_lock(&token_mutex);
       sell_token[o.ticker] += o.size;
-      printf("cancel sell token added for %s, now is %d\n", o.ticker, sell_token[o.ticker]);
+      LOG_INFO("cancel sell token added for %s, now is %d\n", o.ticker, sell_token[o.ticker]);
       pthread_mutex_unlock(&token_mutex);
-    } else if (is_yes_close[ctp_order_ref]) {
+    } else if (is_yes_close) {
       pthread_mutex_lock(&token_mutex);
       yes_sell_token[o.ticker] += o.size;
-      printf("cancel yessell token added for %s, now is %d\n", o.ticker, yes_sell_token[o.ticker]);
+      LOG_INFO("cancel yessell token added for %s, now is %d\n", o.ticker, yes_sell_token[o.ticker]);
       pthread_mutex_unlock(&token_mutex);
     }
   } else {
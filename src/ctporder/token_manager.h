@@ -6,15 +6,18 @@
 #include <stdlib.h>
 #include <ThostFtdcUserApiDataType.h>
 #include <util/common_tools.h>
+#include <util/order_pool.hpp>
+#include <util/async_log.hpp>
 
 #include <unordered_map>
 #include <string>
-#include <cctype>
+#include <vector>
 
-struct OrderRefStruct {
-  std::string strat_name;
-  int ref_num;
-};
+// orders of a session, the ctp order ref of the slot is ctp_base + its handle; the
+// pool is allocated up front and never grows, an order past the capacity is not
+// registered (logged as an error) and not sent: pass a larger capacity to
+// TokenManager for busier sessions
+#define CTP_ORDER_CAPACITY (1 << 16)
 
 struct CloseType {
   int yes_size;
@@ -45,17 +48,28 @@ struct CloseType {
   }
 };
 
+// what the gateway knows about one order it sent to ctp
+struct CtpOrder {
+  Order order;
+  bool is_close;
+  bool is_yes_close;
+  CloseType close;
+  CtpOrder()
+    : is_close(false),
+      is_yes_close(false) {
+  }
+};
+
 class TokenManager {
  public:
-  TokenManager();
-
-  OrderRefStruct SplitOrderRef(std::string orderref);
+  explicit TokenManager(int capacity = CTP_ORDER_CAPACITY);
 
   void Init();
 
   void RegisterToken(std::string contract, int num, OrderSide::Enum side);
   void RegisterYesToken(std::string contract, int num, OrderSide::Enum side);
-  void RegisterOrderRef(Order o);
+  // false when the order can not be tracked, it must not go to ctp then
+  bool RegisterOrderRef(Order o);
 
   int GetCtpId(Order o);
 
@@ -76,13 +90,22 @@ class TokenManager {
   std::unordered_map<std::string, int> sell_token;
   std::unordered_map<std::string, int> yes_buy_token;
   std::unordered_map<std::string, int> yes_sell_token;
-  std::unordered_map<std::string, int> order_id_map;
-  std::unordered_map<int, Order> ctpid_order_map;
-  std::unordered_map<int, bool> is_close;
-  std::unordered_map<int, bool> is_yes_close;
-  std::unordered_map<int, CloseType> ref_close;
+  // both need ref_mutex held
+  int CtpIdLocked(const Order & o);
+  CtpOrder* Slot(int ctp_id);
+  // the strategies' refs are parsed once into (strategy, seq), the ctp order ref of each
+  // is found by indexing, no string is hashed or formatted per order
+  OrderRefCodec codec;
+  // codec, orders, ctp_ids, ctp_id and ctp_base are shared by the order listener and
+  // the ctp callback threads, only touched under ref_mutex
+  OrderPool<CtpOrder> orders;
+  // [strategy][seq], -1 for none; a strategy's refs get room for a full pool on its
+  // first order, so registering does not allocate after that
+  std::vector<std::vector<int> > ctp_ids;
   pthread_mutex_t token_mutex;
+  pthread_mutex_t ref_mutex;
   int ctp_id;
+  int ctp_base;
 };
 
 #endif  // SRC_CTPORDER_TOKEN_MANAGER_H_
@@ -1,6 +1,15 @@
+#include <stdlib.h>
 #include <zmq.hpp>
 
+#include <string>
+
+#include "util/thread_config.hpp"
+
 int main() {
+    const char* home = getenv("HOME");
+    ThreadConfig::Instance().Load(std::string(home ? home : ".") + "/hft/config/prod/prod.config");
+    // the proxy loop runs here, zmq's io thread is its own
+    ThreadConfig::Instance().Apply("data_proxy");
     zmq::context_t context(1);
     zmq::socket_t sub(context, ZMQ_XSUB);
     sub.bind("ipc://data_sender");
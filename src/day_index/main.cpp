@@ -0,0 +1,61 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "util/day_index.hpp"
+
+void Usage(const char* name) {
+  printf("usage: %s [-j threads] [-t] data_file [data_file ...]\n", name);
+  printf("  -t  print the per ticker table\n");
+}
+
+// nightly: day_index /today/data_binary.dat.gz, writes data_binary.dat.gz.idx
+// exits 1 when any file has nothing complete to replay, 2 when any file is not clean
+int main(int argc, char** argv) {
+  int thread_num = 0;
+  bool show_tickers = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "j:th")) != -1) {
+    switch (opt) {
+     case 'j':
+      thread_num = atoi(optarg);
+      break;
+     case 't':
+      show_tickers = true;
+      break;
+     default:
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (optind >= argc) {
+    Usage(argv[0]);
+    return 1;
+  }
+  int ret = 0;
+  for (int i = optind; i < argc; i++) {
+    DayIndex index(argv[i]);
+    if (!index.Build(thread_num) || !index.Save()) {
+      printf("index failed for %s\n", argv[i]);
+      ret = 1;
+      continue;
+    }
+    printf("%s: %lld records, %zu tickers, %zu blocks, %s -> %s\n", argv[i], index.Records(), index.Get().size(),
+           index.Blocks().size(), index.Problem().c_str(), DayIndex::IndexPath(argv[i]).c_str());
+    if (show_tickers) {
+      for (auto & t : index.Get()) {
+        printf("  %-12s %10lld %ld.%06ld %ld.%06ld %lld\n", t.first.c_str(), t.second.count,
+               t.second.first_time.tv_sec, t.second.first_time.tv_usec,
+               t.second.last_time.tv_sec, t.second.last_time.tv_usec, t.second.disorder);
+      }
+    }
+    if (!index.Usable()) {
+      ret = 1;
+    } else if (!index.Clean() && ret == 0) {
+      ret = 2;
+    }
+  }
+  return ret;
+}
@@ -0,0 +1,24 @@
+#include <stdio.h>
+
+#include <string>
+
+#include "util/day_summary.hpp"
+
+// nightly: day_summary /today/data_binary.dat.gz, rebuilds the sidecar next to each file
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    printf("usage: %s data_file [data_file ...]\n", argv[0]);
+    return 1;
+  }
+  int failed = 0;
+  for (int i = 1; i < argc; i++) {
+    DaySummary ds(argv[i]);
+    if (!ds.Build() || !ds.Save()) {
+      printf("summary failed for %s\n", argv[i]);
+      failed++;
+      continue;
+    }
+    printf("%s: %zu tickers -> %s\n", argv[i], ds.Get().size(), DaySummary::SummaryPath(argv[i]).c_str());
+  }
+  return failed == 0 ? 0 : 1;
+}
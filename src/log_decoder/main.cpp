@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <unordered_map>
+
+#include "util/async_log.hpp"
+
+void Usage(const char* name) {
+  printf("usage: %s [-v] [-l level] file\n", name);
+  printf("  -v  prefix every line with its time, level and call site\n");
+  printf("  -l  show this level and above: 0 debug, 1 info, 2 warn, 3 error\n");
+}
+
+bool ReadString(FILE* f, std::string* s) {
+  uint32_t n = 0;
+  if (fread(&n, sizeof(n), 1, f) != 1) {
+    return false;
+  }
+  s->resize(n);
+  return n == 0 || fread(&(*s)[0], 1, n, f) == n;
+}
+
+const char* LevelName(int level) {
+  switch (level) {
+   case LOG_DEBUG_LEVEL:
+    return "DEBUG";
+   case LOG_INFO_LEVEL:
+    return "INFO";
+   case LOG_WARN_LEVEL:
+    return "WARN";
+   case LOG_ERROR_LEVEL:
+    return "ERROR";
+   default:
+    return "?";
+  }
+}
+
+// log_decoder trade.log turns a binary AsyncLog file back into the text it would have printed
+int main(int argc, char** argv) {
+  bool verbose = false;
+  int min_level = LOG_DEBUG_LEVEL;
+  int opt;
+  while ((opt = getopt(argc, argv, "vl:h")) != -1) {
+    switch (opt) {
+     case 'v':
+      verbose = true;
+      break;
+     case 'l':
+      min_level = atoi(optarg);
+      break;
+     default:
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (optind >= argc) {
+    Usage(argv[0]);
+    return 1;
+  }
+  FILE* f = fopen(argv[optind], "rb");
+  if (!f) {
+    printf("open %s failed!\n", argv[optind]);
+    return 1;
+  }
+  char magic[sizeof(LOG_MAGIC)] = {0};
+  if (fread(magic, 1, strlen(LOG_MAGIC), f) != strlen(LOG_MAGIC) || strcmp(magic, LOG_MAGIC) != 0) {
+    printf("%s is not a binary log\n", argv[optind]);
+    return 1;
+  }
+  std::unordered_map<uint32_t, LogSite> sites;
+  std::string payload;
+  std::string text;
+  int type;
+  while ((type = fgetc(f)) != EOF) {
+    if (type == 'D') {
+      int32_t v[3];
+      LogSite s;
+      if (fread(v, sizeof(v), 1, f) != 1 || !ReadString(f, &s.file) || !ReadString(f, &s.fmt) || !ReadString(f, &s.types) || !ReadString(f, &s.object)) {
+        break;
+      }
+      s.id = v[0];
+      s.level = v[1];
+      s.line = v[2];
+      sites[s.id] = s;
+      continue;
+    }
+    if (type != 'R') {
+      printf("bad frame %d, stop\n", type);
+      return 1;
+    }
+    uint32_t id = 0;
+    int64_t ns = 0;
+    if (fread(&id, sizeof(id), 1, f) != 1 || fread(&ns, sizeof(ns), 1, f) != 1 || !ReadString(f, &payload)) {
+      break;
+    }
+    auto it = sites.find(id);
+    if (it == sites.end()) {
+      printf("record of unknown site %u\n", id);
+      continue;
+    }
+    const LogSite & s = it->second;
+    if (s.level < min_level) {
+      continue;
+    }
+    if (verbose) {
+      time_t sec = ns / 1000000000LL;
+      struct tm t;
+      localtime_r(&sec, &t);
+      char stamp[32];
+      strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &t);
+      printf("%s.%09lld %-5s %s:%d ", stamp, static_cast<long long>(ns % 1000000000LL), LevelName(s.level), s.file.c_str(), s.line);
+    }
+    if (!s.object.empty()) {
+      if (!ShowLogObject(s.object, payload.data(), payload.size(), stdout)) {
+        printf("%s of %zu bytes, not known to this build\n", s.object.c_str(), payload.size());
+      }
+      continue;
+    }
+    text.clear();
+    LogFormat(s, payload.data(), payload.size(), &text);
+    fputs(text.c_str(), stdout);
+  }
+  fclose(f);
+  return 0;
+}
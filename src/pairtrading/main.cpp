@@ -33,6 +33,14 @@ int main() {
   libconfig::Config param_cfg;
   std::string config_path = default_path + "/hft/config/prod/prod.config";
   param_cfg.readFile(config_path.c_str());
+  // timings are printed on the "profile" command
+  Profiler::Instance().Enable(param_cfg.exists("profile") && static_cast<bool>(param_cfg.lookup("profile")));
+  if (param_cfg.exists("threads")) {
+    ThreadConfig::Instance().Load(param_cfg.lookup("threads"));
+  }
+  if (param_cfg.exists("log")) {
+    AsyncLog::Instance().Load(param_cfg.lookup("log"));
+  }
 
   std::string time_config_path = default_path + "/hft/config/prod/time.config";
   TimeController tc(time_config_path);
@@ -51,7 +59,20 @@ int main() {
     s->Print();
   }
 
-  StrategyContainer<ZmqRecver> sc(ticker_strat_map);
+  // strategies on their own pinned threads, one per strategy unless workers is set
+  int shards = 0;
+  std::vector<int> cpus;
+  if (param_cfg.exists("shards")) {
+    const libconfig::Setting & shard_setting = param_cfg.lookup("shards");
+    shards = shard_setting.exists("workers") ? static_cast<int>(shard_setting["workers"]) : strategies.getLength();
+    if (shard_setting.exists("cpus")) {
+      const libconfig::Setting & cpu_setting = shard_setting["cpus"];
+      for (int i = 0; i < cpu_setting.getLength(); i++) {
+        cpus.push_back(cpu_setting[i]);
+      }
+    }
+  }
+  StrategyContainer<ZmqRecver> sc(ticker_strat_map, shards, cpus);
   sc.Start();
   HandleLeft();
   PrintResult();
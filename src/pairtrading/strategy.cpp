@@ -16,9 +16,17 @@ Strategy::Strategy(const libconfig::Setting & param_setting, std::unordered_map<
     exchange_file(exchange_file) {
   m_tc = tc;
   m_cw = cw;
+  main_slot = nullptr;
+  hedge_slot = nullptr;
   if (FillStratConfig(param_setting)) {
     RunningSetup(ticker_strat_map, uisender, ordersender);
   }
+  Profiler & profiler = Profiler::Instance();
+  profiler.SetOwner(this, m_strat_name);
+  prof_update_data = profiler.Point(m_strat_name, "DoOperationAfterUpdateData");
+  prof_run = profiler.Point(m_strat_name, "Run");
+  prof_moderate_orders = profiler.Point(m_strat_name, "ModerateOrders");
+  prof_cal_params = profiler.Point(m_strat_name, "CalParams");
 }
 
 Strategy::~Strategy() {
@@ -35,6 +43,10 @@ void Strategy::RunningSetup(std::unordered_map<std::string, std::vector<BaseStra
   shot_map[hedge_ticker] = shot;
   avgcost_map[main_ticker] = 0.0;
   avgcost_map[hedge_ticker] = 0.0;
+  main_slot = slots.Get(slots.Add(main_ticker, &shot_map, &next_shot_map));
+  hedge_slot = slots.Get(slots.Add(hedge_ticker, &shot_map, &next_shot_map));
+  long_.Reset(train_samples_);
+  short_.Reset(train_samples_);
 }
 
 bool Strategy::FillStratConfig(const libconfig::Setting& param_setting) {
@@ -91,13 +103,13 @@ void Strategy::Stop() {
 }
 
 bool Strategy::IsAlign() {
-  return shot_map[main_ticker].time.tv_sec == shot_map[hedge_ticker].time.tv_sec && abs(shot_map[main_ticker].time.tv_usec-shot_map[hedge_ticker].time.tv_usec) < 100000;
+  return main_slot->shot->time.tv_sec == hedge_slot->shot->time.tv_sec && abs(main_slot->shot->time.tv_usec-hedge_slot->shot->time.tv_usec) < 100000;
 }
 
 
 void Strategy::DoOperationAfterCancelled(Order* o) {
   if (cancel_map[o->ticker] > cancel_limit) {
-    printf("ticker %s hit cancel limit!\n", o->ticker);
+    LOG_WARN("ticker %s hit cancel limit!\n", o->ticker);
     Stop();
   }
 }
@@ -106,17 +118,27 @@ double Strategy::OrderPrice(const std::string & ticker, OrderSide::Enum side, bo
   return 0.0;
 }
 
+// slots for the own tickers, the map for anything else
+const MarketSnapshot & Strategy::Shot(const std::string & ticker) {
+  InstrumentSlot* slot = slots.Find(ticker);
+  return slot ? *slot->shot : shot_map[ticker];
+}
+
+const MarketSnapshot & Strategy::NextShot(const std::string & ticker) {
+  InstrumentSlot* slot = slots.Find(ticker);
+  return slot ? *slot->next_shot : next_shot_map[ticker];
+}
+
 void Strategy::CalParams() {
+  ScopedProfile prof(prof_cal_params);
   if (sample_tail < train_samples_) {
-    printf("no enough data\n");
+    LOG_INFO("no enough data\n");
     exit(1);
   }
-  auto long_params = CalMeanStd(long_, sample_tail - train_samples_, train_samples_);
-  auto short_params = CalMeanStd(short_, sample_tail - train_samples_, train_samples_);
-  double long_mean = std::get<0>(long_params);
-  double long_std = std::get<1>(long_params);
-  double short_mean = std::get<0>(short_params);
-  double short_std = std::get<1>(short_params);
+  double long_mean = long_.Mean();
+  double long_std = long_.Std();
+  double short_mean = short_.Mean();
+  double short_std = short_.Std();
   FeePoint main_point = m_cw->CalFeePoint(main_ticker, GetMid(main_ticker), 1, GetMid(main_ticker), 1, no_close_today);
   FeePoint hedge_point = m_cw->CalFeePoint(hedge_ticker, GetMid(hedge_ticker), 1, GetMid(hedge_ticker), 1, no_close_today);
   double round_fee_cost = main_point.open_fee_point + main_point.close_fee_point + hedge_point.open_fee_point + hedge_point.close_fee_point;
@@ -140,7 +162,7 @@ void Strategy::ForceFlat() {
       break;
     }
     if (i == max_close_try - 1) {
-      printf("[%s %s]try max_close times, cant close this order!\n", main_ticker.c_str(), hedge_ticker.c_str());
+      LOG_WARN("[%s %s]try max_close times, cant close this order!\n", main_ticker.c_str(), hedge_ticker.c_str());
       PrintMap(order_map);
       order_map.clear();  // it's a temp solution, TODO
       Close(side);
@@ -150,14 +172,14 @@ void Strategy::ForceFlat() {
 
 bool Strategy::Close(OrderSide::Enum side) {
   if (!order_map.empty()) {
-    printf("[%s %s]block order exsited! no close\n", main_ticker.c_str(), hedge_ticker.c_str());
+    LOG_WARN("[%s %s]block order exsited! no close\n", main_ticker.c_str(), hedge_ticker.c_str());
     PrintMap(order_map);
     return false;
   }
-  double price = (side == OrderSide::Buy) ? shot_map[main_ticker].asks[0] : shot_map[main_ticker].bids[0];
+  double price = (side == OrderSide::Buy) ? main_slot->shot->asks[0] : main_slot->shot->bids[0];
   int64_t size = (side == OrderSide::Buy) ? 1 : -1;
   Order* o = PlaceOrder(main_ticker, price, size, no_close_today, "close");
-  o->Show(stdout);
+  LOG_SHOW(LOG_INFO_LEVEL, *o);
   return true;
 }
 
@@ -166,8 +188,8 @@ void Strategy::CloseLogic() {
   if (pos == 0) {
     return;
   }
-  double long_back = long_.back();
-  double short_back = short_.back();
+  double long_back = long_.Back();
+  double short_back = short_.Back();
   if (pos > 0 && short_back > short_mean_) {  // buy pos, sell to close
     Close(OrderSide::Sell);
   }
@@ -184,20 +206,20 @@ void Strategy::Flatting() {
 
 void Strategy::Open(OrderSide::Enum side) {
   if (!order_map.empty()) {
-    printf("block order exsited! no open \n");
+    LOG_WARN("block order exsited! no open \n");
     PrintMap(order_map);
     return;
   }
-  double price = (side == OrderSide::Buy) ? shot_map[main_ticker].asks[0] : shot_map[main_ticker].bids[0];
+  double price = (side == OrderSide::Buy) ? main_slot->shot->asks[0] : main_slot->shot->bids[0];
   int64_t size = (side == OrderSide::Buy) ? 1 : -1;
   Order* o = PlaceOrder(main_ticker, price, size, no_close_today, "open");
-  target_hedge_price = (side == OrderSide::Buy) ? shot_map[hedge_ticker].bids[0] : shot_map[hedge_ticker].asks[0];
-  o->Show(stdout);
+  target_hedge_price = (side == OrderSide::Buy) ? hedge_slot->shot->bids[0] : hedge_slot->shot->asks[0];
+  LOG_SHOW(LOG_INFO_LEVEL, *o);
 }
 
 bool Strategy::OpenLogic() {
-  double long_back = long_.back();
-  double short_back = short_.back();
+  double long_back = long_.Back();
+  double short_back = short_.Back();
   if (abs(position_map[main_ticker]) >= max_pos || (long_back > short_down_ && short_back < long_up_)) {
   return false;
   }
@@ -211,6 +233,7 @@ bool Strategy::RiskCheck() {
 }
 
 void Strategy::Run() {
+  ScopedProfile prof(prof_run);
   if (RiskCheck()) {
     if (!OpenLogic()) {
       CloseLogic();
@@ -225,11 +248,12 @@ void Strategy::Init() {
 }
 
 void Strategy::DoOperationAfterUpdateData(const MarketSnapshot& shot) {
-  double long_price = shot_map[main_ticker].asks[0] - shot_map[hedge_ticker].bids[0];
-  double short_price = shot_map[main_ticker].bids[0] - shot_map[hedge_ticker].asks[0];
-  long_.push_back(long_price);
-  short_.push_back(short_price);
-  current_spread = shot_map[main_ticker].asks[0] - shot_map[main_ticker].bids[0] + shot_map[hedge_ticker].asks[0] - shot_map[hedge_ticker].bids[0];
+  ScopedProfile prof(prof_update_data);
+  double long_price = main_slot->shot->asks[0] - hedge_slot->shot->bids[0];
+  double short_price = main_slot->shot->bids[0] - hedge_slot->shot->asks[0];
+  long_.Push(long_price);
+  short_.Push(short_price);
+  current_spread = main_slot->shot->asks[0] - main_slot->shot->bids[0] + hedge_slot->shot->asks[0] - hedge_slot->shot->bids[0];
 }
 
 void Strategy::Resume() {
@@ -241,6 +265,7 @@ bool Strategy::Ready() {
 }
 
 void Strategy::ModerateOrders(const std::string & ticker) {
+  ScopedProfile prof(prof_moderate_orders);
   if (mode_ != StrategyMode::Real) {
     return;
   }
@@ -249,7 +274,7 @@ void Strategy::ModerateOrders(const std::string & ticker) {
     if (!o->Valid()) {
       continue;
     }
-    MarketSnapshot shot = shot_map[o->ticker];
+    const MarketSnapshot & shot = Shot(o->ticker);
     double reasonable_price = (o->side == OrderSide::Buy ? shot.asks[0] : shot.bids[0]);
     bool is_price_move = (fabs(reasonable_price - o->price) >= min_price_move/2);
     if (!is_price_move) {
@@ -279,11 +304,11 @@ void Strategy::DoOperationAfterFilled(Order* o, const ExchangeInfo& info) {
   std::string tbd = o->tbd;
   bool is_close = (tbd.find("close") == string::npos);
   if (strcmp(info.ticker, main_ticker.c_str()) == 0) {
-    double price = (info.side == OrderSide::Buy) ? shot_map[hedge_ticker].bids[0] : shot_map[hedge_ticker].asks[0];
+    double price = (info.side == OrderSide::Buy) ? hedge_slot->shot->bids[0] : hedge_slot->shot->asks[0];
     int64_t size = (info.side == OrderSide::Buy) ? -1 : 1;
     string orderinfo = is_close ? "close" : "open";
     Order* o = PlaceOrder(hedge_ticker, price, size, no_close_today, orderinfo);
-    o->Show(stdout);
+    LOG_SHOW(LOG_INFO_LEVEL, *o);
   } else if (strcmp(info.ticker, hedge_ticker.c_str()) == 0) {
   } else {
   }
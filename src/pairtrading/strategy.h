@@ -14,6 +14,10 @@
 #include "util/zmq_sender.hpp"
 #include "util/history_worker.h"
 #include "util/contract_worker.h"
+#include "util/profiler.hpp"
+#include "util/async_log.hpp"
+#include "util/rolling_stats.hpp"
+#include "core/instrument_slots.hpp"
 #include "util/common_tools.h"
 #include "util/dater.h"
 
@@ -66,6 +70,8 @@ class Strategy : public BaseStrategy {
   void RecordPnl(Order* o, bool force_flat = false);
 
   void CalParams();
+  const MarketSnapshot & Shot(const std::string & ticker);
+  const MarketSnapshot & NextShot(const std::string & ticker);
 
   void ForceFlat() override;
 
@@ -82,7 +88,10 @@ class Strategy : public BaseStrategy {
 
   // std::unordered_map<std::string, std::vector<BaseStrategy*> >*tsm;
   int cancel_limit;
-  std::unordered_map<std::string, double> mid_map;
+  // main_ticker and hedge_ticker, resolved once in RunningSetup
+  InstrumentSlots slots;
+  InstrumentSlot* main_slot;
+  InstrumentSlot* hedge_slot;
   double up_diff;
   double down_diff;
   double range_width;
@@ -94,6 +103,10 @@ class Strategy : public BaseStrategy {
   double min_range;
   double increment;
   std::string date;
+  ProfilePoint* prof_update_data;
+  ProfilePoint* prof_run;
+  ProfilePoint* prof_moderate_orders;
+  ProfilePoint* prof_cal_params;
   double spread_threshold;
   int closed_size;
   double last_valid_mid;
@@ -115,8 +128,9 @@ class Strategy : public BaseStrategy {
   int sample_head;
   int sample_tail;
   std::ofstream* exchange_file;
-  std::vector<double> long_;
-  std::vector<double> short_;
+  // the last train_samples_ long and short spreads
+  RollingStats long_;
+  RollingStats short_;
   double long_up_;
   double long_down_;
   double long_mean_;
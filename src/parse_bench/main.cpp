@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "struct/market_snapshot.h"
+#include "util/common_tools.h"
+#include "util/shot_parser.hpp"
+#include "util/shot_reader.hpp"
+
+// compares the current text ingestion (HandleSnapshot, Split + atof) with shot_parser
+// usage: parse_bench [data_file.dat(.gz)] [max_shots]
+// without a data file random shots are generated
+
+std::vector<MarketSnapshot> LoadShots(int argc, char** argv) {
+  size_t max_shots = argc > 2 ? atol(argv[2]) : 200000;
+  std::vector<MarketSnapshot> shots(max_shots);
+  if (argc > 1) {
+    ShotReader<MarketSnapshot> reader(argv[1]);
+    if (!reader.Good()) {
+      printf("open %s failed!\n", argv[1]);
+      exit(1);
+    }
+    shots.resize(reader.Read(shots.data(), max_shots));
+    return shots;
+  }
+  srand(42);
+  for (size_t i = 0; i < shots.size(); i++) {
+    MarketSnapshot & shot = shots[i];
+    shot = MarketSnapshot();
+    snprintf(shot.ticker, sizeof(shot.ticker), "%s%d", i % 2 ? "ni" : "zn", 1801 + static_cast<int>(i % 6));
+    double mid = 10000 + rand() % 5000;
+    for (int j = 0; j < MARKET_DATA_DEPTH; j++) {
+      shot.bids[j] = mid - 5 * (j + 1);
+      shot.asks[j] = mid + 5 * (j + 1);
+      shot.bid_sizes[j] = rand() % 500 + 1;
+      shot.ask_sizes[j] = rand() % 500 + 1;
+    }
+    shot.last_trade = mid + 5;
+    shot.last_trade_size = rand() % 100;
+    shot.volume = static_cast<int>(i * 3);
+    shot.turnover = shot.volume * mid * 5.0;
+    shot.open_interest = 150000 + rand() % 1000;
+    shot.is_trade_update = (i % 5 == 0);
+    shot.time.tv_sec = 1514768400 + static_cast<long>(i / 2);
+    shot.time.tv_usec = (i % 2) * 500000;
+    shot.is_initialized = true;
+  }
+  return shots;
+}
+
+std::string ToLog(const MarketSnapshot & shot) {
+  char* buf = nullptr;
+  size_t len = 0;
+  FILE* f = open_memstream(&buf, &len);
+  shot.Show(f);
+  fclose(f);
+  std::string s(buf, len);
+  free(buf);
+  return s;
+}
+
+MarketSnapshot SplitCsv(const std::string & line) {
+  std::vector<std::string> v = Split(line, ",");
+  MarketSnapshot shot;
+  snprintf(shot.ticker, sizeof(shot.ticker), "%s", v[0].c_str());
+  for (int i = 0; i < MARKET_DATA_DEPTH; i++) {
+    shot.bids[i] = atof(v[1 + i].c_str());
+    shot.asks[i] = atof(v[6 + i].c_str());
+    shot.bid_sizes[i] = atoi(v[11 + i].c_str());
+    shot.ask_sizes[i] = atoi(v[16 + i].c_str());
+  }
+  shot.last_trade = atof(v[21].c_str());
+  shot.last_trade_size = atoi(v[22].c_str());
+  shot.volume = atoi(v[23].c_str());
+  shot.turnover = atof(v[24].c_str());
+  shot.open_interest = atof(v[25].c_str());
+  shot.is_trade_update = atoi(v[26].c_str());
+  double t = atof(v[27].c_str());
+  shot.time.tv_sec = static_cast<long>(t);
+  shot.time.tv_usec = static_cast<long>((t - shot.time.tv_sec) * 1000000 + 0.5);
+  shot.is_initialized = atoi(v[28].c_str());
+  return shot;
+}
+
+bool SameShot(const MarketSnapshot & a, const MarketSnapshot & b) {
+  if (strcmp(a.ticker, b.ticker) != 0 || a.volume != b.volume || a.last_trade_size != b.last_trade_size
+      || a.is_trade_update != b.is_trade_update || a.time.tv_sec != b.time.tv_sec) {
+    return false;
+  }
+  for (int i = 0; i < MARKET_DATA_DEPTH; i++) {
+    if (!DoubleEqual(a.bids[i], b.bids[i]) || !DoubleEqual(a.asks[i], b.asks[i])
+        || a.bid_sizes[i] != b.bid_sizes[i] || a.ask_sizes[i] != b.ask_sizes[i]) {
+      return false;
+    }
+  }
+  return DoubleEqual(a.last_trade, b.last_trade);
+}
+
+template <typename F>
+double Bench(const std::vector<std::string> & lines, F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (auto & line : lines) {
+    f(line);
+  }
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  return lines.empty() ? 0 : static_cast<double>(ns) / lines.size();
+}
+
+int main(int argc, char** argv) {
+  std::vector<MarketSnapshot> shots = LoadShots(argc, argv);
+  std::vector<std::string> csv_lines;
+  std::vector<std::string> log_lines;
+  for (auto & shot : shots) {
+    csv_lines.push_back(shot.ToCsv());
+    log_lines.push_back(ToLog(shot));
+  }
+  printf("%zu shots\n", shots.size());
+
+  std::vector<MarketSnapshot> legacy(shots.size());
+  std::vector<MarketSnapshot> fast(shots.size());
+  size_t i = 0;
+  size_t bad = 0;
+  double old_log = Bench(log_lines, [&](const std::string & s) { legacy[i++] = HandleSnapshot(s); });
+  i = 0;
+  double new_log = Bench(log_lines, [&](const std::string & s) { bad += !ParseLogShot(s.data(), s.data() + s.size(), &fast[i++]); });
+  size_t diff = 0;
+  for (size_t j = 0; j < shots.size(); j++) {
+    diff += !SameShot(legacy[j], fast[j]);
+  }
+  printf("log  HandleSnapshot %8.1f ns/line, ParseLogShot %8.1f ns/line, x%.1f, %zu bad, %zu differ\n",
+         old_log, new_log, new_log > 0 ? old_log / new_log : 0, bad, diff);
+
+  i = 0;
+  bad = 0;
+  double old_csv = Bench(csv_lines, [&](const std::string & s) { legacy[i++] = SplitCsv(s); });
+  i = 0;
+  double new_csv = Bench(csv_lines, [&](const std::string & s) { bad += !ParseCsvShot(s.data(), s.data() + s.size(), &fast[i++]); });
+  diff = 0;
+  for (size_t j = 0; j < shots.size(); j++) {
+    diff += !SameShot(legacy[j], fast[j]);
+  }
+  printf("csv  Split+atof     %8.1f ns/line, ParseCsvShot %8.1f ns/line, x%.1f, %zu bad, %zu differ\n",
+         old_csv, new_csv, new_csv > 0 ? old_csv / new_csv : 0, bad, diff);
+  return 0;
+}
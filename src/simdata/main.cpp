@@ -1,6 +1,42 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
 #include "./sim_data.hpp"
 
-int main() {
-  SimData sd;
-  sd.LoadData("/home/nick/future/future2020-04-17.dat.gz");
+void Usage(const char* name) {
+  printf("usage: %s [-m mode] [-g max_gap_sec] [file ...]\n", name);
+  printf("  -m  max (default), realtime, <N>x or step\n");
+  printf("  -g  cut pauses longer than this, e.g. lunch and the night\n");
+}
+
+// simdata [file ...], several files (night session, following days) are replayed as one stream
+// simdata -m 20x -g 5 day.dat.gz rehearses a day against the live strategies in about 20 minutes
+int main(int argc, char** argv) {
+  ReplayClock clock;
+  int opt;
+  while ((opt = getopt(argc, argv, "m:g:h")) != -1) {
+    switch (opt) {
+     case 'm':
+      if (!clock.Parse(optarg)) {
+        return 1;
+      }
+      break;
+     case 'g':
+      clock.SetMaxGap(atof(optarg));
+      break;
+     default:
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  SimData sd(&clock);
+  std::vector<std::string> files(argv + optind, argv + argc);
+  if (files.empty()) {
+    files.push_back("/home/nick/future/future2020-04-17.dat.gz");
+  }
+  sd.LoadData(files);
 }
@@ -4,26 +4,32 @@
 #include <memory>
 
 #include "util/data_handler.hpp"
+#include "util/replay_clock.hpp"
 #include "util/zmq_sender.hpp"
 
 class SimData : public DataHandler<MarketSnapshot> {
  public:
-  SimData()
+  explicit SimData(ReplayClock* clock)
    : up(new ZmqSender<MarketSnapshot> ("data_sender", "connect")),
+     clock(clock),
      count(0) {
   }
 
   ~SimData() {
+    printf("sent %d shots, worst lag %lld us\n", count, clock->MaxLag());
   }
 
   void HandleShot(MarketSnapshot* this_shot, MarketSnapshot* next_shot) override {
+    clock->Wait(this_shot->time);
     up.get()->Send(*this_shot);
     if (count++ % 100000 == 1) {
       this_shot->Show(stdout);
+      printf("lag %lld us, worst %lld us\n", clock->Lag(), clock->MaxLag());
     }
   }
  private:
   std::unique_ptr<ZmqSender<MarketSnapshot> > up;
+  ReplayClock* clock;
   int count;
 };
 
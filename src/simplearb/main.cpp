@@ -7,6 +7,7 @@
 #include <util/common_tools.h>
 #include <core/base_strategy.h>
 #include <util/history_worker.h>
+#include <util/day_summary.hpp>
 #include <util/dater.h>
 #include <util/zmq_recver.hpp>
 #include <util/zmq_sender.hpp>
@@ -33,6 +34,14 @@ int main() {
   libconfig::Config param_cfg;
   std::string config_path = default_path + "/hft/config/prod/prod.config";
   param_cfg.readFile(config_path.c_str());
+  // timings are printed on the "profile" command
+  Profiler::Instance().Enable(param_cfg.exists("profile") && static_cast<bool>(param_cfg.lookup("profile")));
+  if (param_cfg.exists("threads")) {
+    ThreadConfig::Instance().Load(param_cfg.lookup("threads"));
+  }
+  if (param_cfg.exists("log")) {
+    AsyncLog::Instance().Load(param_cfg.lookup("log"));
+  }
 
   std::string time_config_path = default_path + "/hft/config/prod/time.config";
   TimeController tc(time_config_path);
@@ -43,7 +52,8 @@ int main() {
 
   std::unordered_map<std::string, std::vector<BaseStrategy*> > ticker_strat_map;
   std::string contract_config_path = default_path + "/hft/config/contract/bk_contract.config";
-  HistoryWorker hw(Dater::FindOneValid(Dater::GetCurrentDate(), -20));
+  HistoryWorker hw;
+  LoadHistory(&hw, Dater::FindOneValid(Dater::GetCurrentDate(), -20));
   ContractWorker cw(contract_config_path);
   const libconfig::Setting & strategies = param_cfg.lookup("strategy");
   for (int i = 0; i < strategies.getLength(); i++) {
@@ -52,7 +62,20 @@ int main() {
     s->Print();
   }
 
-  StrategyContainer<ZmqRecver> sc(ticker_strat_map);
+  // strategies on their own pinned threads, one per strategy unless workers is set
+  int shards = 0;
+  std::vector<int> cpus;
+  if (param_cfg.exists("shards")) {
+    const libconfig::Setting & shard_setting = param_cfg.lookup("shards");
+    shards = shard_setting.exists("workers") ? static_cast<int>(shard_setting["workers"]) : strategies.getLength();
+    if (shard_setting.exists("cpus")) {
+      const libconfig::Setting & cpu_setting = shard_setting["cpus"];
+      for (int i = 0; i < cpu_setting.getLength(); i++) {
+        cpus.push_back(cpu_setting[i]);
+      }
+    }
+  }
+  StrategyContainer<ZmqRecver> sc(ticker_strat_map, shards, cpus);
   sc.Start();
   HandleLeft();
   PrintResult();
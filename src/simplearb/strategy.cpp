@@ -2,16 +2,8 @@
 #include <string>
 #include <algorithm>
 #include <vector>
-#include <deque>
 
 #include "./strategy.h"
-void PrintDeque(const std::deque<double> & d) {
-  std::cout << "start print deque: ";
-  for (auto i : d) {
-    std::cout << i << " ";
-  }
-  std::cout << "end print" << std::endl;
-}
 
 Strategy::Strategy(const libconfig::Setting & param_setting, std::unordered_map<std::string, std::vector<BaseStrategy*> >*ticker_strat_map, ZmqSender<MarketSnapshot>* uisender, ZmqSender<Order>* ordersender, TimeController* tc, ContractWorker* cw, const std::string & date, StrategyMode::Enum mode, std::ofstream* exchange_file)
   : date(date),
@@ -23,13 +15,25 @@ Strategy::Strategy(const libconfig::Setting & param_setting, std::unordered_map<
     close_round(0),
     sample_head(0),
     sample_tail(0),
-    exchange_file(exchange_file) {
+    exchange_file(exchange_file),
+    new_high_window(8),
+    new_high_min_samples(6),
+    holding_deadline(false),
+    holding_timer(0) {
   m_tc = tc;
   m_cw = cw;
+  main_slot = nullptr;
+  hedge_slot = nullptr;
   SetStrategyMode(mode, exchange_file);
   if (FillStratConfig(param_setting)) {
     RunningSetup(ticker_strat_map, uisender, ordersender);
   }
+  Profiler & profiler = Profiler::Instance();
+  profiler.SetOwner(this, m_strat_name);
+  prof_update_data = profiler.Point(m_strat_name, "DoOperationAfterUpdateData");
+  prof_run = profiler.Point(m_strat_name, "Run");
+  prof_moderate_orders = profiler.Point(m_strat_name, "ModerateOrders");
+  prof_cal_params = profiler.Point(m_strat_name, "CalParams");
 }
 
 Strategy::~Strategy() {
@@ -46,6 +50,11 @@ void Strategy::RunningSetup(std::unordered_map<std::string, std::vector<BaseStra
   shot_map[hedge_ticker] = shot;
   avgcost_map[main_ticker] = 0.0;
   avgcost_map[hedge_ticker] = 0.0;
+  main_slot = slots.Get(slots.Add(main_ticker, &shot_map, &next_shot_map));
+  hedge_slot = slots.Get(slots.Add(hedge_ticker, &shot_map, &next_shot_map));
+  map_stats.Reset(train_samples);
+  hedge_bid_high.Reset(new_high_window);
+  hedge_ask_low.Reset(new_high_window);
 }
 
 bool Strategy::FillStratConfig(const libconfig::Setting& param_setting) {
@@ -83,6 +92,21 @@ bool Strategy::FillStratConfig(const libconfig::Setting& param_setting) {
     if (param_setting.exists("no_close_today")) {
       no_close_today = param_setting["no_close_today"];
     }
+    if (param_setting.exists("holding_deadline")) {
+      holding_deadline = param_setting["holding_deadline"];
+    }
+    if (param_setting.exists("new_high_window")) {
+      new_high_window = param_setting["new_high_window"];
+    }
+    if (param_setting.exists("new_high_min_samples")) {
+      new_high_min_samples = param_setting["new_high_min_samples"];
+    }
+    // past the window the sample count is never reached and every order is blocked,
+    // under 2 there is no prior quote to break out of
+    if (new_high_min_samples < 2 || new_high_min_samples > new_high_window) {
+      printf("%s: need 2 <= new_high_min_samples (%d) <= new_high_window (%d)\n", unique_name.c_str(), new_high_min_samples, new_high_window);
+      return false;
+    }
   } catch(const libconfig::SettingNotFoundException &nfex) {
     printf("Setting '%s' is missing", nfex.getPath());
     exit(1);
@@ -106,7 +130,7 @@ void Strategy::Stop() {
 }
 
 bool Strategy::IsAlign() {
-  if (shot_map[main_ticker].time.tv_sec == shot_map[hedge_ticker].time.tv_sec && abs(shot_map[main_ticker].time.tv_usec-shot_map[hedge_ticker].time.tv_usec) < 100000) {
+  if (main_slot->shot->time.tv_sec == hedge_slot->shot->time.tv_sec && abs(main_slot->shot->time.tv_usec-hedge_slot->shot->time.tv_usec) < 100000) {
     return true;
   }
   return false;
@@ -118,10 +142,10 @@ OrderSide::Enum Strategy::OpenLogicSide() {
   // shot_map[main_ticker].Show(stdout);
   // shot_map[hedge_ticker].Show(stdout);
   if (mid - current_spread/2 > up_diff) {
-    printf("[%s %s]sell condition hit, as diff id %f\n",  main_ticker.c_str(), hedge_ticker.c_str(), mid);
+    LOG_INFO("[%s %s]sell condition hit, as diff id %f\n",  main_ticker.c_str(), hedge_ticker.c_str(), mid);
     return OrderSide::Sell;
   } else if (mid + current_spread/2 < down_diff) {
-    printf("[%s %s]buy condition hit, as diff id %f\n", main_ticker.c_str(), hedge_ticker.c_str(), mid);
+    LOG_INFO("[%s %s]buy condition hit, as diff id %f\n", main_ticker.c_str(), hedge_ticker.c_str(), mid);
     return OrderSide::Buy;
   } else {
     return OrderSide::Unknown;
@@ -129,9 +153,9 @@ OrderSide::Enum Strategy::OpenLogicSide() {
 }
 
 void Strategy::DoOperationAfterCancelled(Order* o) {
-  printf("ticker %s cancel num %d!\n", o->ticker, cancel_map[o->ticker]);
+  LOG_INFO("ticker %s cancel num %d!\n", o->ticker, cancel_map[o->ticker]);
   if (cancel_map[o->ticker] > cancel_limit) {
-    printf("ticker %s hit cancel limit!\n", o->ticker);
+    LOG_WARN("ticker %s hit cancel limit!\n", o->ticker);
     Stop();
   }
 }
@@ -141,59 +165,48 @@ double Strategy::OrderPrice(const std::string & ticker, OrderSide::Enum side, bo
     // double slip = (side == OrderSide::Buy)? shot_map[ticker].asks[0] - next_shot_map[ticker].asks[0] : next_shot_map[ticker].bids[0] - shot_map[ticker].bids[0];
     if (ticker == hedge_ticker) {
       // printf("Slip hedge[%s] %s: %lf %lf ->> %lf %lf pnl:%lf\n", ticker.c_str(), OrderSide::ToString(side), shot_map[ticker].asks[0], shot_map[ticker].bids[0], next_shot_map[ticker].asks[0], next_shot_map[ticker].bids[0], slip);
-      return (side == OrderSide::Buy)?next_shot_map[ticker].asks[0]:next_shot_map[ticker].bids[0];
+      return (side == OrderSide::Buy)?NextShot(ticker).asks[0]:NextShot(ticker).bids[0];
     } else if (ticker == main_ticker) {
       // printf("Slip main[%s] %s: %lf %lf ->> %lf %lf pnl:%lf\n", ticker.c_str(), OrderSide::ToString(side), shot_map[ticker].asks[0], shot_map[ticker].bids[0], next_shot_map[ticker].asks[0], next_shot_map[ticker].bids[0], slip);
       // return (side == OrderSide::Buy)?next_shot_map[ticker].asks[0]:next_shot_map[ticker].bids[0];
-      return (side == OrderSide::Buy)?shot_map[ticker].asks[0]:shot_map[ticker].bids[0];
+      return (side == OrderSide::Buy)?Shot(ticker).asks[0]:Shot(ticker).bids[0];
     } else {
-      printf("error ticker %s\n", ticker.c_str());
+      LOG_ERROR("error ticker %s\n", ticker.c_str());
       return -1.0;
     }
   } else {
     if (ticker == hedge_ticker) {
-      return (side == OrderSide::Buy)?shot_map[hedge_ticker].asks[0]:shot_map[hedge_ticker].bids[0];
+      return (side == OrderSide::Buy)?hedge_slot->shot->asks[0]:hedge_slot->shot->bids[0];
     } else if (ticker == main_ticker) {
-      return (side == OrderSide::Buy)?shot_map[main_ticker].asks[0]:shot_map[main_ticker].bids[0];
+      return (side == OrderSide::Buy)?main_slot->shot->asks[0]:main_slot->shot->bids[0];
     } else {
-      printf("error ticker %s\n", ticker.c_str());
+      LOG_ERROR("error ticker %s\n", ticker.c_str());
       return -1.0;
     }
   }
 }
 
-std::tuple<double, double> Strategy::CalMeanStd(const std::vector<double> & v, int head, int num) {
-  std::vector<double> cal_v(v.begin() + head, v.begin() + head + num);
-  double mean = 0.0;
-  double std = 0.0;
-  for (auto i : cal_v) {
-    mean += i;
-  }
-  mean /= num;
-  for (auto i : cal_v) {
-    std += (i-mean) * (i-mean);
-  }
-  std /= num;
-  std = sqrt(std);
-  return std::tie(mean, std);
+// slots for the own tickers, the map for anything else
+const MarketSnapshot & Strategy::Shot(const std::string & ticker) {
+  InstrumentSlot* slot = slots.Find(ticker);
+  return slot ? *slot->shot : shot_map[ticker];
+}
+
+const MarketSnapshot & Strategy::NextShot(const std::string & ticker) {
+  InstrumentSlot* slot = slots.Find(ticker);
+  return slot ? *slot->next_shot : next_shot_map[ticker];
 }
 
 void Strategy::CalParams() {
+  ScopedProfile prof(prof_cal_params);
   // int num_sample = sample_tail - sample_head;
   if (sample_tail < train_samples) {
-    printf("[%s %s]no enough mid data! tail is %d\n", main_ticker.c_str(), hedge_ticker.c_str(), sample_tail);
+    LOG_INFO("[%s %s]no enough mid data! tail is %d\n", main_ticker.c_str(), hedge_ticker.c_str(), sample_tail);
     exit(1);
   }
   param_v.clear();
-  auto r = CalMeanStd(map_vector, sample_tail - train_samples, train_samples);
-  double avg = std::get<0>(r);
-  double std = std::get<1>(r);
-  /*
-  unsigned int head = map_vector.size() - train_samples;
-  for (int i = 0; i < split_num; ++i) {
-    param_v.push_back(std::get<0>(CalMeanStd(map_vector, head+i*train_samples/split_num, train_samples/split_num)));
-  }
-  */
+  double avg = map_stats.Mean();
+  double std = map_stats.Std();
   FeePoint main_point = m_cw->CalFeePoint(main_ticker, GetMid(main_ticker), 1, GetMid(main_ticker), 1, no_close_today);
   FeePoint hedge_point = m_cw->CalFeePoint(hedge_ticker, GetMid(hedge_ticker), 1, GetMid(hedge_ticker), 1, no_close_today);
   double round_fee_cost = main_point.open_fee_point + main_point.close_fee_point + hedge_point.open_fee_point + hedge_point.close_fee_point;
@@ -205,7 +218,7 @@ void Strategy::CalParams() {
   // down_diff = std::min(avg - range_width * std, avg-min_profit);
   mean = avg;
   spread_threshold = margin - min_profit - round_fee_cost;
-  printf("[%s %s]cal done,mean is %lf, std is %lf, parmeters: [%lf,%lf], spread_threshold is %lf, min_profit is %lf, up_loss=%lf, down_loss=%lf fee_point=%lf\n", main_ticker.c_str(), hedge_ticker.c_str(), avg, std, down_diff, up_diff, spread_threshold, min_profit, stop_loss_up_line, stop_loss_down_line, round_fee_cost);
+  LOG_INFO("[%s %s]cal done,mean is %lf, std is %lf, parmeters: [%lf,%lf], spread_threshold is %lf, min_profit is %lf, up_loss=%lf, down_loss=%lf fee_point=%lf\n", main_ticker.c_str(), hedge_ticker.c_str(), avg, std, down_diff, up_diff, spread_threshold, min_profit, stop_loss_up_line, stop_loss_down_line, round_fee_cost);
   // char buffer[1024];
   // snprintf(buffer, sizeof(buffer), "CalParams %d->%d", sample_head, sample_tail);
   // tcr.EndTimer(buffer);
@@ -216,25 +229,25 @@ bool Strategy::HitMean() {
   double this_mid = GetPairMid();
   int pos = position_map[main_ticker];
   if (pos > 0 && this_mid - current_spread/2 >= mean) {  // buy position
-    printf("[%s %s] mean is %lf, this_mid is %lf, current_spread is %lf, pos is %d\n", main_ticker.c_str(), hedge_ticker.c_str(), mean, this_mid, current_spread, pos);
+    LOG_INFO("[%s %s] mean is %lf, this_mid is %lf, current_spread is %lf, pos is %d\n", main_ticker.c_str(), hedge_ticker.c_str(), mean, this_mid, current_spread, pos);
     return true;
   } else if (pos < 0 && this_mid + current_spread/2 <= mean) {  // sell position
-    printf("[%s %s] mean is %lf, this_mid is %lf, current_spread is %lf, pos is %d\n", main_ticker.c_str(), hedge_ticker.c_str(), mean, this_mid, current_spread, pos);
+    LOG_INFO("[%s %s] mean is %lf, this_mid is %lf, current_spread is %lf, pos is %d\n", main_ticker.c_str(), hedge_ticker.c_str(), mean, this_mid, current_spread, pos);
     return true;
   }
   return false;
 }
 
 void Strategy::ForceFlat() {
-  printf("%ld [%s %s]this round hit stop_loss condition, pos:%d current_mid:%lf, current_spread:%lf stoplossline %lf-%lf forceflat\n", shot_map[hedge_ticker].time.tv_sec, main_ticker.c_str(), hedge_ticker.c_str(), position_map[main_ticker], GetPairMid(), current_spread, stop_loss_down_line, stop_loss_up_line);
-  shot_map[main_ticker].Show(stdout);
-  shot_map[hedge_ticker].Show(stdout);
+  LOG_INFO("%ld [%s %s]this round hit stop_loss condition, pos:%d current_mid:%lf, current_spread:%lf stoplossline %lf-%lf forceflat\n", hedge_slot->shot->time.tv_sec, main_ticker.c_str(), hedge_ticker.c_str(), position_map[main_ticker], GetPairMid(), current_spread, stop_loss_down_line, stop_loss_up_line);
+  LOG_SHOW(LOG_INFO_LEVEL, *main_slot->shot);
+  LOG_SHOW(LOG_INFO_LEVEL, *hedge_slot->shot);
   for (int i = 0; i < max_close_try; i++) {
     if (Close(true)) {
       break;
     }
     if (i == max_close_try - 1) {
-      printf("[%s %s]try max_close times, cant close this order!\n", main_ticker.c_str(), hedge_ticker.c_str());
+      LOG_WARN("[%s %s]try max_close times, cant close this order!\n", main_ticker.c_str(), hedge_ticker.c_str());
       PrintMap(order_map);
       order_map.clear();  // it's a temp solution, TODO
       Close();
@@ -243,13 +256,13 @@ void Strategy::ForceFlat() {
 }
 
 void Strategy::RecordSlip(const std::string & ticker, OrderSide::Enum side, bool is_close) {
-    double slip = (side == OrderSide::Buy)? shot_map[ticker].asks[0] - next_shot_map[ticker].asks[0] : next_shot_map[ticker].bids[0] - shot_map[ticker].bids[0];
+    double slip = (side == OrderSide::Buy)? Shot(ticker).asks[0] - NextShot(ticker).asks[0] : NextShot(ticker).bids[0] - Shot(ticker).bids[0];
   if (ticker == hedge_ticker) {
-    printf("Slip%s hedge[%s] %s: %lf %lf ->> %lf %lf pnl:%lf\n", is_close ? " close" : " open", ticker.c_str(), OrderSide::ToString(side), shot_map[ticker].asks[0], shot_map[ticker].bids[0], next_shot_map[ticker].asks[0], next_shot_map[ticker].bids[0], slip);
+    LOG_INFO("Slip%s hedge[%s] %s: %lf %lf ->> %lf %lf pnl:%lf\n", is_close ? " close" : " open", ticker.c_str(), OrderSide::ToString(side), Shot(ticker).asks[0], Shot(ticker).bids[0], NextShot(ticker).asks[0], NextShot(ticker).bids[0], slip);
   } else if (ticker == main_ticker) {
-    printf("Slip%s main[%s] %s: %lf %lf ->> %lf %lf pnl:%lf\n", is_close ? " close" : " open", ticker.c_str(), OrderSide::ToString(side), shot_map[ticker].asks[0], shot_map[ticker].bids[0], next_shot_map[ticker].asks[0], next_shot_map[ticker].bids[0], slip);
+    LOG_INFO("Slip%s main[%s] %s: %lf %lf ->> %lf %lf pnl:%lf\n", is_close ? " close" : " open", ticker.c_str(), OrderSide::ToString(side), Shot(ticker).asks[0], Shot(ticker).bids[0], NextShot(ticker).asks[0], NextShot(ticker).bids[0], slip);
   } else {
-    printf("error ticker %s\n", ticker.c_str());
+    LOG_ERROR("error ticker %s\n", ticker.c_str());
   }
 }
 
@@ -261,13 +274,11 @@ bool Strategy::Close(bool force_flat) {
   // OrderSide::Enum pos_side = pos > 0 ? OrderSide::Buy: OrderSide::Sell;
   OrderSide::Enum close_side = pos > 0 ? OrderSide::Sell: OrderSide::Buy;
   if (NewHigh(close_side)) {
-    printf("[%s %s]%s block orders bc new high appear!\n", main_ticker.c_str(), hedge_ticker.c_str(), OrderSide::ToString(close_side));
-    PrintDeque(hedge_ask);
-    PrintDeque(hedge_bid);
+    LOG_INFO("[%s %s]%s block orders bc new high appear! bid %lf over %lf, ask %lf under %lf, %d samples\n", main_ticker.c_str(), hedge_ticker.c_str(), OrderSide::ToString(close_side), hedge_bid_high.Newest(), hedge_bid_high.Prior(), hedge_ask_low.Newest(), hedge_ask_low.Prior(), hedge_bid_high.Size());
     return true;
   }
   // double hedge_price = pos > 0 ? shot_map[hedge_ticker].asks[0] : shot_map[hedge_ticker].bids[0];
-  printf("close using %s: pos is %d, diff is %lf\n", OrderSide::ToString(close_side), pos, GetPairMid());
+  LOG_INFO("close using %s: pos is %d, diff is %lf\n", OrderSide::ToString(close_side), pos, GetPairMid());
   PrintMap(position_map);
   // printf("spread is %lf %lf min_profit is %lf\n", shot_map[main_ticker].asks[0]-shot_map[main_ticker].bids[0], shot_map[hedge_ticker].asks[0]-shot_map[hedge_ticker].bids[0], min_profit);
   if (order_map.empty()) {
@@ -276,9 +287,9 @@ bool Strategy::Close(bool force_flat) {
     RecordSlip(main_ticker, o->side, true);
     // double slip = (o->side == OrderSide::Buy)? shot_map[main_ticker].asks[0] - next_shot_map[main_ticker].asks[0] : next_shot_map[main_ticker].bids[0] - shot_map[main_ticker].bids[0];
     // printf("Slip close main[%s] %s: %lf %lf ->> %lf %lf pnl:%lf\n", main_ticker.c_str(), OrderSide::ToString(o->side), shot_map[main_ticker].asks[0], shot_map[main_ticker].bids[0], next_shot_map[main_ticker].asks[0], next_shot_map[main_ticker].bids[0], slip);
-    o->Show(stdout);
+    LOG_SHOW(LOG_INFO_LEVEL, *o);
     HandleTestOrder(o);
-    target_hedge_price = (close_side == OrderSide::Buy) ? shot_map[hedge_ticker].bids[0] : shot_map[hedge_ticker].asks[0];
+    target_hedge_price = (close_side == OrderSide::Buy) ? hedge_slot->shot->bids[0] : hedge_slot->shot->asks[0];
     if (mode_ == StrategyMode::Real) {
       // RecordPnl(o);
       /*
@@ -291,7 +302,7 @@ bool Strategy::Close(bool force_flat) {
     }
     return true;
   } else {
-    printf("[%s %s]block order exsited! no close\n", main_ticker.c_str(), hedge_ticker.c_str());
+    LOG_WARN("[%s %s]block order exsited! no close\n", main_ticker.c_str(), hedge_ticker.c_str());
     PrintMap(order_map);
     return false;
   }
@@ -320,7 +331,7 @@ void Strategy::StopLossLogic() {
   }
   if (stop_loss_times >= max_loss_times) {
     ss = StrategyStatus::Stopped;
-    printf("stop loss times hit max!\n");
+    LOG_WARN("stop loss times hit max!\n");
   }
 }
 
@@ -332,7 +343,7 @@ void Strategy::CloseLogic() {
   }
 
   if (TimeUp()) {
-    printf("[%s %s] holding time up, start from %ld, now is %ld, max_hold is %d close diff is %lf force to close position!\n", main_ticker.c_str(), hedge_ticker.c_str(), build_position_time, mode_ != StrategyMode::Real ? shot_map[main_ticker].time.tv_sec : m_tc->CurrentInt(), max_holding_sec, GetPairMid());
+    LOG_INFO("[%s %s] holding time up, start from %ld, now is %ld, max_hold is %d close diff is %lf force to close position!\n", main_ticker.c_str(), hedge_ticker.c_str(), build_position_time, mode_ != StrategyMode::Real ? main_slot->shot->time.tv_sec : m_tc->CurrentInt(), max_holding_sec, GetPairMid());
     ForceFlat();
     return;
   }
@@ -351,29 +362,13 @@ void Strategy::Flatting() {
 }
 
 bool Strategy::NewHigh(OrderSide::Enum side) {
-  if (hedge_bid.size() < 6) {
+  if (hedge_bid_high.Size() < new_high_min_samples) {
     return true;
   }
   if (side == OrderSide::Buy) {  // main side buy, hedgeside sell, should be bid
-    auto temp = hedge_bid;
-    temp.pop_back();
-    double second_max_bid = 0.0;
-    for (auto i : temp) {
-      if (i > second_max_bid) {
-        second_max_bid = i;
-      }
-    }
-    return hedge_bid.back() - second_max_bid > 3*min_price_move ? true : false;
+    return hedge_bid_high.Margin() > 3*min_price_move;
   } else if (side == OrderSide::Sell) {
-    auto temp = hedge_ask;
-    temp.pop_back();
-    double second_min_ask = 10000000;
-    for (auto i : temp) {
-      if (i < second_min_ask) {
-        second_min_ask = i;
-      }
-    }
-    return second_min_ask - hedge_ask.back() > 3*min_price_move ? true : false;
+    return hedge_ask_low.Margin() > 3*min_price_move;
   } else {
     return true;
   }
@@ -382,23 +377,21 @@ bool Strategy::NewHigh(OrderSide::Enum side) {
 
 void Strategy::Open(OrderSide::Enum side) {
   if (NewHigh(side)) {
-    printf("[%s %s]%s block orders bc new high appear!\n", main_ticker.c_str(), hedge_ticker.c_str(), OrderSide::ToString(side));
-    PrintDeque(hedge_ask);
-    PrintDeque(hedge_bid);
+    LOG_INFO("[%s %s]%s block orders bc new high appear! bid %lf over %lf, ask %lf under %lf, %d samples\n", main_ticker.c_str(), hedge_ticker.c_str(), OrderSide::ToString(side), hedge_bid_high.Newest(), hedge_bid_high.Prior(), hedge_ask_low.Newest(), hedge_ask_low.Prior(), hedge_bid_high.Size());
     return;
   }
   int pos = position_map[main_ticker];
-  printf("[%s %s] open %s: pos is %d, diff is %lf\n", main_ticker.c_str(), hedge_ticker.c_str(), OrderSide::ToString(side), pos, GetPairMid());
+  LOG_INFO("[%s %s] open %s: pos is %d, diff is %lf\n", main_ticker.c_str(), hedge_ticker.c_str(), OrderSide::ToString(side), pos, GetPairMid());
   if (order_map.empty()) {  // no block order, can add open
     Order* o = NewOrder(main_ticker, side, 1, false, false, "", no_close_today);
     RecordSlip(main_ticker, o->side);
-    o->Show(stdout);
+    LOG_SHOW(LOG_INFO_LEVEL, *o);
     // printf("spread is %lf %lf min_profit is %lf, next open will be %lf\n", shot_map[main_ticker].asks[0]-shot_map[main_ticker].bids[0], shot_map[hedge_ticker].asks[0]-shot_map[hedge_ticker].bids[0], min_profit, side == OrderSide::Buy ? down_diff: up_diff);
     HandleTestOrder(o);
-    target_hedge_price = (side == OrderSide::Buy) ? shot_map[hedge_ticker].bids[0] : shot_map[hedge_ticker].asks[0];
+    target_hedge_price = (side == OrderSide::Buy) ? hedge_slot->shot->bids[0] : hedge_slot->shot->asks[0];
     sample_head = sample_tail;
   } else {  // block order exsit, no open, possible reason: no enough margin
-    printf("block order exsited! no open \n");
+    LOG_WARN("block order exsited! no open \n");
     PrintMap(order_map);
     // exit(1);
   }
@@ -421,6 +414,7 @@ bool Strategy::OpenLogic() {
 }
 
 void Strategy::Run() {
+  ScopedProfile prof(prof_run);
   if (IsAlign() && close_round < max_round) {
       if (!OpenLogic()) {
         CloseLogic();
@@ -437,46 +431,46 @@ void Strategy::Init() {
 }
 
 void Strategy::DoOperationAfterUpdateData(const MarketSnapshot& shot) {
-  mid_map[shot.ticker] = (shot.bids[0]+shot.asks[0]) / 2;  // mid_map saved the newest mid, no matter it is aligned or not
+  ScopedProfile prof(prof_update_data);
+  InstrumentSlot* slot = slots.Find(shot.ticker);
+  if (slot) {
+    slot->mid = (shot.bids[0]+shot.asks[0]) / 2;  // the newest mid, no matter it is aligned or not
+  }
   if (strcmp(shot.ticker, hedge_ticker.c_str()) == 0) {
-    hedge_ask.push_back(shot.asks[0]);
-    hedge_bid.push_back(shot.bids[0]);
-    if (hedge_ask.size() > 8) {
-      hedge_ask.pop_front();
-      hedge_bid.pop_front();
-    }
+    hedge_ask_low.Push(shot.asks[0]);
+    hedge_bid_high.Push(shot.bids[0]);
   }
-  current_spread = shot_map[main_ticker].asks[0] - shot_map[main_ticker].bids[0] + shot_map[hedge_ticker].asks[0] - shot_map[hedge_ticker].bids[0];
+  current_spread = main_slot->shot->asks[0] - main_slot->shot->bids[0] + hedge_slot->shot->asks[0] - hedge_slot->shot->bids[0];
   if (IsAlign()) {
     double mid = GetPairMid();
-    map_vector.emplace_back(mid);  // map_vector saved the aligned mid, all the elements here are safe to trade
+    map_stats.Push(mid);  // map_stats holds the aligned mids, all the elements here are safe to trade
     int num_sample = ++sample_tail - sample_head;
     if (num_sample > train_samples && num_sample % (train_samples) == 1) {
       CalParams();
     }
     if (mode_ == StrategyMode::Real) {
-      printf("%ld [%s, %s]mid_diff is %lf\n", shot.time.tv_sec, main_ticker.c_str(), hedge_ticker.c_str(), mid_map[main_ticker]-mid_map[hedge_ticker]);
+      LOG_INFO("%ld [%s, %s]mid_diff is %lf\n", shot.time.tv_sec, main_ticker.c_str(), hedge_ticker.c_str(), main_slot->mid-hedge_slot->mid);
     }
     if (ss == StrategyStatus::Training) {
       mean = down_diff = up_diff = stop_loss_down_line = stop_loss_up_line = mid;
     }
     MarketSnapshot shot;
     snprintf(shot.ticker, sizeof(shot.ticker), "['%s', '%s']", main_ticker.c_str(), hedge_ticker.c_str());
-    shot.time = shot_map[hedge_ticker].time;
+    shot.time = hedge_slot->shot->time;
     shot.bids[0] = down_diff - current_spread/2;
     shot.bids[1] = stop_loss_down_line;
     shot.bids[2] = mean - current_spread/2;
     shot.asks[0] = up_diff + current_spread/2;
     shot.asks[1] = stop_loss_up_line;
     shot.asks[2] = mean + current_spread/2;
-    shot.bids[3] = shot_map[main_ticker].bids[0];
-    shot.asks[3] = shot_map[main_ticker].asks[0];
-    shot.bids[4] = shot_map[hedge_ticker].bids[0];
-    shot.asks[4] = shot_map[hedge_ticker].asks[0];
-    shot.bid_sizes[3] = shot_map[main_ticker].bid_sizes[0];
-    shot.ask_sizes[3] = shot_map[main_ticker].ask_sizes[0];
-    shot.bid_sizes[4] = shot_map[hedge_ticker].bid_sizes[0];
-    shot.ask_sizes[4] = shot_map[hedge_ticker].ask_sizes[0];
+    shot.bids[3] = main_slot->shot->bids[0];
+    shot.asks[3] = main_slot->shot->asks[0];
+    shot.bids[4] = hedge_slot->shot->bids[0];
+    shot.asks[4] = hedge_slot->shot->asks[0];
+    shot.bid_sizes[3] = main_slot->shot->bid_sizes[0];
+    shot.ask_sizes[3] = main_slot->shot->ask_sizes[0];
+    shot.bid_sizes[4] = hedge_slot->shot->bid_sizes[0];
+    shot.ask_sizes[4] = hedge_slot->shot->ask_sizes[0];
     shot.open_interest = mean;
     std::string label = main_ticker + '|' + hedge_ticker;
     snprintf(shot.ticker, sizeof(shot.ticker), "%s", label.c_str());
@@ -486,8 +480,8 @@ void Strategy::DoOperationAfterUpdateData(const MarketSnapshot& shot) {
 }
 
 void Strategy::HandleCommand(const Command& shot) {
-  printf("received command!\n");
-  shot.Show(stdout);
+  LOG_INFO("received command!\n");
+  LOG_SHOW(LOG_INFO_LEVEL, shot);
   if (abs(shot.vdouble[0]) > MIN_DOUBLE_DIFF) {
     up_diff = shot.vdouble[0];
     return;
@@ -518,7 +512,7 @@ void Strategy::Resume() {
 
 bool Strategy::Ready() {
   int num_sample = sample_tail - sample_head;
-  if (position_ready && shot_map[main_ticker].IsGood() && shot_map[hedge_ticker].IsGood() && num_sample >= train_samples) {
+  if (position_ready && main_slot->shot->IsGood() && hedge_slot->shot->IsGood() && num_sample >= train_samples) {
     if (num_sample == train_samples) {
       // first cal params
       CalParams();
@@ -526,35 +520,36 @@ bool Strategy::Ready() {
     return true;
   }
   if (!position_ready) {
-    printf("waiting position query finish!\n");
+    LOG_WARN("waiting position query finish!\n");
   }
   return false;
 }
 
 void Strategy::ModerateOrders(const std::string & ticker) {
+  ScopedProfile prof(prof_moderate_orders);
   // just make sure the order filled
   if (mode_ == StrategyMode::Real) {
     for (auto m:order_map) {
       Order* o = m.second;
       if (o->Valid()) {
         std::string ticker = o->ticker;
-        MarketSnapshot shot = shot_map[ticker];
+        const MarketSnapshot & shot = Shot(ticker);
         double reasonable_price = (o->side == OrderSide::Buy ? shot.asks[0] : shot.bids[0]);
         bool is_price_move = (fabs(reasonable_price - o->price) >= min_price_move/2);
         if (!is_price_move) {
           continue;
         }
         if (ticker == main_ticker) {
-          if ((o->side == OrderSide::Buy && shot_map[hedge_ticker].bids[0] - this->target_hedge_price < -1e-4) ||
-          (o->side == OrderSide::Sell && shot_map[hedge_ticker].asks[0] - this->target_hedge_price > -1e-4) ) {
-            printf("[%s %s]target hedge price is %s@%lf, now is %lf %lf\n", main_ticker.c_str(), hedge_ticker.c_str(), OrderSide::ToString(o->side), target_hedge_price, shot_map[hedge_ticker].bids[0], shot_map[hedge_ticker].asks[0]);
+          if ((o->side == OrderSide::Buy && hedge_slot->shot->bids[0] - this->target_hedge_price < -1e-4) ||
+          (o->side == OrderSide::Sell && hedge_slot->shot->asks[0] - this->target_hedge_price > -1e-4) ) {
+            LOG_INFO("[%s %s]target hedge price is %s@%lf, now is %lf %lf\n", main_ticker.c_str(), hedge_ticker.c_str(), OrderSide::ToString(o->side), target_hedge_price, hedge_slot->shot->bids[0], hedge_slot->shot->asks[0]);
             CancelOrder(o);
           }
         } else if (ticker == hedge_ticker) {
           // printf("[%s %s]Slip point for :modify %s order %s: %lf->%lf mpv=%lf\n", main_ticker.c_str(), hedge_ticker.c_str(), OrderSide::ToString(o->side), o->order_ref, o->price, reasonable_price, min_price_move);
-          if (shot_map[hedge_ticker].time.tv_sec - o->shot_time.tv_sec >= 3) {
-            printf("[%s %s] cancel hedge order, bc not filled in 3s\n", main_ticker.c_str(), hedge_ticker.c_str());
-            shot_map[hedge_ticker].Show(stdout);
+          if (hedge_slot->shot->time.tv_sec - o->shot_time.tv_sec >= 3) {
+            LOG_INFO("[%s %s] cancel hedge order, bc not filled in 3s\n", main_ticker.c_str(), hedge_ticker.c_str());
+            LOG_SHOW(LOG_INFO_LEVEL, *hedge_slot->shot);
             ModOrder(o);
           }
         } else {
@@ -582,7 +577,7 @@ void Strategy::DoOperationAfterUpdatePos(Order* o, const ExchangeInfo& info) {
 }
 
 void Strategy::UpdateBound(OrderSide::Enum side) {
-  printf("Entering UpdateBound\n");
+  LOG_INFO("Entering UpdateBound\n");
   int pos = position_map[main_ticker];
   if (pos == 0) {  // close operation filled, no update bound
     return;
@@ -602,7 +597,7 @@ void Strategy::UpdateBound(OrderSide::Enum side) {
       stop_loss_up_line += increment/2;
     }
   }
-  printf("spread is %lf %lf min_profit is %lf, next open will be %lf mean is %lf\n", shot_map[main_ticker].asks[0]-shot_map[main_ticker].bids[0], shot_map[hedge_ticker].asks[0]-shot_map[hedge_ticker].bids[0], min_profit, side == OrderSide::Sell ? down_diff: up_diff, mean);
+  LOG_INFO("spread is %lf %lf min_profit is %lf, next open will be %lf mean is %lf\n", main_slot->shot->asks[0]-main_slot->shot->bids[0], hedge_slot->shot->asks[0]-hedge_slot->shot->bids[0], min_profit, side == OrderSide::Sell ? down_diff: up_diff, mean);
 }
 
 void Strategy::HandleTestOrder(Order* o) {
@@ -621,7 +616,7 @@ void Strategy::HandleTestOrder(Order* o) {
   // position_map[o->ticker] += o->side == OrderSide::Buy ? o->size : -o->size;
   exchange_file->write(reinterpret_cast<char*>(&info), sizeof(info));
   exchange_file->flush();
-  info.Show(stdout);
+  LOG_SHOW(LOG_INFO_LEVEL, info);
   UpdatePos(o, info);
   // order_map.clear();
   PrintMap(position_map);
@@ -634,16 +629,41 @@ void Strategy::UpdateBuildPosTime() {
   int hedge_pos = position_map[hedge_ticker];
   if (hedge_pos == 0) {  // closed all position, reinitialize build_position_time
     build_position_time = MAX_UNIX_TIME;
+    timers.Cancel(holding_timer);
+    holding_timer = 0;
   } else if (hedge_pos == 1) {  // position 0->1, record build_time
     build_position_time = m_tc->TimevalInt(last_shot.time);
+    // fires on the clock even when the pair stops ticking, TimeUp in CloseLogic
+    // stays as the retry while the position is still open; build_position_time is
+    // seconds of the day, the wheel runs on epoch time
+    timers.Cancel(holding_timer);
+    holding_timer = 0;
+    if (holding_deadline && TimersDriven()) {
+      holding_timer = timers.At(TimerNs(last_shot.time) + static_cast<int64_t>(max_holding_sec) * 1000000000LL, [this]() {
+        HoldingTimeUp();
+      });
+    }
+  }
+}
+
+bool Strategy::UsesTimers() const {
+  return holding_deadline;
+}
+
+void Strategy::HoldingTimeUp() {
+  holding_timer = 0;
+  if (position_map[main_ticker] == 0 || (ss != StrategyStatus::Running && ss != StrategyStatus::Flatting)) {
+    return;
   }
+  LOG_INFO("[%s %s] holding deadline, start from %ld, max_hold is %d close diff is %lf force to close position!\n", main_ticker.c_str(), hedge_ticker.c_str(), build_position_time, max_holding_sec, GetPairMid());
+  ForceFlat();
 }
 
 void Strategy::RecordPnl(Order* o, bool force_flat) {
   int pos = o->size;
   OrderSide::Enum pos_side = o->side == OrderSide::Sell ? OrderSide::Buy: OrderSide::Sell;
   OrderSide::Enum close_side = o->side;
-  double hedge_price = pos > 0 ? shot_map[hedge_ticker].asks[0] : shot_map[hedge_ticker].bids[0];
+  double hedge_price = pos > 0 ? hedge_slot->shot->asks[0] : hedge_slot->shot->bids[0];
   // cout << "main pnl param:" << main_ticker <<" " <<  avgcost_map[main_ticker]<< " " <<  abs(pos) << " " << o->price << " " << abs(pos) << endl;
   // cout << "hedge pnl param:" << hedge_ticker <<" " <<  avgcost_map[hedge_ticker]<< " " <<  abs(pos) << " " << hedge_price << " " << abs(pos) << endl;
   double this_round_pnl = m_cw->CalNetPnl(main_ticker, avgcost_map[main_ticker], abs(pos), o->price, abs(pos), close_side, no_close_today) + m_cw->CalNetPnl(hedge_ticker, avgcost_map[hedge_ticker], abs(pos), hedge_price, abs(pos), pos_side, no_close_today);
@@ -674,7 +694,7 @@ void Strategy::RecordPnl(Order* o, bool force_flat) {
 
 void Strategy::DoOperationAfterFilled(Order* o, const ExchangeInfo& info) {
   PrintMap(avgcost_map);
-  o->Show(stdout);
+  LOG_SHOW(LOG_INFO_LEVEL, *o);
   if (strcmp(o->ticker, main_ticker.c_str()) == 0) {
     // get hedged right now
     std::string a = o->tbd;
@@ -689,12 +709,12 @@ void Strategy::DoOperationAfterFilled(Order* o, const ExchangeInfo& info) {
     Order* order = NewOrder(hedge_ticker, hedge_side, info.trade_size, false, false, o->tbd, no_close_today);
     RecordSlip(hedge_ticker, hedge_side, a.find("close") != string::npos);
     HandleTestOrder(order);
-    order->Show(stdout);
+    LOG_SHOW(LOG_INFO_LEVEL, *order);
   } else if (strcmp(o->ticker, hedge_ticker.c_str()) == 0) {
     UpdateBuildPosTime();
     UpdateBound(o->side);
   } else {
-    printf("o->ticker=%s, main:%s, hedge:%s\n", o->ticker, main_ticker.c_str(), hedge_ticker.c_str());
+    LOG_INFO("o->ticker=%s, main:%s, hedge:%s\n", o->ticker, main_ticker.c_str(), hedge_ticker.c_str());
     SimpleHandle(322);
   }
 }
@@ -8,7 +8,6 @@
 #include <vector>
 #include <string>
 #include <iostream>
-#include <deque>
 #include <memory>
 
 #include "struct/market_snapshot.h"
@@ -23,16 +22,22 @@
 #include "util/dater.h"
 #include "util/history_worker.h"
 #include "util/contract_worker.h"
+#include "util/profiler.hpp"
+#include "util/async_log.hpp"
+#include "util/rolling_stats.hpp"
+#include "core/instrument_slots.hpp"
+#include "core/timer_wheel.hpp"
 #include "util/common_tools.h"
 #include "core/base_strategy.h"
 
-class Strategy : public BaseStrategy {
+class Strategy : public BaseStrategy, public TimerOwner {
  public:
   explicit Strategy(const libconfig::Setting & param_setting, std::unordered_map<std::string, std::vector<BaseStrategy*> >*ticker_strat_map, ZmqSender<MarketSnapshot>* uisender, ZmqSender<Order>* ordersender, TimeController* tc, ContractWorker* cw, const std::string & date, StrategyMode::Enum mode = StrategyMode::Real, std::ofstream* exchange_file = nullptr);
   ~Strategy();
 
   void Start() override;
   void Stop() override;
+  bool UsesTimers() const override;
 
   // void Clear() override;
   void HandleCommand(const Command& shot) override;
@@ -56,6 +61,7 @@ class Strategy : public BaseStrategy {
   void Flatting() override;
 
   void UpdateBuildPosTime();
+  void HoldingTimeUp();
 
   double OrderPrice(const std::string & contract, OrderSide::Enum side, bool control_price) override;
 
@@ -70,7 +76,8 @@ class Strategy : public BaseStrategy {
   void RecordPnl(Order* o, bool force_flat = false);
 
   void CalParams();
-  std::tuple<double, double> CalMeanStd(const std::vector<double> & v, int head, int num);
+  const MarketSnapshot & Shot(const std::string & ticker);
+  const MarketSnapshot & NextShot(const std::string & ticker);
   bool HitMean();
 
   double GetPairMid();
@@ -94,18 +101,25 @@ class Strategy : public BaseStrategy {
 
   // std::unordered_map<std::string, std::vector<BaseStrategy*> >*tsm;
   int cancel_limit;
-  std::unordered_map<std::string, double> mid_map;
+  // main_ticker and hedge_ticker, resolved once in RunningSetup
+  InstrumentSlots slots;
+  InstrumentSlot* main_slot;
+  InstrumentSlot* hedge_slot;
   double up_diff;
   double down_diff;
   double range_width;
   double mean;
-  std::vector<double> map_vector;
+  RollingStats map_stats;  // the last train_samples aligned mids
   int current_pos;
   double min_profit;
   int train_samples;
   double min_range;
   double increment;
   std::string date;
+  ProfilePoint* prof_update_data;
+  ProfilePoint* prof_run;
+  ProfilePoint* prof_moderate_orders;
+  ProfilePoint* prof_cal_params;
   double spread_threshold;
   int closed_size;
   double last_valid_mid;
@@ -128,8 +142,16 @@ class Strategy : public BaseStrategy {
   int sample_tail;
   std::ofstream* exchange_file;
   double target_hedge_price;
-  std::deque<double>  hedge_ask;
-  std::deque<double> hedge_bid;
+  // the last new_high_window hedge quotes; NewHigh blocks orders while the newest
+  // breaks out of the rest, or while there are fewer than new_high_min_samples
+  int new_high_window;
+  int new_high_min_samples;
+  RecentHigh hedge_bid_high;
+  RecentLow hedge_ask_low;
+  // holding_deadline = true force flats on a timer max_holding_sec after the position
+  // was built, even while the pair is quiet; off, TimeUp in CloseLogic alone does it
+  bool holding_deadline;
+  TimerId holding_timer;
 };
 
 #endif  // SRC_SIMPLEARB_STRATEGY_H_
@@ -0,0 +1,48 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "util/stream_transformer.hpp"
+
+void Usage(const char* name) {
+  printf("usage: %s [-j threads] [-f files_in_parallel] [-o dest_dir] data_file [data_file ...]\n", name);
+  printf("  .dat/.dat.gz -> .csv, .csv/.csv.gz and .log/.log.gz -> .dat\n");
+}
+
+int main(int argc, char** argv) {
+  int thread_num = 0;
+  int file_parallel = 0;
+  std::string dest_dir;
+  int opt;
+  while ((opt = getopt(argc, argv, "j:f:o:h")) != -1) {
+    switch (opt) {
+     case 'j':
+      thread_num = atoi(optarg);
+      break;
+     case 'f':
+      file_parallel = atoi(optarg);
+      break;
+     case 'o':
+      dest_dir = optarg;
+      break;
+     default:
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (optind >= argc) {
+    Usage(argv[0]);
+    return 1;
+  }
+  std::vector<std::string> files(argv + optind, argv + argc);
+  if (!dest_dir.empty()) {
+    EnsureDir(dest_dir);
+  }
+  StreamTransformer st(thread_num);
+  int failed = st.BatchRun(files, dest_dir, file_parallel);
+  printf("%zu files done, %d failed\n", files.size(), failed);
+  return failed == 0 ? 0 : 1;
+}